@@ -0,0 +1,118 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+#include <argparse/argparse.hpp>
+
+#include "defer.h"
+#include "pcie-open.h"
+#include "pcie.h"
+#include "util_sdb.h"
+
+#include "modules/acq.h"
+
+using namespace std::literals;
+
+int main(int argc, char *argv[])
+{
+    argparse::ArgumentParser args(
+        "bench-acq", "1.0", argparse::default_arguments::help);
+    args.add_argument("-b").help("device number").required();
+    args.add_argument("-a")
+        .help("enumerated position of acq core")
+        .default_value((unsigned)0)
+        .scan<'u', unsigned>();
+    args.add_argument("-c")
+        .help("channel number")
+        .default_value((unsigned)0)
+        .scan<'u', unsigned>();
+    args.add_argument("-i")
+        .help("number of iterations")
+        .default_value((unsigned)1000)
+        .scan<'u', unsigned>();
+    args.add_argument("--continuous")
+        .help("compare serial and continuous acquisitions of this many samples")
+        .scan<'u', unsigned>();
+
+    args.parse_args(argc, argv);
+
+    auto device_number = args.get<std::string>("-b");
+    struct pcie_bars bars;
+    dev_open_slot(bars, device_number.c_str());
+    defer _(nullptr, [&bars](...) { dev_close(bars); });
+
+    acq::Controller ctl { bars };
+    if (auto v = read_sdb(
+            &bars, ctl.match_devinfo_lambda, args.get<unsigned>("-a")))
+        ctl.set_devinfo(*v);
+    else
+        return 1;
+
+    ctl.channel = args.get<unsigned>("-c");
+    /* the acquisition is never triggered, so it can always be stopped */
+    ctl.trigger_type = "software";
+
+    const unsigned iterations = args.get<unsigned>("-i");
+
+    /* time only the arming step, after prepare(i) has changed what is going
+     * to be written */
+    auto bench = [&ctl, iterations](const char *name, auto prepare) {
+        std::chrono::high_resolution_clock::duration d { };
+        for (unsigned i = 0; i < iterations; i++) {
+            prepare(i);
+
+            auto ti = std::chrono::high_resolution_clock::now();
+            auto r = ctl.start_acquisition();
+            d += std::chrono::high_resolution_clock::now() - ti;
+
+            ctl.stop_acquisition();
+
+            if (r != acq::acq_error::success) {
+                std::cerr << "start_acquisition failed" << std::endl;
+                std::exit(1);
+            }
+        }
+        std::cout << name << ": " << (d / iterations) / 1ns << " ns"
+                  << std::endl;
+    };
+
+    auto samples = args.present<unsigned>("--continuous");
+    if (!samples) {
+        /* the same as before written registers were tracked */
+        bench("re-arm writing every register",
+            [&ctl](unsigned) { ctl.forget_written_params(); });
+        bench("re-arm with a new trigger delay",
+            [&ctl](unsigned i) { ctl.trigger_delay = i & 1; });
+        bench("re-arm with the same parameters", [](unsigned) { });
+        return 0;
+    }
+
+    ctl.trigger_type = "now";
+    ctl.pre_samples = *samples;
+    ctl.trigger_delay = 0;
+
+    auto report = [iterations](const char *name, auto d) {
+        std::cout << name << ": "
+                  << iterations / std::chrono::duration<double>(d).count()
+                  << " acquisitions/s" << std::endl;
+    };
+
+    auto ti = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < iterations; i++)
+        (void)ctl.result<int32_t>();
+    report("serial", std::chrono::steady_clock::now() - ti);
+
+    acq::ContinuousAcquisition<int32_t> cont { ctl, 2, 4,
+        acq::ContinuousAcquisition<int32_t>::overflow_policy::block };
+    ti = std::chrono::steady_clock::now();
+    cont.start();
+    for (unsigned i = 0; i < iterations; i++)
+        (void)cont.pop();
+    report("continuous", std::chrono::steady_clock::now() - ti);
+    cont.stop();
+
+    auto stats = cont.get_stats();
+    std::cout << "hardware stalls: " << stats.stalls << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,146 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include <argparse/argparse.hpp>
+
+#include "defer.h"
+#include "pcie-open.h"
+#include "pcie.h"
+#include "util_sdb.h"
+
+#include "modules/fofb_processing.h"
+#include "modules/fofb_shaper_filt.h"
+
+using namespace std::literals;
+
+int main(int argc, char *argv[])
+{
+    argparse::ArgumentParser args(
+        "bench-fofb", "1.0", argparse::default_arguments::help);
+    args.add_argument("-b").help("device number").required();
+    args.add_argument("-a")
+        .help("enumerated position of fofb_processing core")
+        .default_value((unsigned)0)
+        .scan<'u', unsigned>();
+    args.add_argument("-i")
+        .help("number of iterations")
+        .default_value((unsigned)100)
+        .scan<'u', unsigned>();
+    args.add_argument("-n")
+        .help("number of BPMs changed by each sparse update")
+        .default_value((unsigned)8)
+        .scan<'u', unsigned>();
+    args.add_argument("-s")
+        .help("enumerated position of fofb_shaper_filt core, to also time "
+              "its coefficient writes")
+        .scan<'u', unsigned>();
+    args.add_argument("--full")
+        .help("also time write_params(), which overwrites the whole core "
+              "configuration")
+        .default_value(false)
+        .implicit_value(true);
+
+    args.parse_args(argc, argv);
+
+    auto device_number = args.get<std::string>("-b");
+    struct pcie_bars bars;
+    dev_open_slot(bars, device_number.c_str());
+    defer _(nullptr, [&bars](...) { dev_close(bars); });
+
+    fofb_processing::Core dec { bars };
+    fofb_processing::Controller ctl { bars };
+    if (auto v = read_sdb(
+            &bars, ctl.match_devinfo_lambda, args.get<unsigned>("-a"))) {
+        dec.set_devinfo(*v);
+        ctl.set_devinfo(*v);
+    } else {
+        return 1;
+    }
+
+    const unsigned iterations = args.get<unsigned>("-i");
+    const unsigned num_bpms
+        = std::min(args.get<unsigned>("-n"), (unsigned)ctl.ref_orb_x.size());
+
+    /* start from the device's reference orbit, and restore it in the end */
+    dec.get_data();
+    const auto orig_x = dec.ref_orb_x, orig_y = dec.ref_orb_y;
+    ctl.ref_orb_x = orig_x;
+    ctl.ref_orb_y = orig_y;
+
+    /* every iteration changes the orbit, so no write can be skipped */
+    auto bench = [iterations](const char *name, auto fn) {
+        std::chrono::steady_clock::duration total { }, worst { };
+        for (unsigned i = 0; i < iterations; i++) {
+            auto ti = std::chrono::steady_clock::now();
+            fn(i);
+            auto d = std::chrono::steady_clock::now() - ti;
+            total += d;
+            worst = std::max(worst, d);
+        }
+        std::cout << name << ": " << (total / iterations) / 1us
+                  << " us average, " << worst / 1us << " us worst"
+                  << std::endl;
+    };
+
+    if (args.is_used("--full"))
+        bench("write_params()", [&ctl](unsigned i) {
+            ctl.ref_orb_x[0] = i;
+            ctl.write_params();
+        });
+    bench("write_ref_orb()", [&ctl](unsigned i) {
+        ctl.ref_orb_x[0] = i;
+        ctl.write_ref_orb();
+    });
+
+    std::vector<fofb_processing::Controller::ref_orb_change> changes(
+        num_bpms);
+    bench("update_ref_orb()", [&ctl, &changes](unsigned i) {
+        /* spread the changes, so they can't be merged into one write */
+        for (unsigned j = 0; j < changes.size(); j++)
+            changes[j] = { j * 2, (int32_t)(i + j) };
+        ctl.update_ref_orb(changes, changes);
+    });
+
+    ctl.ref_orb_x = orig_x;
+    ctl.ref_orb_y = orig_y;
+    ctl.write_ref_orb();
+
+    if (auto index = args.present<unsigned>("-s")) {
+        fofb_shaper_filt::Core shaper_dec { bars };
+        fofb_shaper_filt::Controller shaper { bars };
+        if (auto v = read_sdb(&bars, shaper.match_devinfo_lambda, *index)) {
+            shaper_dec.set_devinfo(*v);
+            shaper.set_devinfo(*v);
+        } else {
+            return 1;
+        }
+
+        /* start from the device's coefficients, and restore them in the end */
+        shaper_dec.get_data();
+        const auto orig = shaper_dec.coefficients.values;
+        shaper.coefficients.values = orig;
+
+        auto &values = shaper.coefficients.values;
+        bench("shaper write_params() all channels",
+            [&values, &shaper](unsigned i) {
+                for (auto &c : values)
+                    c.at(0) = i % 2 ? 0.5 : 0.25;
+                shaper.write_params();
+            });
+        bench("shaper write_changed_params() one channel",
+            [&values, &shaper](unsigned i) {
+                values[0].at(0) = i % 2 ? 0.25 : 0.5;
+                shaper.write_changed_params();
+            });
+        bench("shaper write_changed_params() unchanged",
+            [&shaper](unsigned) { shaper.write_changed_params(); });
+
+        values = orig;
+        shaper.write_params();
+    }
+
+    return 0;
+}
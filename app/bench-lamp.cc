@@ -0,0 +1,162 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <numbers>
+#include <thread>
+#include <vector>
+
+#include <argparse/argparse.hpp>
+
+#include "defer.h"
+#include "pcie-open.h"
+#include "pcie.h"
+#include "util_sdb.h"
+
+#include "modules/lamp.h"
+
+using namespace std::literals;
+
+int main(int argc, char *argv[])
+{
+    argparse::ArgumentParser args(
+        "bench-lamp", "1.0", argparse::default_arguments::help);
+    args.add_argument("-b").help("device number").required();
+    args.add_argument("-a")
+        .help("enumerated position of lamp core")
+        .default_value((unsigned)0)
+        .scan<'u', unsigned>();
+    args.add_argument("-i")
+        .help("number of iterations")
+        .default_value((unsigned)1000)
+        .scan<'u', unsigned>();
+    args.add_argument("-t")
+        .help("setpoint type: dac or pi_sp")
+        .default_value(std::string("pi_sp"));
+    args.add_argument("--full")
+        .help("also time write_params(), which overwrites the whole core "
+              "configuration")
+        .default_value(false)
+        .implicit_value(true);
+    args.add_argument("--play")
+        .help("play a small sine wave on all channels at this rate, in Hz, "
+              "and report the jitter")
+        .scan<'u', unsigned>();
+    args.add_argument("-d")
+        .help("duration of --play, in seconds")
+        .default_value((unsigned)5)
+        .scan<'u', unsigned>();
+
+    args.parse_args(argc, argv);
+
+    const auto type_name = args.get<std::string>("-t");
+    lamp::setpoint_type type;
+    if (type_name == "dac") {
+        type = lamp::setpoint_type::dac;
+    } else if (type_name == "pi_sp") {
+        type = lamp::setpoint_type::pi_sp;
+    } else {
+        std::cerr << "unknown setpoint type: " << type_name << std::endl;
+        return 1;
+    }
+
+    auto device_number = args.get<std::string>("-b");
+    struct pcie_bars bars;
+    dev_open_slot(bars, device_number.c_str());
+    defer _(nullptr, [&bars](...) { dev_close(bars); });
+
+    lamp::Core dec { bars };
+    lamp::Controller ctl { bars };
+    if (auto v = read_sdb(
+            &bars, ctl.match_devinfo_lambda, args.get<unsigned>("-a"))) {
+        dec.set_devinfo(*v);
+        ctl.set_devinfo(*v);
+    } else {
+        return 1;
+    }
+
+    const unsigned iterations = args.get<unsigned>("-i");
+    const char *reg_name = type == lamp::setpoint_type::dac ? "DAC" : "PI_SP";
+
+    /* start from the device's setpoints, and restore them in the end */
+    dec.get_data();
+    std::vector<lamp::SetpointHandle> handles;
+    std::vector<int16_t> orig;
+    for (unsigned i = 0; i < lamp::num_channels; i++) {
+        handles.push_back(ctl.get_setpoint_handle(i, type));
+        orig.push_back(dec.get_channel_data<int32_t>(reg_name, i));
+    }
+    auto restore = [&]() {
+        for (unsigned i = 0; i < lamp::num_channels; i++)
+            ctl.set_setpoint(handles[i], orig[i]);
+        ctl.write_setpoints();
+    };
+
+    /* every iteration changes the setpoints, so no write can be skipped */
+    auto bench = [iterations](const char *name, auto fn) {
+        std::chrono::steady_clock::duration total { }, worst { };
+        for (unsigned i = 0; i < iterations; i++) {
+            auto ti = std::chrono::steady_clock::now();
+            fn(i);
+            auto d = std::chrono::steady_clock::now() - ti;
+            total += d;
+            worst = std::max(worst, d);
+        }
+        std::cout << name << ": " << (total / iterations) / 1us
+                  << " us average, " << worst / 1us << " us worst"
+                  << std::endl;
+    };
+
+    if (args.is_used("--full"))
+        bench("write_channel() and write_params(), all channels",
+            [&](unsigned i) {
+                for (unsigned j = 0; j < lamp::num_channels; j++)
+                    ctl.write_channel(reg_name, j, orig[j] + (int)(i % 2));
+                ctl.write_params();
+            });
+    bench("write_setpoints() one channel", [&](unsigned i) {
+        ctl.set_setpoint(handles[0], orig[0] + (int)(i % 2));
+        ctl.write_setpoints();
+    });
+    bench("write_setpoints() all channels", [&](unsigned i) {
+        for (unsigned j = 0; j < lamp::num_channels; j++)
+            ctl.set_setpoint(handles[j], orig[j] + (int)(i % 2));
+        ctl.write_setpoints();
+    });
+    restore();
+
+    if (auto rate = args.present<unsigned>("--play"); rate && *rate) {
+        /* one period of a sine over 100 samples, around the original
+         * setpoints */
+        const size_t length = 100;
+        std::vector<std::vector<int16_t>> tables;
+        for (unsigned i = 0; i < lamp::num_channels; i++) {
+            tables.emplace_back(length);
+            for (size_t j = 0; j < length; j++)
+                tables[i][j] = std::clamp<int>(orig[i]
+                        + std::lround(
+                            100 * std::sin(2 * std::numbers::pi * j / length)),
+                    INT16_MIN, INT16_MAX);
+        }
+
+        lamp::WaveformPlayer player(
+            ctl, handles, tables, std::chrono::nanoseconds(1s) / *rate);
+        player.start();
+        std::this_thread::sleep_for(
+            std::chrono::seconds(args.get<unsigned>("-d")));
+        player.stop();
+
+        const auto stats = player.get_stats();
+        std::cout << "played " << stats.samples << " samples, missed "
+                  << stats.missed << (stats.realtime ? "" : ", not real time")
+                  << "\nlateness: " << stats.mean_lateness / 1ns
+                  << " ns mean, " << stats.rms_lateness / 1ns << " ns rms, "
+                  << stats.max_lateness / 1ns << " ns max"
+                  << "\nwrite time: " << stats.max_write_time / 1ns
+                  << " ns max" << std::endl;
+        restore();
+    }
+
+    return 0;
+}
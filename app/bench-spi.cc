@@ -0,0 +1,123 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include <argparse/argparse.hpp>
+
+#include "defer.h"
+#include "pcie-open.h"
+#include "pcie.h"
+#include "util_sdb.h"
+
+#include "modules/ad9510.h"
+#include "modules/isla216p.h"
+
+using namespace std::literals;
+
+int main(int argc, char *argv[])
+{
+    argparse::ArgumentParser args(
+        "bench-spi", "1.0", argparse::default_arguments::help);
+    args.add_argument("-b").help("device number").required();
+    args.add_argument("-a")
+        .help("enumerated position of the SPI device")
+        .default_value((unsigned)0)
+        .scan<'u', unsigned>();
+    args.add_argument("-q")
+        .help("type of SPI device (ad9510 or isla216p)")
+        .required();
+    args.add_argument("-s")
+        .help("slave select")
+        .default_value((unsigned)0)
+        .scan<'u', unsigned>();
+    args.add_argument("-r")
+        .help("first register to dump")
+        .default_value((uint8_t)0)
+        .scan<'x', uint8_t>();
+    args.add_argument("-n")
+        .help("number of registers to dump")
+        .default_value((unsigned)0x5b)
+        .scan<'u', unsigned>();
+    args.add_argument("-i")
+        .help("number of iterations")
+        .default_value((unsigned)20)
+        .scan<'u', unsigned>();
+    args.add_argument("--defaults")
+        .help("also time set_defaults(), which reprograms the device with its "
+              "default configuration")
+        .default_value(false)
+        .implicit_value(true);
+
+    args.parse_args(argc, argv);
+
+    auto device_number = args.get<std::string>("-b");
+    struct pcie_bars bars;
+    dev_open_slot(bars, device_number.c_str());
+    defer _(nullptr, [&bars](...) { dev_close(bars); });
+
+    const unsigned iterations = args.get<unsigned>("-i");
+    const uint8_t first = args.get<uint8_t>("-r");
+    const unsigned count = args.get<unsigned>("-n");
+    if (first + count > 0x100) {
+        std::cerr << "register range goes past the last address" << std::endl;
+        return 1;
+    }
+
+    auto bench = [iterations](const char *name, auto fn) {
+        std::chrono::steady_clock::duration total { }, worst { };
+        for (unsigned i = 0; i < iterations; i++) {
+            auto ti = std::chrono::steady_clock::now();
+            fn();
+            auto d = std::chrono::steady_clock::now() - ti;
+            total += d;
+            worst = std::max(worst, d);
+        }
+        std::cout << name << ": " << (total / iterations) / 1us
+                  << " us average, " << worst / 1us << " us worst"
+                  << std::endl;
+    };
+
+    auto run = [&](auto &ctl) {
+        if (auto v = read_sdb(
+                &bars, [&ctl](auto const &d) { return ctl.match_devinfo(d); },
+                args.get<unsigned>("-a"))) {
+            ctl.set_devinfo(*v);
+        } else {
+            return 1;
+        }
+
+        spi::Channel channel { args.get<unsigned>("-s") };
+        std::vector<uint8_t> single(count), block(count);
+
+        bench("register dump, one register per frame", [&]() {
+            for (unsigned i = 0; i < count; i++)
+                ctl.get_reg(first + i, single[i], channel);
+        });
+        bench("register dump, register blocks",
+            [&]() { ctl.get_regs(first, block, channel); });
+
+        if (single != block) {
+            std::cerr << "register dumps differ" << std::endl;
+            return 1;
+        }
+
+        if (args.is_used("--defaults"))
+            bench("set_defaults()", [&]() { ctl.set_defaults(channel); });
+
+        return 0;
+    };
+
+    auto dev_type = args.get<std::string>("-q");
+    if (dev_type == "ad9510") {
+        ad9510::Controller ctl(bars);
+        return run(ctl);
+    } else if (dev_type == "isla216p") {
+        isla216p::Controller ctl(bars);
+        return run(ctl);
+    }
+
+    std::cerr << "unsupported SPI device: " << dev_type << std::endl;
+    return 1;
+}
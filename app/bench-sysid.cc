@@ -0,0 +1,110 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+#include <argparse/argparse.hpp>
+
+#include "defer.h"
+#include "pcie-open.h"
+#include "pcie.h"
+#include "util_sdb.h"
+
+#include "modules/sysid.h"
+
+using namespace std::literals;
+
+int main(int argc, char *argv[])
+{
+    argparse::ArgumentParser args(
+        "bench-sysid", "1.0", argparse::default_arguments::help);
+    args.add_argument("-b").help("device number").required();
+    args.add_argument("-a")
+        .help("enumerated position of sys_id core")
+        .default_value((unsigned)0)
+        .scan<'u', unsigned>();
+    args.add_argument("-i")
+        .help("number of iterations")
+        .default_value((unsigned)100)
+        .scan<'u', unsigned>();
+    args.add_argument("--full")
+        .help("also time write_params(), which overwrites the whole core "
+              "configuration")
+        .default_value(false)
+        .implicit_value(true);
+
+    args.parse_args(argc, argv);
+
+    auto device_number = args.get<std::string>("-b");
+    struct pcie_bars bars;
+    dev_open_slot(bars, device_number.c_str());
+    defer _(nullptr, [&bars](...) { dev_close(bars); });
+
+    sys_id::Core dec { bars };
+    sys_id::Controller ctl { bars };
+    if (auto v = read_sdb(
+            &bars, ctl.match_devinfo_lambda, args.get<unsigned>("-a"))) {
+        dec.set_devinfo(*v);
+        ctl.set_devinfo(*v);
+    } else {
+        return 1;
+    }
+
+    const unsigned iterations = args.get<unsigned>("-i");
+
+    /* start from the device's distortion levels, and restore them in the
+     * end */
+    dec.get_data();
+    const auto orig_sp = dec.setpoint_distortion;
+    const auto orig_x = dec.posx_distortion, orig_y = dec.posy_distortion;
+    auto restore = [&]() {
+        ctl.setpoint_distortion = orig_sp;
+        ctl.posx_distortion = orig_x;
+        ctl.posy_distortion = orig_y;
+    };
+    restore();
+
+    auto bench = [iterations](const char *name, auto fn) {
+        std::chrono::steady_clock::duration total { }, worst { };
+        for (unsigned i = 0; i < iterations; i++) {
+            auto ti = std::chrono::steady_clock::now();
+            fn(i);
+            auto d = std::chrono::steady_clock::now() - ti;
+            total += d;
+            worst = std::max(worst, d);
+        }
+        std::cout << name << ": " << (total / iterations) / 1us
+                  << " us average, " << worst / 1us << " us worst"
+                  << std::endl;
+    };
+
+    /* every iteration changes every level, so the whole table is swapped */
+    auto fill = [&ctl](unsigned i) {
+        for (auto *d : { &ctl.setpoint_distortion, &ctl.posx_distortion,
+                 &ctl.posy_distortion }) {
+            std::fill(d->prbs_0.begin(), d->prbs_0.end(), -(int16_t)i);
+            std::fill(d->prbs_1.begin(), d->prbs_1.end(), (int16_t)i);
+        }
+    };
+
+    if (args.is_used("--full"))
+        bench("write_params() table swap", [&ctl, &fill](unsigned i) {
+            fill(i);
+            ctl.write_params();
+        });
+    bench("write_distortion() table swap",
+        [&ctl, &fill, iterations](unsigned i) {
+            fill(iterations + i);
+            ctl.write_distortion();
+        });
+    bench("write_distortion() single BPM", [&ctl](unsigned i) {
+        ctl.posx_distortion.prbs_1[i % ctl.posx_distortion.prbs_1.size()]
+            = i;
+        ctl.write_distortion();
+    });
+
+    restore();
+    ctl.write_distortion();
+
+    return 0;
+}
@@ -0,0 +1,84 @@
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+#include <argparse/argparse.hpp>
+
+#include "defer.h"
+#include "pcie-open.h"
+#include "pcie.h"
+
+#include "modules/board_snapshot.h"
+
+using namespace std::literals;
+
+int main(int argc, char *argv[])
+{
+    argparse::ArgumentParser args(
+        "board-snapshot", "1.0", argparse::default_arguments::help);
+    args.add_argument("-b").help("device number").required();
+    args.add_argument("mode").help("'save' or 'restore'");
+    args.add_argument("file").help("snapshot file");
+    args.add_argument("-v")
+        .help("list the cores in the snapshot")
+        .default_value(false)
+        .implicit_value(true);
+
+    args.parse_args(argc, argv);
+
+    const auto mode = args.get<std::string>("mode");
+    const auto path = args.get<std::string>("file");
+    if (mode != "save" && mode != "restore") {
+        std::cerr << "unknown mode: " << mode << std::endl;
+        return 1;
+    }
+
+    auto device_number = args.get<std::string>("-b");
+    struct pcie_bars bars;
+    dev_open_slot(bars, device_number.c_str());
+    defer _(nullptr, [&bars](...) { dev_close(bars); });
+
+    std::vector<board_snapshot::core_image> images;
+    if (mode == "save") {
+        auto t0 = std::chrono::steady_clock::now();
+        std::vector<board_snapshot::skipped_core> skipped;
+        images = board_snapshot::take(bars, &skipped);
+        auto t1 = std::chrono::steady_clock::now();
+        board_snapshot::save(path, images);
+        std::cout << "took snapshot in " << (t1 - t0) / 1us << " us"
+                  << std::endl;
+        for (const auto &s : skipped)
+            printf("skipped %s #%u at %08jx: no configuration layout\n",
+                s.controller.c_str(), s.index, (uintmax_t)s.devinfo.start_addr);
+    } else {
+        images = board_snapshot::load(path);
+    }
+
+    size_t words = 0;
+    for (const auto &image : images) {
+        words += image.data.size();
+        if (args.get<bool>("-v"))
+            printf("vendor %016jx id %08jx version %u.%u #%u addr %08jx: "
+                   "%zu words\n",
+                (uintmax_t)image.devinfo.vendor_id,
+                (uintmax_t)image.devinfo.device_id,
+                (unsigned)image.devinfo.abi_ver_major,
+                (unsigned)image.devinfo.abi_ver_minor, image.index,
+                (uintmax_t)image.devinfo.start_addr, image.data.size());
+    }
+    std::cout << images.size() << " cores, " << words << " words" << std::endl;
+    if (mode == "save")
+        return 0;
+
+    const auto report = board_snapshot::restore(bars, images);
+    std::cout << "restored " << report.words << " words in " << report.bursts
+              << " bursts\nwrite time: " << report.write_time / 1us
+              << " us\nverify time: " << report.verify_time / 1us << " us"
+              << std::endl;
+    for (const auto &m : report.mismatches)
+        printf("mismatch at %08jx: wrote %08jx, read %08jx\n",
+            (uintmax_t)m.addr, (uintmax_t)m.expected, (uintmax_t)m.read);
+
+    return report.mismatches.empty() ? 0 : 1;
+}
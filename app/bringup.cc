@@ -0,0 +1,84 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <argparse/argparse.hpp>
+
+#include "defer.h"
+#include "pcie-open.h"
+#include "pcie.h"
+
+#include "modules/bringup.h"
+
+using namespace std::literals;
+
+int main(int argc, char *argv[])
+{
+    argparse::ArgumentParser args(
+        "bringup", "1.0", argparse::default_arguments::help);
+    args.add_argument("slots")
+        .help("slots of the boards to bring up")
+        .nargs(argparse::nargs_pattern::at_least_one);
+    args.add_argument("-s")
+        .help("si57x startup frequency")
+        .default_value(0.)
+        .scan<'g', double>();
+    args.add_argument("-f")
+        .help("si57x frequency, which is left alone if not given")
+        .scan<'g', double>();
+
+    try {
+        args.parse_args(argc, argv);
+    } catch (const std::runtime_error &err) {
+        fprintf(stderr, "argparse error: %s\n", err.what());
+        return 1;
+    }
+
+    const auto slots = args.get<std::vector<std::string>>("slots");
+    std::vector<struct pcie_bars> bars(slots.size());
+    std::vector<struct pcie_bars *> boards;
+    for (size_t i = 0; i < slots.size(); i++) {
+        dev_open_slot(bars[i], slots[i].c_str());
+        boards.push_back(&bars[i]);
+    }
+    defer _(nullptr, [&bars](...) {
+        for (auto &b : bars)
+            dev_close(b);
+    });
+
+    bringup::board_config config;
+    config.si57x_fstartup = args.get<double>("-s");
+    config.si57x_freq = args.present<double>("-f");
+
+    const auto reports = bringup::bring_up(boards, config);
+
+    int rv = 0;
+    std::chrono::steady_clock::duration total { };
+    for (size_t i = 0; i < reports.size(); i++) {
+        const auto &r = reports[i];
+        printf("%s: setup %ld ms\n", slots[i].c_str(), (long)(r.setup / 1ms));
+
+        for (size_t j = 0; j < r.steps.size(); j++) {
+            const auto &s = r.steps[j];
+            const bool critical
+                = std::find(r.critical_path.begin(), r.critical_path.end(), j)
+                != r.critical_path.end();
+            const char *result = s.result == StepGraph::status::ok ? "ok"
+                : s.result == StepGraph::status::failed            ? "FAILED"
+                                                                   : "skipped";
+            printf("    %c %-24s %6ld ms -> %6ld ms  %s%s%s\n",
+                critical ? '*' : ' ', s.name.c_str(), (long)(s.start / 1ms),
+                (long)(s.end / 1ms), result, s.error.empty() ? "" : ": ",
+                s.error.c_str());
+
+            if (s.result != StepGraph::status::ok)
+                rv = 1;
+            total = std::max(total, s.end);
+        }
+    }
+    printf("crate: %ld ms\n", (long)(total / 1ms));
+
+    return rv;
+}
@@ -6,7 +6,9 @@
 #include <cstdlib>
 #include <cstring>
 #include <memory>
+#include <span>
 #include <thread>
+#include <vector>
 
 #include <argparse/argparse.hpp>
 
@@ -14,10 +16,12 @@
 #include "defer.h"
 #include "pcie-open.h"
 #include "pcie.h"
+#include "ring.h"
 #include "util.h"
 #include "util_sdb.h"
 
 #include "modules/acq.h"
+#include "modules/acq_archive.h"
 #include "modules/ad9510.h"
 #include "modules/afc_timing.h"
 #include "modules/bpm_swap.h"
@@ -54,8 +58,8 @@ int main(int argc, char *argv[])
         fputs("Usage: decode-reg mode <mode specific options>\n\n"
               "Positional arguments:\n"
               "mode      mode of operation ('reset', 'build_info', 'sdb', "
-              "'decode', 'ram', 'acq', 'lamp', 'pos_calc', 'si57x', "
-              "'fmc_active_clk', 'fmc250m_4ch', 'spi')\n",
+              "'decode', 'ram', 'acq', 'lamp', 'pos_calc', 'fofb_cc', "
+              "'si57x', 'fmc_active_clk', 'fmc250m_4ch', 'spi')\n",
             stderr);
         return 1;
     }
@@ -151,6 +155,14 @@ int main(int argc, char *argv[])
         .help("data trigger channel")
         .scan<'u', unsigned>();
     acq_args.add_argument("-d").help("trigger delay").scan<'u', unsigned>();
+    acq_args.add_argument("-f")
+        .help("output format ('csv', 'binary' or 'archive')")
+        .default_value(std::string("csv"));
+    acq_args.add_argument("-o").help("archive to append the acquisition to");
+    acq_args.add_argument("-j")
+        .help("number of threads for CSV output")
+        .default_value((unsigned)1)
+        .scan<'u', unsigned>();
 
     argparse::ArgumentParser lamp_args(
         "decode-reg lamp", "1.0", argparse::default_arguments::help);
@@ -208,7 +220,8 @@ int main(int argc, char *argv[])
 
     argparse::ArgumentParser *pargs;
     if (mode == "reset" || mode == "sdb" || mode == "pos_calc"
-        || mode == "fmc_active_clk" || mode == "fmc250m_4ch") {
+        || mode == "fofb_cc" || mode == "fmc_active_clk"
+        || mode == "fmc250m_4ch") {
         pargs = &parent_args_with_help;
     } else if (mode == "build_info") {
         pargs = &build_info_args;
@@ -415,8 +428,48 @@ int main(int argc, char *argv[])
         try_unsigned(ctl.data_trigger_channel, args, "-C");
         try_unsigned(ctl.trigger_delay, args, "-d");
 
-        auto res = ctl.result<int32_t>();
-        ctl.print_csv(stdout, res);
+        auto format = args.get<std::string>("-f");
+        if (format != "csv" && format != "binary" && format != "archive") {
+            fprintf(stderr, "Unknown output format '%s'\n", format.c_str());
+            return 1;
+        }
+        auto path = args.present<std::string>("-o");
+        if (format == "archive" && !path) {
+            fprintf(stderr, "Archive output needs a path\n");
+            return 1;
+        }
+        if (format != "archive" && path) {
+            fprintf(stderr, "Output path is only used for archive output\n");
+            return 1;
+        }
+        std::unique_ptr<acq::ArchiveWriter> archive;
+        if (path)
+            archive = std::make_unique<acq::ArchiveWriter>(*path);
+        auto num_threads = args.get<unsigned>("-j");
+
+        /* the element size follows the atom width, to avoid widening */
+        auto output = [&ctl, &format, &archive, num_threads](auto type) {
+            using Data = decltype(type);
+            auto res = ctl.result<Data>();
+            if (format == "binary")
+                ctl.write_binary(stdout, res);
+            else if (archive)
+                archive->append(ctl.get_shot_info(), archive->size(),
+                    std::span<const Data>(res));
+            else
+                ctl.print_csv(stdout, res, num_threads);
+        };
+        switch (ctl.get_atom_width()) {
+        case 8:
+            output(int8_t { });
+            break;
+        case 16:
+            output(int16_t { });
+            break;
+        default:
+            output(int32_t { });
+            break;
+        }
     }
     if (mode == "lamp") {
         lamp::Controller ctl { bars };
@@ -457,13 +510,58 @@ int main(int argc, char *argv[])
         }
 
         dec.get_data();
+        dec.print(stdout, false);
 
+        SpscRing<pos_calc::fifo_entry> ring(1024);
+        std::vector<pos_calc::fifo_entry> batch(ring.capacity());
+        uint64_t full = 0;
         while (true) {
-            while (dec.fifo_empty())
-                std::this_thread::sleep_for(50ms);
-            dec.get_fifo_amps();
+            if (!dec.drain_fifo(ring))
+                std::this_thread::sleep_for(1ms);
+
+            size_t n = ring.pop(batch.data(), batch.size());
+            for (size_t i = 0; i < n; i++) {
+                const auto &amps = batch[i].amps;
+                printf("AMPFIFO_MONIT_AMP: %u %u %u %u\n", amps[0], amps[1],
+                    amps[2], amps[3]);
+            }
 
-            dec.print(stdout, false);
+            auto stats = dec.get_fifo_stats();
+            if (stats.full != full) {
+                full = stats.full;
+                fprintf(stderr, "FIFO was full %" PRIu64 " times\n", full);
+            }
+        }
+    }
+    if (mode == "fofb_cc") {
+        fofb_cc::LinkMonitor mon(bars);
+        if (auto v = read_sdb(&bars, mon.match_devinfo_lambda, dev_index)) {
+            mon.set_devinfo(*v);
+        } else {
+            fprintf(
+                stderr, "Couldn't find fofb_cc module index %u\n", dev_index);
+            return 1;
+        }
+
+        while (true) {
+            auto rates = mon.update();
+            if (mon.size() > 1) {
+                for (unsigned i = 0; i < fofb_cc::num_links; i++) {
+                    const auto &l = rates[i];
+                    printf("LINK %u: %s, rx %.0f/s, tx %.0f/s, errors %u %u "
+                           "%u%s%s%s\n",
+                        i, l.up ? "up" : "down", l.rates[fofb_cc::rx_pck],
+                        l.rates[fofb_cc::tx_pck], l.deltas[fofb_cc::hard_err],
+                        l.deltas[fofb_cc::soft_err],
+                        l.deltas[fofb_cc::frame_err],
+                        l.anomalies & fofb_cc::link_lost ? ", LOST" : "",
+                        l.anomalies & fofb_cc::error_rate ? ", ERRORS" : "",
+                        l.anomalies & fofb_cc::packet_rate_drop ? ", DROP"
+                                                                : "");
+                }
+                fflush(stdout);
+            }
+            std::this_thread::sleep_for(1s);
         }
     }
     if (mode == "si57x") {
@@ -1,9 +1,17 @@
 #ifndef ACQ_H
 #define ACQ_H
 
+#include <array>
 #include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <thread>
 #include <variant>
 #include <vector>
 
@@ -35,6 +43,31 @@ enum class acq_error {
     no_samples,
 };
 
+/** Header written by Controller::write_binary() before the data, in native
+ * byte order */
+struct binary_header {
+    /** "UHALACQ" followed by a NUL character */
+    char magic[8];
+    uint32_t version;
+    /** Size of this header in bytes */
+    uint32_t header_size;
+    /** Size of each element in the data, which can be larger than the atoms */
+    uint32_t element_size;
+    uint32_t element_signed;
+    /** Atom width in bits, as reported by the hardware */
+    uint32_t atom_width;
+    uint32_t num_atoms;
+    uint32_t pre_samples;
+    uint32_t post_samples;
+    /** Address in device memory of the first post-trigger sample */
+    uint64_t trigger_pos;
+    /** When the acquisition was found to be complete, in nanoseconds since the
+     * Unix epoch */
+    int64_t timestamp_ns;
+    /** Size of the data following the header in bytes */
+    uint64_t data_size;
+};
+
 enum class acq_status {
     idle,
     success,
@@ -42,6 +75,22 @@ enum class acq_status {
     timeout,
 };
 
+/** Metadata for a completed acquisition */
+struct shot_info {
+    unsigned channel;
+    /** Channel description: internal width in bits, number of atoms and atom
+     * width in bits */
+    unsigned int_width, num_atoms, atom_width;
+    unsigned pre_samples, post_samples;
+    /** Address in device memory of the first post-trigger sample */
+    uint64_t trigger_pos;
+    /** When the acquisition was found to be complete, in nanoseconds since the
+     * Unix epoch */
+    int64_t timestamp_ns;
+};
+
+template <class Data> class ContinuousAcquisition;
+
 /** For most users, the Core class isn't relevant, since it simply provides the
  * current state of this core's registers, which doesn't reflect any hardware
  * state beyond the acquisition state machine. This class is the relevant one,
@@ -54,22 +103,64 @@ class Controller : public RegisterController {
     /* read from internal MemoryAllocator */
     size_t ram_start_addr, ram_end_addr;
 
+    /* the allocated memory can be split into regions, so one of them can be
+     * read while the acquisition is running on another */
+    unsigned num_regions = 1, region = 0;
+    /* region in use by the current acquisition */
+    size_t acq_start_addr, acq_end_addr;
+
+    /** Everything needed to read a completed acquisition from device memory,
+     * which stays valid after the core is re-armed into another region */
+    struct shot_desc {
+        size_t start_addr, end_addr, trigger_pos;
+        unsigned atom_width, num_atoms, sample_size, pre_samples,
+            post_samples;
+        /* only used to describe the acquisition */
+        unsigned channel, int_width;
+        std::chrono::system_clock::time_point timestamp;
+    };
+
     /* information from the current acquisition:
      * - current channel information
      * - current channel information that had to be calculated
      * - amount of samples */
-    unsigned channel_atom_width, channel_num_atoms, sample_size, alignment,
-        acq_pre_samples, acq_post_samples;
+    unsigned acq_channel, channel_int_width, channel_atom_width,
+        channel_num_atoms, sample_size, alignment, acq_pre_samples,
+        acq_post_samples;
 
     std::unique_ptr<struct acq_core> regs_storage;
     struct acq_core &regs;
+    /** Registers as they were last written into the device, used to skip
+     * rewriting the configuration when re-arming an identical acquisition */
+    std::unique_ptr<struct acq_core> written_regs;
 
     void get_internal_values();
     void encode_params() override;
     bool acquisition_ready();
+    /** Poll the status register, with wait_for_bits(), until the started
+     * acquisition completes or \p deadline passes. Returns true if the
+     * acquisition is done */
+    bool wait_acquisition(std::chrono::steady_clock::time_point deadline);
 
     void set_devinfo_callback() override;
 
+    /* information about the last acquisition read with get_result() */
+    shot_desc last_shot { };
+
+    void set_regions(unsigned);
+    shot_desc finish_shot();
+    /** Device memory segments ({address, bytes}) with the shot's data, in
+     * order; the second one is empty unless the data wraps around */
+    static std::array<std::array<size_t, 2>, 2> shot_segments(
+        const shot_desc &);
+    static shot_info to_info(const shot_desc &);
+    template <class Data> std::vector<Data> read_shot(const shot_desc &);
+    template <class Data>
+    std::vector<std::vector<Data>> read_shot_atoms(
+        const shot_desc &, const std::vector<double> &);
+
+    template <class Data> friend class ContinuousAcquisition;
+
     /* state variables for async */
     enum class acq_step {
         stop,
@@ -93,10 +184,24 @@ public:
     unsigned data_trigger_channel = 0;
     unsigned trigger_delay = 0;
 
+    /** Only writes the registers which differ from the ones written
+     * previously by this controller. The device isn't read back, so if it was
+     * reset or reconfigured by something else since then,
+     * forget_written_params() has to be called first */
+    void write_params() override;
+    /** Make the next write_params() write every register */
+    void forget_written_params();
+
     acq_error start_acquisition();
     void stop_acquisition();
 
     template <class Data> std::vector<Data> get_result();
+    /** Same as get_result(), but with one vector per atom. Data can also be
+     * float or double, in which case atom i is multiplied by scale[i], if
+     * scale isn't empty */
+    template <class Data>
+    std::vector<std::vector<Data>> get_result_atoms(
+        const std::vector<double> &scale = { });
 
     template <class Data>
     [[nodiscard]]
@@ -106,7 +211,116 @@ public:
     [[nodiscard]]
     acq_status get_acq_status();
 
-    template <typename T> void print_csv(FILE *f, std::vector<T> &res);
+    /** Atom width in bits for the current channel */
+    unsigned get_atom_width();
+    /** Metadata for the last acquisition read with get_result() */
+    shot_info get_shot_info();
+
+    template <typename T>
+    void print_csv(FILE *f, std::vector<T> &res, unsigned num_threads = 1);
+    /** Write a binary_header describing the last acquisition, followed by its
+     * raw data. Throws std::runtime_error if writing fails */
+    template <typename T>
+    void write_binary(FILE *f, const std::vector<T> &res);
+};
+
+/** Statistics from a ContinuousAcquisition */
+struct continuous_stats {
+    /** Acquisitions completed by the hardware */
+    uint64_t acquired = 0;
+    /** Acquisitions made available to pop() */
+    uint64_t delivered = 0;
+    /** Acquisitions discarded because the queue was full */
+    uint64_t dropped = 0;
+    /** Times the hardware had to wait for a region to be read */
+    uint64_t stalls = 0;
+};
+
+template <class Data> struct shot_result {
+    /** Sequence number, which allows detecting dropped acquisitions */
+    uint64_t sequence;
+    /** Time at which the acquisition was found to be complete, or was
+     * replayed */
+    std::chrono::steady_clock::time_point timestamp;
+    shot_info info;
+    std::vector<Data> data;
+};
+
+/** Interface for consumers of acquisition results, which allows the same code
+ * to process live and recorded data */
+template <class Data> class ShotSource {
+public:
+    virtual ~ShotSource() = default;
+
+    /** Get the next result, waiting for up to wait_time for one to be
+     * available. Returns std::nullopt when there are no more results */
+    virtual std::optional<shot_result<Data>> pop(
+        std::optional<std::chrono::milliseconds> wait_time = std::nullopt)
+        = 0;
+};
+
+/** Runs back-to-back acquisitions with a Controller, re-arming the core into
+ * another memory region as soon as an acquisition completes, while a separate
+ * thread reads the previous region out of the device. Results are delivered
+ * into a bounded queue.
+ *
+ * The Controller must already have its devinfo and acquisition parameters set,
+ * and must not be used by anyone else while the acquisition is running. */
+template <class Data> class ContinuousAcquisition : public ShotSource<Data> {
+public:
+    enum class overflow_policy {
+        /** Stop reading until there's space in the queue, which eventually
+         * stops the hardware from being re-armed */
+        block,
+        /** Discard the oldest result in the queue */
+        drop,
+    };
+
+private:
+    Controller &ctl;
+    const unsigned num_regions;
+    const size_t queue_size;
+    const overflow_policy policy;
+
+    std::mutex m;
+    std::condition_variable cv;
+    bool running = false;
+    std::vector<unsigned> free_regions;
+    struct pending_shot {
+        Controller::shot_desc desc;
+        unsigned region;
+        uint64_t sequence;
+        std::chrono::steady_clock::time_point timestamp;
+    };
+    std::deque<pending_shot> pending;
+    std::deque<shot_result<Data>> queue;
+    continuous_stats stats;
+    std::exception_ptr error;
+
+    std::thread acq_thread, read_thread;
+
+    bool is_running();
+    void acquire_loop();
+    void read_loop();
+    void set_error(std::exception_ptr);
+
+public:
+    ContinuousAcquisition(Controller &, unsigned num_regions = 2,
+        size_t queue_size = 4, overflow_policy = overflow_policy::drop);
+    ~ContinuousAcquisition() override;
+
+    void start();
+    /** Stops the acquisition and waits for the threads; results still in the
+     * queue can be obtained with pop() */
+    void stop();
+
+    /** Get the oldest result from the queue, waiting for up to wait_time for
+     * one to arrive. Errors from the acquisition threads are rethrown here */
+    std::optional<shot_result<Data>> pop(
+        std::optional<std::chrono::milliseconds> wait_time
+        = std::nullopt) override;
+
+    continuous_stats get_stats();
 };
 
 } /* namespace acq */
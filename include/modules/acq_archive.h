@@ -0,0 +1,141 @@
+#ifndef ACQ_ARCHIVE_H
+#define ACQ_ARCHIVE_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+
+#include "modules/acq.h"
+
+namespace acq {
+
+/** Header at the start of both the data and the index files of an archive, in
+ * native byte order */
+struct archive_file_header {
+    /** "UHALARC" for data files and "UHALIDX" for index files, followed by a
+     * NUL character */
+    char magic[8];
+    uint32_t version;
+    /** Offset of the first record or index entry */
+    uint32_t header_size;
+    /** Records in the data file start at multiples of this */
+    uint32_t record_alignment;
+    /** Size of each index entry */
+    uint32_t entry_size;
+    uint32_t reserved[2];
+};
+
+/** Header of each record in the data file, followed by its data */
+struct archive_record {
+    /** "UHALREC" followed by a NUL character */
+    char magic[8];
+    /** Size of this header in bytes, which is where the data starts */
+    uint32_t header_size;
+    /** Size of each element in the data, which can be larger than the atoms */
+    uint32_t element_size;
+    uint32_t element_signed;
+    uint32_t channel;
+    /** Channel description, as in shot_info */
+    uint32_t int_width, num_atoms, atom_width;
+    uint32_t pre_samples, post_samples;
+    uint32_t reserved;
+    uint64_t sequence;
+    int64_t timestamp_ns;
+    uint64_t trigger_pos;
+    /** Size of the data following the header in bytes */
+    uint64_t data_size;
+};
+
+/** Entry in the index file; entry i points to record i */
+struct archive_index_entry {
+    /** Offset of the record in the data file */
+    uint64_t offset;
+    /** Size of the record, including its header but not the padding */
+    uint64_t size;
+    uint64_t sequence;
+    int64_t timestamp_ns;
+};
+
+/** Appends acquisitions to an archive, which is made of a data file at the
+ * given path and an index file with the ".idx" suffix. Each record is padded
+ * to the record alignment and written with a single system call, and its index
+ * entry is only written afterwards, so an interrupted capture leaves a valid
+ * archive behind. Errors are reported with std::runtime_error. */
+class ArchiveWriter {
+    int fd = -1, idx_fd = -1;
+    /* end of the last record, including padding */
+    uint64_t data_end;
+    size_t num_records;
+
+public:
+    /** Creates the archive, or appends to it if it already exists. A file at
+     * path which isn't empty and isn't an archive is left untouched */
+    ArchiveWriter(const std::string &path);
+    ~ArchiveWriter();
+    ArchiveWriter(const ArchiveWriter &) = delete;
+    ArchiveWriter &operator=(const ArchiveWriter &) = delete;
+
+    template <class Data>
+    void append(
+        const shot_info &, uint64_t sequence, std::span<const Data> data);
+    template <class Data> void append(const shot_result<Data> &);
+
+    /** Number of records in the archive */
+    size_t size() const;
+};
+
+/** Maps an archive into memory, giving constant time access to any record
+ * without copying its data. Index entries for records which weren't completely
+ * written are ignored. */
+class ArchiveReader {
+    const unsigned char *data_map = nullptr;
+    size_t data_len = 0;
+    const unsigned char *idx_map = nullptr;
+    size_t idx_len = 0;
+    const archive_index_entry *entries = nullptr;
+    size_t num_records = 0;
+
+public:
+    ArchiveReader(const std::string &path);
+    ~ArchiveReader();
+    ArchiveReader(const ArchiveReader &) = delete;
+    ArchiveReader &operator=(const ArchiveReader &) = delete;
+
+    size_t size() const;
+    /** Throws std::out_of_range for invalid indexes and std::runtime_error for
+     * corrupted records */
+    const archive_record &record(size_t i) const;
+    shot_info info(size_t i) const;
+    /** Data for record i, pointing into the mapped file. Data must match the
+     * element type the record was written with */
+    template <class Data> std::span<const Data> data(size_t i) const;
+};
+
+/** Feeds the records from an archive through the same interface as
+ * ContinuousAcquisition, converting them to Data if necessary */
+template <class Data> class ArchiveReplay : public ShotSource<Data> {
+    const ArchiveReader &reader;
+    const bool paced;
+    size_t next = 0;
+    std::chrono::steady_clock::time_point start_time;
+    int64_t start_ns;
+
+public:
+    /** If paced is set, records are delivered with the same intervals between
+     * them as when they were captured; otherwise they are delivered as fast as
+     * possible */
+    ArchiveReplay(const ArchiveReader &, bool paced = false);
+
+    /** Returns std::nullopt at the end of the archive, or when paced and the
+     * next record isn't due within wait_time */
+    std::optional<shot_result<Data>> pop(
+        std::optional<std::chrono::milliseconds> wait_time
+        = std::nullopt) override;
+};
+
+} /* namespace acq */
+
+#endif
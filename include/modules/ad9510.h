@@ -1,6 +1,8 @@
 #ifndef AD9510_H
 #define AD9510_H
 
+#include <span>
+
 #include <modules/fmc_active_clk.h>
 #include <modules/spi.h>
 
@@ -15,7 +17,7 @@ class Controller {
     fmc_active_clk::Core fac_regs;
     mutable std::optional<struct sdb_device_info> fac_devinfo;
 
-    bool set_reg_ll(uint8_t, uint8_t);
+    bool set_reg_ll(uint8_t, uint8_t, spi::Channel = { 0 });
     bool update_parameters();
 
 public:
@@ -26,6 +28,14 @@ public:
 
     bool get_reg(uint8_t, uint8_t &, spi::Channel = { 0 });
     bool set_reg(uint8_t, uint8_t, spi::Channel = { 0 });
+    /** Access consecutive registers starting at \p addr, with as few SPI
+     * frames as possible. Writes are verified by reading the block back */
+    bool get_regs(uint8_t addr, std::span<uint8_t>, spi::Channel = { 0 });
+    bool set_regs(
+        uint8_t addr, std::span<const uint8_t>, spi::Channel = { 0 });
+    /** Execute a command sequence, such as the one used by set_defaults() */
+    spi::CommandResult run(
+        std::span<const spi::Command>, spi::Channel = { 0 });
 
     bool set_a_div(uint8_t);
     bool set_b_div(uint16_t);
@@ -6,6 +6,7 @@
 #include <vector>
 
 #include "controllers.h"
+#include "counter_rates.h"
 #include "decoders.h"
 
 namespace afc_timing {
@@ -19,11 +20,27 @@ class Core : public RegisterDecoder {
 
     void decode() override;
 
+    friend class RateMonitor;
+
 public:
     Core(struct pcie_bars &);
     ~Core() override;
 };
 
+/** Reads only the CH_COUNT registers of all channels, with a single burst
+ * per poll, and tracks their rates; counter i is channel i. poll() should be
+ * called periodically, e.g. from an IOC scan */
+class RateMonitor : public CounterRates {
+    Core &dec;
+    std::vector<uint32_t> burst, counts;
+
+public:
+    /** \p dec must already have its devinfo set */
+    RateMonitor(Core &dec, size_t history_size = 1024);
+
+    void poll();
+};
+
 class Controller : public RegisterDecoderController {
     std::unique_ptr<struct afc_timing> regs_storage;
     struct afc_timing &regs;
@@ -47,6 +64,8 @@ public:
 
     static const std::vector<std::string> sources_list;
 
+    struct config_layout get_config_layout() const override;
+
     bool set_rtm_freq(double);
     bool set_afc_freq(double);
 };
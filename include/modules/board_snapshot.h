@@ -0,0 +1,99 @@
+#ifndef BOARD_SNAPSHOT_H
+#define BOARD_SNAPSHOT_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "controllers.h"
+#include "pcie-defs.h"
+#include "sdb-defs.h"
+
+/** Saving and restoring the configuration of all cores on a board at once,
+ * using the configuration layouts from their controllers */
+namespace board_snapshot {
+
+/** Header at the start of a snapshot file, in native byte order. It's followed
+ * by each core, as a snapshot_file_core, its regions, its volatile bits and
+ * the contents of its regions */
+struct snapshot_file_header {
+    /** "UHALSNP" followed by a NUL character */
+    char magic[8];
+    uint32_t version;
+    /** Offset of the first core */
+    uint32_t header_size;
+    uint32_t num_cores;
+    uint32_t reserved;
+};
+
+struct snapshot_file_core {
+    uint64_t vendor_id;
+    uint32_t device_id;
+    uint8_t abi_ver_major, abi_ver_minor;
+    uint16_t index;
+    uint64_t start_addr;
+    uint32_t num_regions, num_volatile_bits;
+};
+
+/** Regions and volatile bits are stored as pairs of 32-bit values */
+struct snapshot_file_entry {
+    uint32_t offset, value;
+};
+
+/** Configuration of a single core */
+struct core_image {
+    /** SDB information for the core when it was saved */
+    struct sdb_device_info devinfo;
+    /** Enumerated position among the cores with the same vendor and device,
+     * which is how the core is found when restoring */
+    unsigned index;
+    struct config_layout layout;
+    /** Contents of the regions, one after the other, with the volatile bits
+     * cleared */
+    std::vector<uint32_t> data;
+};
+
+/** Core with a controller which doesn't describe its configuration layout */
+struct skipped_core {
+    std::string controller;
+    struct sdb_device_info devinfo;
+    unsigned index;
+};
+
+/** Read the configuration of every core found in the SDB which has a
+ * controller with a configuration layout, scanning the SDB only once. The
+ * other cores with controllers can't be saved, and are added to \p skipped if
+ * it isn't null */
+std::vector<core_image> take(
+    struct pcie_bars &, std::vector<skipped_core> *skipped = nullptr);
+
+/** Errors are reported with std::runtime_error */
+void save(const std::string &path, const std::vector<core_image> &);
+std::vector<core_image> load(const std::string &path);
+
+struct mismatch {
+    uint64_t addr;
+    uint32_t expected, read;
+};
+
+struct restore_report {
+    size_t cores, words, bursts;
+    /** Time spent writing, and reading back the written registers */
+    std::chrono::nanoseconds write_time, verify_time;
+    /** Registers whose configuration bits didn't read back as written, with
+     * the volatile bits cleared in both values */
+    std::vector<mismatch> mismatches;
+};
+
+/** Write a snapshot into a board whose cores have the same ABI versions as
+ * when it was taken, which is checked before anything is written. Only the
+ * configuration regions are written, without volatile bits, as bursts sorted
+ * by address, after which the same bursts are read back and compared. Throws
+ * std::runtime_error if a core is missing or has a different version */
+struct restore_report restore(
+    struct pcie_bars &, const std::vector<core_image> &);
+
+} /* namespace board_snapshot */
+
+#endif
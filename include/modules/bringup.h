@@ -0,0 +1,44 @@
+#ifndef BRINGUP_H
+#define BRINGUP_H
+
+#include <optional>
+#include <vector>
+
+#include "pcie-defs.h"
+#include "step_graph.h"
+
+namespace bringup {
+
+struct board_config {
+    /** Startup frequency of the si57x, used by read_startup_regs() */
+    double si57x_fstartup = 0;
+    /** Frequency programmed into the si57x, which is left alone if unset */
+    std::optional<double> si57x_freq;
+};
+
+/** Steps to bring up the clock and ADC chips found in a board's SDB:
+ * - the si57x, if si57x_freq is set;
+ * - each FMC_ACTIVE_CLK core and its AD9510, after the si57x;
+ * - each FMC250M_4CH core, after all of the above.
+ *
+ * The returned graph refers to \p bars, which must outlive it. */
+StepGraph make_board_steps(struct pcie_bars &bars, const board_config &);
+
+struct board_report {
+    /** Time spent scanning the SDB and building the steps, before the first
+     * step started */
+    std::chrono::steady_clock::duration setup;
+    std::vector<StepGraph::step_report> steps;
+    /** Indexes into #steps, as returned by StepGraph::critical_path() */
+    std::vector<size_t> critical_path;
+};
+
+/** Bring up all boards at the same time, with one thread per board, which
+ * builds and runs that board's steps. Step times are measured from the start
+ * of this function, so they can be compared across boards */
+std::vector<board_report> bring_up(
+    const std::vector<struct pcie_bars *> &, const board_config &);
+
+} /* namespace bringup */
+
+#endif
@@ -30,6 +30,8 @@ class Controller : public RegisterDecoderController {
 public:
     Controller(struct pcie_bars &);
     ~Controller();
+
+    struct config_layout get_config_layout() const override;
 };
 
 } /* namespace fmc_active_clk */
@@ -1,7 +1,11 @@
 #ifndef FOFB_CC_H
 #define FOFB_CC_H
 
+#include <array>
+#include <chrono>
+#include <cstdint>
 #include <memory>
+#include <vector>
 
 #include "controllers.h"
 #include "decoders.h"
@@ -48,6 +52,84 @@ public:
     void write_params() override;
 };
 
+constexpr unsigned num_links = 8;
+
+enum link_counter {
+    hard_err,
+    soft_err,
+    frame_err,
+    rx_pck,
+    tx_pck,
+    num_link_counters,
+};
+
+/** Link counters read by LinkMonitor::update() */
+struct link_sample {
+    std::chrono::steady_clock::time_point timestamp;
+    uint32_t link_up, time_frame_cnt;
+    std::array<std::array<uint32_t, num_links>, num_link_counters> counters;
+};
+
+enum link_anomaly : unsigned {
+    /** The link went down since the previous sample */
+    link_lost = 1 << 0,
+    /** The error rate (hard, soft and frame errors) is above the limit */
+    error_rate = 1 << 1,
+    /** The received packet rate dropped below a fraction of its average
+     * during the whole history */
+    packet_rate_drop = 1 << 2,
+};
+
+struct link_rates {
+    bool up;
+    /** Counter increments per second since the previous sample */
+    std::array<double, num_link_counters> rates;
+    /** Counter increments since the previous sample */
+    std::array<uint32_t, num_link_counters> deltas;
+    /** link_anomaly flags */
+    unsigned anomalies;
+};
+
+/** Keeps a history of link samples, from which it computes rates and detects
+ * anomalies. It doesn't access the hardware, so samples can come from
+ * anywhere. Counters may wrap around; a counter going back by more than half
+ * its range is considered to have been cleared. */
+class LinkStats {
+    std::vector<link_sample> history;
+    /* position for the next sample, and number of valid samples */
+    size_t head = 0, count = 0;
+
+public:
+    LinkStats(size_t history_size = 64);
+
+    struct {
+        /** Errors per second above which error_rate is flagged */
+        double max_error_rate = 0;
+        /** Fraction of the average received packet rate below which
+         * packet_rate_drop is flagged */
+        double packet_drop_ratio = 0.5;
+    } limits;
+
+    /** Add a sample, returning the rates for each link since the previous
+     * one. The first sample only reports whether the links are up */
+    std::array<link_rates, num_links> add(const link_sample &);
+
+    /** Number of samples in the history */
+    size_t size() const;
+    /** Sample from the history, 0 being the newest */
+    const link_sample &sample(size_t age) const;
+};
+
+/** Reads only the link status counters, in a single burst, without going
+ * through the register decoding, and keeps their history in LinkStats */
+class LinkMonitor : public RegisterDecoderBase, public LinkStats {
+public:
+    LinkMonitor(struct pcie_bars &, size_t history_size = 64);
+
+    /** Take a new sample and add it to the history */
+    std::array<link_rates, num_links> update();
+};
+
 } /* namespace fofb_cc */
 
 #endif
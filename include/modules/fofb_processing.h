@@ -7,6 +7,8 @@
 #include "controllers.h"
 #include "decoders.h"
 
+class MatrixFile;
+
 namespace fofb_processing {
 
 /* forward declaration */
@@ -35,13 +37,17 @@ protected:
 
     void set_devinfo_callback() override;
     void encode_params() override;
+    void check_ref_orb() const;
+    void encode_ref_orb();
 
-    unsigned fixed_point_coeff, fixed_point_gains;
+    unsigned fixed_point_coeff = 0, fixed_point_gains = 0;
 
 public:
     Controller(struct pcie_bars &);
     ~Controller();
 
+    struct config_layout get_config_layout() const override;
+
     bool intlk_sta_clr = false, intlk_en_orb_distort = false,
          intlk_en_packet_loss = false;
     unsigned orb_distort_limit = 0, min_num_packets = 0;
@@ -59,6 +65,27 @@ public:
     std::vector<struct parameters> parameters;
 
     void write_params() override;
+
+    /** Write only ref_orb_x and ref_orb_y into the device, skipping the
+     * coefficients and the other registers written by write_params() */
+    void write_ref_orb();
+
+    struct ref_orb_change {
+        unsigned bpm;
+        int32_t value;
+    };
+    /** Apply the changes to ref_orb_x and ref_orb_y, and write only the values
+     * which differ from the ones in the device, grouping neighbouring values
+     * into a single write */
+    void update_ref_orb(const std::vector<ref_orb_change> &x,
+        const std::vector<ref_orb_change> &y);
+
+    /** Write the coefficients for the first rows() channels straight from a
+     * matrix file, with one row per channel: the coefficients for x followed
+     * by the ones for y. Fixed point files must use the core's
+     * FIXED_POINT_POS_COEFF, and are written without any conversion. The
+     * coefficients in #parameters are updated to match */
+    void write_coefficients(const MatrixFile &);
 };
 
 } /* namespace fofb_processing */
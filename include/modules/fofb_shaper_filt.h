@@ -4,6 +4,7 @@
 #include <memory>
 #include <vector>
 
+#include "biquad.h"
 #include "controllers.h"
 #include "decoders.h"
 
@@ -41,17 +42,32 @@ protected:
     struct wb_fofb_shaper_filt_regs &regs;
 
     unsigned fixed_point_coeff, num_biquads;
+    /** Channels whose coefficients differ from the ones in the device */
+    uint32_t changed_channels = 0;
 
     void set_devinfo_callback() override;
     void encode_params() override;
+    void write_channels(uint32_t);
 
 public:
     Controller(struct pcie_bars &);
     ~Controller();
 
+    struct config_layout get_config_layout() const override;
+
+    /** Write the coefficients of all channels, with a single burst per
+     * channel */
     void write_params() override;
+    /** Write only the channels whose coefficients changed since they were
+     * last read or written. The device isn't read again, so after it's reset
+     * or reloaded, write_params() or set_devinfo() has to be used first */
+    void write_changed_params();
 
     filter_coefficients coefficients;
+
+    /** Simulator for the filters with the current coefficients, as quantized
+     * by the device, for signals in \p signal_format */
+    BiquadCascade make_simulator(fixed_point_format signal_format) const;
 };
 
 } /* namespace fofb_shaper_filt */
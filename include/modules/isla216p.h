@@ -1,6 +1,8 @@
 #ifndef ISLA216P_H
 #define ISLA216P_H
 
+#include <span>
+
 #include <modules/fmc250m_4ch.h>
 #include <modules/spi.h>
 
@@ -22,6 +24,12 @@ public:
 
     bool get_reg(uint8_t, uint8_t &, spi::Channel);
     bool set_reg(uint8_t, uint8_t, spi::Channel);
+    /** Access consecutive registers starting at \p addr, with as few SPI
+     * frames as possible */
+    bool get_regs(uint8_t addr, std::span<uint8_t>, spi::Channel);
+    bool set_regs(uint8_t addr, std::span<const uint8_t>, spi::Channel);
+    /** Execute a command sequence, such as a chip initialization table */
+    spi::CommandResult run(std::span<const spi::Command>, spi::Channel);
     bool set_defaults(spi::Channel);
 };
 
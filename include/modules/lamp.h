@@ -1,9 +1,16 @@
 #ifndef LAMP_H
 #define LAMP_H
 
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "controllers.h"
 #include "decoders.h"
@@ -14,6 +21,35 @@ struct wb_rtmlamp_ohwr_regs;
 
 extern const std::vector<std::string> mode_list;
 
+constexpr unsigned num_channels = 12;
+
+enum class setpoint_type {
+    /** Used in open loop modes */
+    dac,
+    /** Used in closed loop modes */
+    pi_sp,
+};
+
+/** Identifies a setpoint register; it's validated once when created by
+ * Controller::get_setpoint_handle(), so setting a value through it doesn't
+ * need any lookups */
+class SetpointHandle {
+    unsigned channel;
+    setpoint_type type;
+
+    SetpointHandle(unsigned channel, setpoint_type type)
+        : channel(channel)
+        , type(type)
+    {
+    }
+
+    friend class Controller;
+
+public:
+    unsigned get_channel() const { return channel; }
+    setpoint_type get_type() const { return type; }
+};
+
 class Core : public RegisterDecoder {
     std::unique_ptr<struct wb_rtmlamp_ohwr_regs> regs_storage;
     struct wb_rtmlamp_ohwr_regs &regs;
@@ -31,11 +67,85 @@ class Controller : public RegisterDecoderController {
 
     Core dec;
 
+    /* channels with setpoints staged by set_setpoint(), one bit per
+     * channel */
+    uint32_t dirty_dac = 0, dirty_pi_sp = 0;
+
+    void set_devinfo_callback() override;
     void unset_commands() override;
 
 public:
     Controller(struct pcie_bars &);
     virtual ~Controller();
+
+    struct config_layout get_config_layout() const override;
+
+    SetpointHandle get_setpoint_handle(unsigned channel, setpoint_type);
+    /** Stage a setpoint to be written by write_setpoints(); values equal to
+     * the last one written are skipped */
+    void set_setpoint(SetpointHandle, int16_t value);
+    /** Write only the staged setpoints into the device, with one write per
+     * touched channel, without going through write_params() */
+    void write_setpoints();
+};
+
+struct jitter_stats {
+    /** Samples written */
+    uint64_t samples = 0;
+    /** Samples skipped because the thread was late by more than a period */
+    uint64_t missed = 0;
+    /** Time between each sample's scheduled time and the start of its
+     * write */
+    std::chrono::nanoseconds mean_lateness { }, rms_lateness { },
+        max_lateness { };
+    /** Longest time taken by write_setpoints() */
+    std::chrono::nanoseconds max_write_time { };
+    /** Whether the thread got real time priority */
+    bool realtime = false;
+};
+
+/** Clocks preloaded tables out to setpoint registers at a fixed period, from
+ * a thread which tries to get real time priority. Sample i of every table is
+ * written at start time + i * period; samples whose time has already passed
+ * are skipped, so a late thread doesn't shift the rest of the waveform.
+ *
+ * The Controller must not be used by anyone else while the player is
+ * running. */
+class WaveformPlayer {
+    Controller &ctl;
+    const std::vector<SetpointHandle> handles;
+    const std::vector<std::vector<int16_t>> tables;
+    const std::chrono::nanoseconds period;
+    const bool loop;
+
+    std::mutex m;
+    std::condition_variable cv;
+    bool running = false;
+    jitter_stats stats;
+    /* sums for the mean and RMS lateness, in nanoseconds */
+    double lateness_sum = 0, lateness_sum_sq = 0;
+    std::exception_ptr error;
+
+    std::thread play_thread;
+
+    void play_loop();
+
+public:
+    /** There must be one table per handle, all with the same size */
+    WaveformPlayer(Controller &, std::vector<SetpointHandle> handles,
+        std::vector<std::vector<int16_t>> tables,
+        std::chrono::nanoseconds period, bool loop = true);
+    ~WaveformPlayer();
+
+    void start();
+    /** Stops the player and waits for its thread */
+    void stop();
+    /** Whether the player is still running, which stops being the case at
+     * the end of the tables when not looping, or after an error */
+    bool is_running();
+
+    /** Errors from the player thread are rethrown here */
+    jitter_stats get_stats();
 };
 
 } /* namespace lamp */
@@ -1,7 +1,18 @@
 #ifndef ORBIT_INTLK_H
 #define ORBIT_INTLK_H
 
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
 
 #include "controllers.h"
 #include "decoders.h"
@@ -17,6 +28,8 @@ class Core : public RegisterDecoder {
 
     void decode() override;
 
+    friend class Watcher;
+
 public:
     Core(struct pcie_bars &);
     ~Core() override;
@@ -33,6 +46,8 @@ public:
     Controller(struct pcie_bars &);
     ~Controller();
 
+    struct config_layout get_config_layout() const override;
+
     bool enable { }, clear { };
     bool min_sum_enable { };
     bool pos_enable { }, pos_clear { }, ang_enable { }, ang_clear { };
@@ -42,6 +57,103 @@ public:
     int32_t pos_min_x { }, pos_min_y { }, ang_min_x { }, ang_min_y { };
 };
 
+/** Names, as used by Core, of the flags set in a STS register value */
+std::vector<std::string_view> status_flags(uint32_t sts);
+
+struct core_snapshot {
+    std::string name;
+    /** Output of the core's print() right after the trip was seen */
+    std::string text;
+};
+
+struct intlk_event {
+    /** Starts at 1 and increases by one for each event */
+    uint64_t sequence;
+    /** Time of the poll which saw the transition, which happened at most
+     * #window earlier */
+    std::chrono::system_clock::time_point timestamp;
+    std::chrono::nanoseconds window;
+    /** STS register before and after the transition */
+    uint32_t previous, current;
+    /** Instantaneous position and angle differences, read right after the
+     * transition */
+    int32_t pos_x, pos_y, ang_x, ang_y;
+    /** Whether the interlock tripped in this transition */
+    bool trip;
+    /** State of the snapshot cores, only for trips */
+    std::vector<core_snapshot> snapshots;
+
+    uint32_t set_bits() const { return current & ~previous; }
+    uint32_t cleared_bits() const { return previous & ~current; }
+};
+
+struct watcher_stats {
+    uint64_t polls = 0;
+    uint64_t events = 0;
+    /** Longest time between two polls, which bounds the timestamp error */
+    std::chrono::nanoseconds max_interval { };
+};
+
+/** Polls only the STS register of an orbit interlock core, from its own
+ * thread, and records every change of its value as an event. The last events
+ * are kept in a history, from which subscribers can read them, being woken up
+ * either by an eventfd or by wait_events().
+ *
+ * The state found by the first poll is reported as a transition from 0, so a
+ * trip latched before start() isn't missed. */
+class Watcher {
+    Core &dec;
+    const std::chrono::nanoseconds poll_period;
+    const size_t history_size;
+    std::vector<std::pair<std::string, RegisterDecoder *>> snapshot_cores;
+
+    std::mutex m;
+    std::condition_variable cv;
+    bool running = false;
+    std::deque<intlk_event> history;
+    watcher_stats stats;
+    std::vector<int> eventfds;
+    std::exception_ptr error;
+
+    std::thread watch_thread;
+
+    void watch_loop();
+    void notify(intlk_event &&);
+    std::vector<intlk_event> events_after(uint64_t sequence) const;
+
+public:
+    /** \p dec must already have its devinfo set */
+    Watcher(Core &dec,
+        std::chrono::nanoseconds poll_period = std::chrono::microseconds(100),
+        size_t history_size = 1024);
+    ~Watcher();
+
+    /** Read and print \p dec on every trip, for post-mortem analysis; this
+     * delays the next poll by the time it takes. The decoder must have its
+     * devinfo set, and must not be used by anyone else while the watcher is
+     * running */
+    void add_snapshot(std::string name, RegisterDecoder &dec);
+
+    void start();
+    /** Stops polling and waits for the thread; the history is kept */
+    void stop();
+
+    /** Create an eventfd which is incremented by the number of new events,
+     * and is closed by unsubscribe() or by the destructor */
+    int subscribe();
+    void unsubscribe(int fd);
+
+    /** Events in the history which are newer than \p sequence */
+    std::vector<intlk_event> get_events(uint64_t sequence = 0);
+    /** Same as get_events(), but waits up to \p wait_time for a new event
+     * if there aren't any. Errors from the watcher thread are rethrown
+     * here */
+    std::vector<intlk_event> wait_events(
+        uint64_t sequence, std::chrono::milliseconds wait_time);
+
+    watcher_stats get_stats();
+};
+
 } /* namespace orbit_intlk */
 
 #endif
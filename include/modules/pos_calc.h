@@ -1,12 +1,16 @@
 #ifndef POS_CALC_H
 #define POS_CALC_H
 
+#include <array>
 #include <chrono>
+#include <cstdint>
 #include <memory>
 #include <vector>
 
 #include "controllers.h"
 #include "decoders.h"
+#include "position.h"
+#include "ring.h"
 
 namespace pos_calc {
 
@@ -15,6 +19,24 @@ using namespace std::chrono_literals;
 /* forward declaration */
 struct pos_calc;
 
+/** Entry drained from the amplitude FIFO */
+struct fifo_entry {
+    /** Time at which the burst containing this entry was read */
+    std::chrono::steady_clock::time_point timestamp;
+    std::array<uint32_t, 4> amps;
+};
+
+/** Counters for Core::drain_fifo() */
+struct fifo_stats {
+    uint64_t bursts = 0;
+    uint64_t entries = 0;
+    /** Bursts in which the FIFO was found full, which means the hardware may
+     * have discarded entries */
+    uint64_t full = 0;
+    /** Entries discarded because they didn't fit in the ring */
+    uint64_t ring_overflows = 0;
+};
+
 class Core : public RegisterDecoder {
     std::unique_ptr<struct pos_calc> regs_storage;
     struct pos_calc &regs;
@@ -27,12 +49,27 @@ class Core : public RegisterDecoder {
     void read_fifo_amps();
     void decode_fifo_amps();
 
+    fifo_stats stats;
+
 public:
     Core(struct pcie_bars &);
     ~Core() override;
 
     bool fifo_empty();
     void get_fifo_amps();
+
+    /** Read the amount of entries in the FIFO once, then read all of them in a
+     * single burst and push them into \p ring, bypassing the decoding. Returns
+     * the number of entries read. Must be called from the ring's producer
+     * thread */
+    size_t drain_fifo(SpscRing<fifo_entry> &ring);
+    /** Counters for drain_fifo(); same thread restrictions apply */
+    fifo_stats get_fifo_stats();
+
+    /** Parameters for compute_positions(), from the values decoded by the last
+     * get_data() call. \p direct selects the gains and offsets for RFFE switch
+     * state 1 (direct) instead of state 0 (inverted) */
+    position_params get_position_params(bool direct = false) const;
 };
 
 class Controller : public RegisterDecoderController {
@@ -45,6 +82,8 @@ public:
     Controller(struct pcie_bars &);
     ~Controller();
 
+    struct config_layout get_config_layout() const override;
+
     void write_params() override;
 };
 
@@ -40,8 +40,9 @@ class Controller : public RegisterDecoderController {
 
     /** Update all registers and return state of busy flag. */
     bool get_busy();
-    /** Loop until timeout while busy, return immediately otherwise. Updates all
-     * registers every iteration. Returns the final state of the busy flag. */
+    /** Poll the status register until the busy flag clears or a timeout
+     * expires, with wait_for_bits(). Updates all registers at the end. Returns
+     * the final state of the busy flag. */
     bool still_busy();
 
 public:
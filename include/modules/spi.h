@@ -2,6 +2,10 @@
 #define SPI_H
 
 #include <memory>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
 
 #include "controllers.h"
 #include "decoders.h"
@@ -46,12 +50,86 @@ public:
     Controller(struct pcie_bars &);
     ~Controller();
 
+    /** Largest frame, in bytes, using all four TX/RX registers */
+    static constexpr size_t MAX_FRAME_SIZE = 16;
+
     void set_defaults();
 
+    /** Send \p wsize bytes from \p wdata and then read \p rsize bytes into
+     * \p rdata, all in a single frame of at most MAX_FRAME_SIZE bytes. Only
+     * the registers needed for the frame are accessed, and the registers
+     * last written by write_params() are assumed to be unchanged. Returns
+     * false if the core stays busy for too long */
     bool write_read_data(const unsigned char *, size_t, unsigned char *, size_t,
         Channel = { 0 });
 };
 
+/** One entry of a chip's command sequence */
+struct Command {
+    enum class Op : uint8_t {
+        /** Write \p value into \p reg, optionally verifying it */
+        write,
+        /** Read \p reg into CommandResult::reads */
+        read,
+        /** Poll \p reg until it reads as \p value */
+        wait,
+    } op;
+    uint8_t reg, value;
+    bool verify;
+};
+
+constexpr Command write_reg(uint8_t reg, uint8_t value, bool verify = true)
+{
+    return { Command::Op::write, reg, value, verify };
+}
+constexpr Command read_reg(uint8_t reg)
+{
+    return { Command::Op::read, reg, 0, false };
+}
+constexpr Command wait_reg(uint8_t reg, uint8_t value)
+{
+    return { Command::Op::wait, reg, value, false };
+}
+
+struct CommandResult {
+    /** Index of the command whose transfer failed or whose wait timed out;
+     * the commands after it weren't executed */
+    std::optional<size_t> failed;
+    /** Index of each write whose verification failed, with the value read */
+    std::vector<std::pair<size_t, uint8_t>> mismatches;
+    /** Values obtained by the read commands, in order */
+    std::vector<uint8_t> reads;
+
+    bool ok() const { return !failed && mismatches.empty(); }
+};
+
+/** Register access for chips using the 16-bit instruction from Analog Devices
+ * and Intersil parts, in MSB first mode: a read/write bit, the transfer size
+ * in W1:W0 and the register address, which is decremented after each data
+ * byte. */
+class CommandQueue {
+    Controller &ctl;
+    Channel channel;
+    size_t max_block;
+
+public:
+    /** \p max_block is the most data bytes the chip accepts in one transfer:
+     * 1 to 4 are encoded in W1:W0, and more require the chip to treat the
+     * last encoding as streaming mode */
+    CommandQueue(Controller &, Channel, size_t max_block);
+
+    /** Access consecutive registers starting at \p addr, in as few frames as
+     * possible */
+    bool read_block(uint8_t addr, std::span<uint8_t>);
+    bool write_block(uint8_t addr, std::span<const uint8_t>);
+
+    /** Execute \p commands back to back. Writes to consecutive increasing
+     * registers are merged into a single frame, and verifications are done
+     * at the end, by reading back the last value written into each register
+     * in as few blocks as possible */
+    CommandResult run(std::span<const Command> commands);
+};
+
 } /* namespace spi */
 
 #endif
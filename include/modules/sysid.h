@@ -2,10 +2,12 @@
 #define SYS_ID_H
 
 #include <memory>
+#include <span>
 #include <vector>
 
 #include "controllers.h"
 #include "decoders.h"
+#include "prbs.h"
 
 namespace sys_id {
 
@@ -44,10 +46,16 @@ protected:
     void set_devinfo_callback() override;
     void encode_params() override;
 
+    /** Pack the setpoint and position distortion levels in the format used
+     * by the device */
+    void pack_distortion(std::span<uint32_t>, std::span<uint32_t>) const;
+
 public:
     Controller(struct pcie_bars &);
     ~Controller();
 
+    struct config_layout get_config_layout() const override;
+
     /** First BPM ID whose position will be stored in SYSID acquisitions;
      * MAX_NUM_CTE BPMs will be stored */
     uint8_t base_bpm_id = 0;
@@ -71,6 +79,14 @@ public:
     distortion_levels posx_distortion;
     /** Distortion levels to apply on Y position for each PRBS state */
     distortion_levels posy_distortion;
+
+    /** Correlator for the PRBS generated with the current parameters, for
+     * acquisitions of up to \p max_samples */
+    PrbsCorrelator make_correlator(size_t max_samples) const;
+
+    /** Write only the distortion levels into the device, skipping the values
+     * which haven't changed since they were last read or written */
+    void write_distortion();
 };
 
 } /* namespace sys_id */
@@ -6,6 +6,7 @@
 #include <vector>
 
 #include "controllers.h"
+#include "counter_rates.h"
 #include "decoders.h"
 
 namespace trigger_iface {
@@ -19,11 +20,29 @@ class Core : public RegisterDecoder {
 
     void decode() override;
 
+    friend class RateMonitor;
+
 public:
     Core(struct pcie_bars &);
     ~Core();
 };
 
+/** Reads only the count registers of all channels, with a single burst per
+ * poll, and tracks their rates; counter 2 * i is RCV_COUNT for channel i,
+ * and counter 2 * i + 1 is TRANSM_COUNT. poll() should be called
+ * periodically, e.g. from an IOC scan, often enough that the 16 bit counters
+ * don't wrap around between polls */
+class RateMonitor : public CounterRates {
+    Core &dec;
+    std::vector<uint32_t> burst, counts;
+
+public:
+    /** \p dec must already have its devinfo set */
+    RateMonitor(Core &dec, size_t history_size = 1024);
+
+    void poll();
+};
+
 class Controller : public RegisterController {
 protected:
     std::unique_ptr<struct trigger_iface_regs> regs_storage;
@@ -36,6 +55,7 @@ public:
     ~Controller();
 
     void write_params() override;
+    struct config_layout get_config_layout() const override;
 
     struct parameters {
         /* rcv_count_rst and transm_count_rst are cleared automatically */
@@ -35,6 +35,8 @@ public:
     Controller(struct pcie_bars &);
     ~Controller();
 
+    struct config_layout get_config_layout() const override;
+
     struct parameters {
         std::optional<bool> rcv_src, transm_src;
         std::optional<uint8_t> rcv_in_sel, transm_out_sel;
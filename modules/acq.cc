@@ -1,16 +1,21 @@
 #include <array>
 #include <bit>
-#include <charconv>
+#include <cerrno>
 #include <cstring>
 #include <ranges>
 #include <stdexcept>
 #include <thread>
 #include <type_traits>
 
+#include <unistd.h>
+
+#include "csv.h"
+#include "deinterleave.h"
 #include "modules/acq.h"
 #include "pcie.h"
 #include "printer.h"
 #include "util.h"
+#include "wait_bits.h"
 
 namespace {
 
@@ -54,10 +59,23 @@ namespace acq {
 #define MAX_NUM_CHAN 24
 #define REGISTERS_PER_CHAN 2
 
+static_assert(sizeof(struct acq_core) == ACQ_CORE_SIZE);
+static_assert(sizeof(struct binary_header) == 64);
+static_assert(ACQ_CORE_CH0_DESC + MAX_NUM_CHAN * REGISTERS_PER_CHAN * 4
+    == ACQ_CORE_SIZE);
+
 namespace {
     const unsigned ddr3_payload_size = 32;
+    /* regions have to hold an integer number of samples of any size */
+    const size_t region_alignment = 1024 * 1024;
     using namespace std::chrono_literals;
     const auto acq_loop_time = 1ms;
+    /* status reads start fast, for short acquisitions, and slow down to one
+     * every acq_loop_time */
+    const backoff_policy acq_backoff
+        = { .initial = 10us, .max = acq_loop_time };
+    /* how often continuous acquisitions check if they were stopped */
+    const auto stop_check_time = 10ms;
 
     constexpr unsigned ACQ_DEVID = 0x4519a0ad;
     struct sdb_device_info ref_devinfo = {
@@ -264,17 +282,38 @@ Controller::Controller(struct pcie_bars &bars)
     auto addrs = MemoryAllocator::get_memory_allocator().get_range(bars);
     ram_start_addr = addrs[0];
     ram_end_addr = addrs[1];
+    acq_start_addr = ram_start_addr;
+    acq_end_addr = ram_end_addr;
 }
 Controller::~Controller() = default;
 
 void Controller::set_devinfo_callback()
 {
+    /* the channel descriptors are constant for a given gateware, so they can be
+     * read only once, in a single burst, along with the number of channels */
+    bar4_read_v(&bars, addr + ACQ_CORE_ACQ_CHAN_CTL, &regs.acq_chan_ctl,
+        ACQ_CORE_SIZE - ACQ_CORE_ACQ_CHAN_CTL);
+
+    /* nothing is known about the device's configuration yet */
+    written_regs.reset();
+
     /* we want a consistent view of the world, and that includes no acquisitions
      * we don't know about. it's too complicated to gather information about
      * running acquisitions, as well, so that's not supported for now */
     stop_acquisition();
 }
 
+void Controller::set_regions(unsigned n)
+{
+    if (n == 0 || (ram_end_addr - ram_start_addr) / n < region_alignment)
+        throw std::logic_error(
+            "can't split acquisition memory into " + std::to_string(n)
+            + " regions");
+
+    num_regions = n;
+    region = 0;
+}
+
 struct BadSampleSize : std::logic_error {
     using std::logic_error::logic_error;
 };
@@ -305,13 +344,27 @@ struct NoSamples : std::runtime_error {
 
 void Controller::get_internal_values()
 {
-    uint32_t channel_desc
-        = bar4_read(&bars, addr + ACQ_CORE_CH0_DESC + 8 * channel);
+    unsigned num_chan = extract_value<uint32_t>(
+        regs.acq_chan_ctl, ACQ_CORE_ACQ_CHAN_CTL_NUM_CHAN_MASK);
+    if (channel >= num_chan || channel >= MAX_NUM_CHAN)
+        throw std::runtime_error("channel " + std::to_string(channel)
+            + " doesn't exist, core has " + std::to_string(num_chan)
+            + " channels");
+
+    /* descriptors were cached by set_devinfo_callback(); the same layout
+     * assumptions from Core::decode() apply here */
+    uint32_t p[MAX_NUM_CHAN * REGISTERS_PER_CHAN];
+    memcpy(p, &regs.ch0_desc, sizeof p);
+
+    uint32_t channel_desc = p[channel * REGISTERS_PER_CHAN];
     uint32_t num_coalesce = extract_value<uint32_t>(
         channel_desc, ACQ_CORE_CH0_DESC_NUM_COALESCE_MASK);
     uint32_t int_width = extract_value<uint32_t>(
         channel_desc, ACQ_CORE_CH0_DESC_INT_WIDTH_MASK);
 
+    acq_channel = channel;
+    channel_int_width = int_width;
+
     /* int_width is in bits, so needs to be converted to bytes */
     sample_size = (int_width / 8) * num_coalesce;
     if (std::popcount(sample_size) != 1)
@@ -321,8 +374,7 @@ void Controller::get_internal_values()
         ? ddr3_payload_size / sample_size
         : 1;
 
-    uint32_t channel_atom_desc
-        = bar4_read(&bars, addr + ACQ_CORE_CH0_ATOM_DESC + 8 * channel);
+    uint32_t channel_atom_desc = p[channel * REGISTERS_PER_CHAN + 1];
     channel_atom_width = extract_value<uint32_t>(
         channel_atom_desc, ACQ_CORE_CH0_ATOM_DESC_ATOM_WIDTH_MASK);
     channel_num_atoms = extract_value<uint32_t>(
@@ -337,6 +389,16 @@ void Controller::encode_params()
 {
     get_internal_values();
     acq_pre_samples = pre_samples;
+
+    if (num_regions == 1) {
+        acq_start_addr = ram_start_addr;
+        acq_end_addr = ram_end_addr;
+    } else {
+        const size_t region_size = (ram_end_addr - ram_start_addr)
+            / num_regions / region_alignment * region_alignment;
+        acq_start_addr = ram_start_addr + region * region_size;
+        acq_end_addr = acq_start_addr + region_size;
+    }
     acq_post_samples = post_samples;
 
     clear_and_insert(
@@ -369,7 +431,7 @@ void Controller::encode_params()
     const size_t post_samples_aligned
         = align_extend(post_samples, alignment, trigger_type == "now");
 
-    const size_t max_samples = (ram_end_addr - ram_start_addr) / sample_size;
+    const size_t max_samples = (acq_end_addr - acq_start_addr) / sample_size;
     if (pre_samples_aligned + post_samples_aligned >= max_samples)
         throw TooManySamples();
 
@@ -405,9 +467,51 @@ void Controller::encode_params()
         ACQ_CORE_ACQ_CHAN_CTL_DTRIG_WHICH_MASK);
     regs.trig_dly = trigger_delay;
 
-    regs.ddr3_start_addr = ram_start_addr;
+    regs.ddr3_start_addr = acq_start_addr;
     /* we want the last sample to stay in the reserved area */
-    regs.ddr3_end_addr = ram_end_addr - sample_size;
+    regs.ddr3_end_addr = acq_end_addr - sample_size;
+}
+
+void Controller::write_params()
+{
+    check_devinfo_is_set();
+
+    encode_params();
+
+    /* every register after STA is either configuration or read-only, and
+     * read-only values in regs don't change after set_devinfo_callback(), so
+     * only CTL and the span of configuration registers which changed have to
+     * be written, e.g. just the DDR3 addresses when switching regions */
+    if (written_regs) {
+        if (regs.ctl != written_regs->ctl)
+            bar4_write(&bars, addr + ACQ_CORE_CTL, regs.ctl);
+
+        constexpr size_t nwords = sizeof regs / sizeof(uint32_t);
+        uint32_t cur[nwords], old[nwords];
+        memcpy(cur, &regs, sizeof cur);
+        memcpy(old, written_regs.get(), sizeof old);
+
+        size_t first = ACQ_CORE_TRIG_CFG / sizeof(uint32_t), last = nwords;
+        while (first < nwords && cur[first] == old[first])
+            first++;
+        if (first < nwords) {
+            while (cur[last - 1] == old[last - 1])
+                last--;
+            bar4_write_v(&bars, addr + first * sizeof(uint32_t), &cur[first],
+                (last - first) * sizeof(uint32_t));
+        }
+    } else {
+        bar4_write_v(&bars, addr, &regs, sizeof regs);
+    }
+
+    if (!written_regs)
+        written_regs = std::make_unique<struct acq_core>();
+    *written_regs = regs;
+}
+
+void Controller::forget_written_params()
+{
+    written_regs.reset();
 }
 
 acq_error Controller::start_acquisition()
@@ -466,21 +570,109 @@ bool Controller::acquisition_ready()
     return (regs.sta & COMPLETE_MASK) == COMPLETE_VALUE;
 }
 
-/* XXX: evaluate performance difference from reusing a vector from the caller
- * instead of always creating a new one */
-template <class Data> std::vector<Data> Controller::get_result()
+bool Controller::wait_acquisition(
+    std::chrono::steady_clock::time_point deadline)
+{
+    if (m_step != acq_step::started)
+        return m_step == acq_step::done;
+
+    auto sta = wait_for_bits(
+        bars, addr + ACQ_CORE_STA, COMPLETE_MASK, COMPLETE_VALUE, deadline,
+        acq_backoff);
+    if (!sta)
+        return false;
+
+    regs.sta = *sta;
+    m_step = acq_step::done;
+    return true;
+}
+
+Controller::shot_desc Controller::finish_shot()
 {
     if (m_step != acq_step::done)
         throw std::logic_error("get_result() called in the wrong step");
     m_step = acq_step::stop;
 
+    size_t trigger_pos = bar4_read(&bars, addr + ACQ_CORE_TRIG_POS);
+    if (trigger_pos < acq_start_addr || trigger_pos >= acq_end_addr)
+        throw std::runtime_error(
+            "trigger_pos is outside of valid address range");
+
+    last_shot = { acq_start_addr, acq_end_addr, trigger_pos,
+        channel_atom_width, channel_num_atoms, sample_size, acq_pre_samples,
+        acq_post_samples, acq_channel, channel_int_width,
+        std::chrono::system_clock::now() };
+
+    return last_shot;
+}
+
+shot_info Controller::to_info(const shot_desc &shot)
+{
+    return { shot.channel, shot.int_width, shot.num_atoms, shot.atom_width,
+        shot.pre_samples, shot.post_samples, shot.trigger_pos,
+        shot.timestamp.time_since_epoch() / 1ns };
+}
+
+shot_info Controller::get_shot_info()
+{
+    return to_info(last_shot);
+}
+
+std::array<std::array<size_t, 2>, 2> Controller::shot_segments(
+    const shot_desc &shot)
+{
+    const size_t total_bytes
+        = (shot.pre_samples + shot.post_samples) * shot.sample_size;
+
+    /* these functions convert bytes (as an offset from the region start) into
+     * amount of samples */
+    auto bytes2samples
+        = [&shot](ssize_t v) -> ssize_t { return v / shot.sample_size; };
+    auto samples2bytes
+        = [&shot](ssize_t v) -> ssize_t { return v * shot.sample_size; };
+    const ssize_t max_bytes = shot.end_addr - shot.start_addr,
+                  max_samples = bytes2samples(max_bytes);
+    /* in order to simplify working with the acquisition circular buffer, think
+     * first in terms of indexes into a circular buffer */
+    const ssize_t trigger_index
+        = bytes2samples(shot.trigger_pos - shot.start_addr);
+    ssize_t start_index = trigger_index - shot.pre_samples;
+    /* trigger_index is the position of the first post_sample, so we need to
+     * subtract one to get the end_index */
+    ssize_t end_index = trigger_index + shot.post_samples - 1;
+    /* convert from negative or >max_samples indexes */
+    start_index %= max_samples;
+    end_index %= max_samples;
+
+    /* we have to use >= to account for acquisitions with just one sample */
+    if (end_index >= start_index) {
+        /* the acquisition sits in a contiguous segment in RAM */
+        return { { { shot.start_addr + samples2bytes(start_index),
+                       total_bytes },
+            { 0, 0 } } };
+    } else {
+        /* the acquisition wraps around the buffer: from the start of the
+         * acquisition to the end of the buffer, and from the start of the
+         * buffer to the end of the acquisition */
+        const size_t first_read = samples2bytes(max_samples - start_index);
+        return { { { shot.start_addr + samples2bytes(start_index),
+                       first_read },
+            { shot.start_addr, total_bytes - first_read } } };
+    }
+}
+
+/* this function can run concurrently with a new acquisition, so it can only use
+ * the information from the shot descriptor */
+template <class Data>
+std::vector<Data> Controller::read_shot(const shot_desc &shot)
+{
     /* total number of elements (samples*atoms) */
-    size_t total_samples = acq_pre_samples + acq_post_samples,
-           elements = total_samples * channel_num_atoms;
-    size_t total_bytes = elements * (channel_atom_width / 8);
+    size_t total_samples = shot.pre_samples + shot.post_samples,
+           elements = total_samples * shot.num_atoms;
+    size_t total_bytes = elements * (shot.atom_width / 8);
 
     /* this is an identity, just want to be sure */
-    if (total_bytes != (total_samples)*sample_size)
+    if (total_bytes != (total_samples)*shot.sample_size)
         throw std::logic_error("elements * channel_atom_width/8 different from "
                                "samples * sample_size");
 
@@ -497,7 +689,7 @@ template <class Data> std::vector<Data> Controller::get_result()
         v.resize(elements);
         data_pointer = v.data();
     };
-    switch (channel_atom_width) {
+    switch (shot.atom_width) {
     case 8:
         set_data(v8);
         break;
@@ -509,46 +701,11 @@ template <class Data> std::vector<Data> Controller::get_result()
         break;
     }
 
-    size_t trigger_pos = bar4_read(&bars, addr + ACQ_CORE_TRIG_POS);
-    if (trigger_pos < ram_start_addr || trigger_pos >= ram_end_addr)
-        throw std::runtime_error(
-            "trigger_pos is outside of valid address range");
-
-    /* these functions convert bytes (as an offset from ram_start_addr) into
-     * amount of samples */
-    auto bytes2samples
-        = [this](ssize_t v) -> ssize_t { return v / sample_size; };
-    auto samples2bytes
-        = [this](ssize_t v) -> ssize_t { return v * sample_size; };
-    const ssize_t max_bytes = ram_end_addr - ram_start_addr,
-                  max_samples = bytes2samples(max_bytes);
-    /* in order to simplify working with the acquisition circular buffer, think
-     * first in terms of indexes into a circular buffer */
-    const ssize_t trigger_index = bytes2samples(trigger_pos - ram_start_addr);
-    ssize_t start_index = trigger_index - acq_pre_samples;
-    /* trigger_index is the position of the first post_sample, so we need to
-     * subtract one to get the end_index */
-    ssize_t end_index = trigger_index + acq_post_samples - 1;
-    /* convert from negative or >max_samples indexes */
-    start_index %= max_samples;
-    end_index %= max_samples;
-
-    /* we have to use >= to account for acquisitions with just one sample */
-    if (end_index >= start_index) {
-        /* copy when the acquisition sits in a contiguous segment in RAM */
-        bar2_read_v(&bars, ram_start_addr + samples2bytes(start_index),
-            data_pointer, total_bytes);
-    } else {
-        /* copy when the acquisition wraps around the buffer */
-        const ssize_t first_read = samples2bytes(max_samples - start_index);
-        /* copy from the start of the acquisition to the end of the buffer */
-        bar2_read_v(&bars, ram_start_addr + samples2bytes(start_index),
-            data_pointer, first_read);
-        /* copy from the start of the buffer to the end of the acquisition */
-        bar2_read_v(&bars, ram_start_addr,
-            (unsigned char *)data_pointer + first_read,
-            total_bytes - first_read);
-    }
+    auto segments = shot_segments(shot);
+    bar2_read_v(&bars, segments[0][0], data_pointer, segments[0][1]);
+    if (segments[1][1])
+        bar2_read_v(&bars, segments[1][0],
+            (unsigned char *)data_pointer + segments[0][1], segments[1][1]);
 
     auto convert_result = [elements](auto &v) -> std::vector<Data> {
         if constexpr (sizeof v[0] == sizeof(Data))
@@ -558,7 +715,7 @@ template <class Data> std::vector<Data> Controller::get_result()
         std::ranges::copy(v, result.begin());
         return result;
     };
-    switch (channel_atom_width) {
+    switch (shot.atom_width) {
     case 8:
         return convert_result(v8);
         break;
@@ -573,26 +730,88 @@ template <class Data> std::vector<Data> Controller::get_result()
     throw std::logic_error("should be unreachable");
 }
 
+/* XXX: evaluate performance difference from reusing a vector from the caller
+ * instead of always creating a new one */
+template <class Data> std::vector<Data> Controller::get_result()
+{
+    return read_shot<Data>(finish_shot());
+}
+
+template <class Data>
+std::vector<std::vector<Data>> Controller::read_shot_atoms(
+    const shot_desc &shot, const std::vector<double> &scale)
+{
+    const size_t total_samples = shot.pre_samples + shot.post_samples;
+    std::vector<std::vector<Data>> result(
+        shot.num_atoms, std::vector<Data>(total_samples));
+    std::vector<Data *> dest;
+    for (auto &v : result)
+        dest.push_back(v.data());
+
+    /* the data is de-interleaved as each chunk is copied out of BAR2, while
+     * it's still in cache; the signedness of the atoms follows Data, as in
+     * read_shot() */
+    constexpr bool is_signed = std::is_signed_v<Data>;
+    auto read = [this, &shot, &dest, &scale](auto atom) {
+        using Atom = decltype(atom);
+        Deinterleaver<Atom, Data> d(dest, scale);
+        auto cb = [](void *arg, const void *src, size_t n) {
+            static_cast<Deinterleaver<Atom, Data> *>(arg)->push(src, n);
+        };
+        for (auto &segment : shot_segments(shot))
+            if (segment[1])
+                bar2_read_cb(&bars, segment[0], segment[1], cb, &d);
+    };
+    switch (shot.atom_width) {
+    case 8:
+        read(std::conditional_t<is_signed, int8_t, uint8_t> { });
+        break;
+    case 16:
+        read(std::conditional_t<is_signed, int16_t, uint16_t> { });
+        break;
+    case 32:
+        read(std::conditional_t<is_signed, int32_t, uint32_t> { });
+        break;
+    default:
+        throw std::logic_error("should be unreachable");
+    }
+
+    return result;
+}
+
+template <class Data>
+std::vector<std::vector<Data>> Controller::get_result_atoms(
+    const std::vector<double> &scale)
+{
+    return read_shot_atoms<Data>(finish_shot(), scale);
+}
+template std::vector<std::vector<uint32_t>> Controller::get_result_atoms(
+    const std::vector<double> &);
+template std::vector<std::vector<uint16_t>> Controller::get_result_atoms(
+    const std::vector<double> &);
+template std::vector<std::vector<uint8_t>> Controller::get_result_atoms(
+    const std::vector<double> &);
+template std::vector<std::vector<int32_t>> Controller::get_result_atoms(
+    const std::vector<double> &);
+template std::vector<std::vector<int16_t>> Controller::get_result_atoms(
+    const std::vector<double> &);
+template std::vector<std::vector<int8_t>> Controller::get_result_atoms(
+    const std::vector<double> &);
+template std::vector<std::vector<float>> Controller::get_result_atoms(
+    const std::vector<double> &);
+template std::vector<std::vector<double>> Controller::get_result_atoms(
+    const std::vector<double> &);
+
 template <class Data>
 std::vector<Data> Controller::result(
     std::optional<std::chrono::milliseconds> wait_time)
 {
     start_acquisition();
 
-    std::chrono::steady_clock::time_point start_time;
-    if (wait_time)
-        start_time = std::chrono::steady_clock::now();
-
-    acq_status r;
-    do {
-        r = get_acq_status();
-        if (r == acq_status::in_progress)
-            std::this_thread::sleep_for(acq_loop_time);
-    } while (r == acq_status::in_progress
-        && (!wait_time
-            || std::chrono::steady_clock::now() - start_time < *wait_time));
-
-    if (r == acq_status::success)
+    const auto deadline = wait_time
+        ? std::chrono::steady_clock::now() + *wait_time
+        : std::chrono::steady_clock::time_point::max();
+    if (wait_acquisition(deadline))
         return get_result<Data>();
 
     throw std::runtime_error("acquisition failed");
@@ -628,21 +847,277 @@ acq_status Controller::get_acq_status()
     throw std::logic_error("should be unreachable");
 }
 
-template <typename T> void Controller::print_csv(FILE *f, std::vector<T> &res)
+unsigned Controller::get_atom_width()
+{
+    check_devinfo_is_set();
+    get_internal_values();
+    return channel_atom_width;
+}
+
+template <typename T>
+void Controller::print_csv(FILE *f, std::vector<T> &res, unsigned num_threads)
+{
+    write_csv(f, res.data(), res.size(), channel_num_atoms, num_threads);
+}
+template void Controller::print_csv(FILE *, std::vector<int32_t> &, unsigned);
+template void Controller::print_csv(FILE *, std::vector<uint32_t> &, unsigned);
+template void Controller::print_csv(FILE *, std::vector<int16_t> &, unsigned);
+template void Controller::print_csv(FILE *, std::vector<uint16_t> &, unsigned);
+template void Controller::print_csv(FILE *, std::vector<int8_t> &, unsigned);
+template void Controller::print_csv(FILE *, std::vector<uint8_t> &, unsigned);
+
+namespace {
+    void write_all(int fd, const void *src, size_t n)
+    {
+        const unsigned char *p = (const unsigned char *)src;
+        while (n) {
+            ssize_t r = write(fd, p, n);
+            if (r < 0) {
+                if (errno == EINTR)
+                    continue;
+                throw std::runtime_error(
+                    std::string("couldn't write output: ") + strerror(errno));
+            }
+            p += r;
+            n -= r;
+        }
+    }
+}
+
+template <typename T>
+void Controller::write_binary(FILE *f, const std::vector<T> &res)
+{
+    struct binary_header h = { };
+    memcpy(h.magic, "UHALACQ", sizeof h.magic);
+    h.version = 1;
+    h.header_size = sizeof h;
+    h.element_size = sizeof(T);
+    h.element_signed = std::is_signed_v<T>;
+    h.atom_width = last_shot.atom_width;
+    h.num_atoms = last_shot.num_atoms;
+    h.pre_samples = last_shot.pre_samples;
+    h.post_samples = last_shot.post_samples;
+    h.trigger_pos = last_shot.trigger_pos;
+    h.timestamp_ns = last_shot.timestamp.time_since_epoch() / 1ns;
+    h.data_size = res.size() * sizeof(T);
+
+    /* bypass stdio buffering, so the data is written with as few calls as
+     * possible */
+    fflush(f);
+    const int fd = fileno(f);
+    write_all(fd, &h, sizeof h);
+    write_all(fd, res.data(), h.data_size);
+}
+template void Controller::write_binary(FILE *, const std::vector<int32_t> &);
+template void Controller::write_binary(FILE *, const std::vector<uint32_t> &);
+template void Controller::write_binary(FILE *, const std::vector<int16_t> &);
+template void Controller::write_binary(FILE *, const std::vector<uint16_t> &);
+template void Controller::write_binary(FILE *, const std::vector<int8_t> &);
+template void Controller::write_binary(FILE *, const std::vector<uint8_t> &);
+
+template <class Data>
+ContinuousAcquisition<Data>::ContinuousAcquisition(Controller &ctl,
+    unsigned num_regions, size_t queue_size, overflow_policy policy)
+    : ctl(ctl)
+    , num_regions(num_regions)
+    , queue_size(queue_size)
+    , policy(policy)
+{
+    if (num_regions < 2)
+        throw std::logic_error(
+            "continuous acquisition requires at least 2 regions");
+    if (queue_size == 0)
+        throw std::logic_error("queue size can't be 0");
+}
+
+template <class Data> ContinuousAcquisition<Data>::~ContinuousAcquisition()
+{
+    stop();
+}
+
+template <class Data> void ContinuousAcquisition<Data>::start()
+{
+    if (acq_thread.joinable())
+        throw std::logic_error("continuous acquisition is already running");
+
+    ctl.set_regions(num_regions);
+
+    /* regions are taken from the back, so region 0 is used first */
+    free_regions.clear();
+    for (unsigned i = num_regions; i > 0; i--)
+        free_regions.push_back(i - 1);
+    pending.clear();
+    queue.clear();
+    stats = { };
+    error = nullptr;
+    running = true;
+
+    acq_thread = std::thread(&ContinuousAcquisition::acquire_loop, this);
+    read_thread = std::thread(&ContinuousAcquisition::read_loop, this);
+}
+
+template <class Data> void ContinuousAcquisition<Data>::stop()
+{
+    {
+        std::lock_guard lock(m);
+        running = false;
+    }
+    cv.notify_all();
+
+    if (!acq_thread.joinable())
+        return;
+
+    acq_thread.join();
+    read_thread.join();
+
+    ctl.stop_acquisition();
+    ctl.set_regions(1);
+}
+
+template <class Data> bool ContinuousAcquisition<Data>::is_running()
+{
+    std::lock_guard lock(m);
+    return running;
+}
+
+template <class Data>
+void ContinuousAcquisition<Data>::set_error(std::exception_ptr e)
+{
+    {
+        std::lock_guard lock(m);
+        if (!error)
+            error = e;
+        running = false;
+    }
+    cv.notify_all();
+}
+
+template <class Data> void ContinuousAcquisition<Data>::acquire_loop()
 {
-    for (unsigned i = 0; i < (pre_samples + post_samples); i++) {
-        for (unsigned j = 0; j < channel_num_atoms; j++) {
-            char tmp[32];
-            auto r = std::to_chars(
-                tmp, tmp + sizeof tmp, res[i * channel_num_atoms + j]);
-            *r.ptr = '\0';
-            fputs(tmp, f);
-            fputc(',', f);
+    try {
+        for (uint64_t sequence = 0;; sequence++) {
+            unsigned region;
+            {
+                std::unique_lock lock(m);
+                if (running && free_regions.empty()) {
+                    stats.stalls++;
+                    cv.wait(lock,
+                        [this] { return !running || !free_regions.empty(); });
+                }
+                if (!running)
+                    return;
+                region = free_regions.back();
+                free_regions.pop_back();
+            }
+
+            ctl.region = region;
+            if (ctl.start_acquisition() != acq_error::success)
+                throw std::runtime_error(
+                    "couldn't start continuous acquisition");
+
+            while (!ctl.wait_acquisition(
+                std::chrono::steady_clock::now() + stop_check_time))
+                if (!is_running())
+                    return;
+            auto timestamp = std::chrono::steady_clock::now();
+            auto desc = ctl.finish_shot();
+
+            {
+                std::lock_guard lock(m);
+                stats.acquired++;
+                pending.push_back({ desc, region, sequence, timestamp });
+            }
+            cv.notify_all();
         }
-        fputc('\n', f);
+    } catch (...) {
+        set_error(std::current_exception());
+    }
+}
+
+template <class Data> void ContinuousAcquisition<Data>::read_loop()
+{
+    try {
+        while (true) {
+            pending_shot shot;
+            {
+                std::unique_lock lock(m);
+                cv.wait(lock, [this] { return !running || !pending.empty(); });
+                if (!running)
+                    return;
+                shot = pending.front();
+                pending.pop_front();
+            }
+
+            auto data = ctl.read_shot<Data>(shot.desc);
+
+            {
+                std::unique_lock lock(m);
+                /* the region can be re-armed even if the result has to wait
+                 * for space in the queue */
+                free_regions.push_back(shot.region);
+                cv.notify_all();
+
+                if (queue.size() >= queue_size) {
+                    if (policy == overflow_policy::block) {
+                        cv.wait(lock, [this] {
+                            return !running || queue.size() < queue_size;
+                        });
+                        if (!running)
+                            return;
+                    } else {
+                        queue.pop_front();
+                        stats.dropped++;
+                    }
+                }
+
+                queue.push_back({ shot.sequence, shot.timestamp,
+                    Controller::to_info(shot.desc), std::move(data) });
+                stats.delivered++;
+            }
+            cv.notify_all();
+        }
+    } catch (...) {
+        set_error(std::current_exception());
+    }
+}
+
+template <class Data>
+std::optional<shot_result<Data>> ContinuousAcquisition<Data>::pop(
+    std::optional<std::chrono::milliseconds> wait_time)
+{
+    std::unique_lock lock(m);
+    auto ready = [this] { return !queue.empty() || !running; };
+    if (wait_time)
+        cv.wait_for(lock, *wait_time, ready);
+    else
+        cv.wait(lock, ready);
+
+    if (queue.empty()) {
+        if (error)
+            std::rethrow_exception(error);
+        return std::nullopt;
     }
+
+    auto r = std::move(queue.front());
+    queue.pop_front();
+    lock.unlock();
+    /* wake up the read thread if it's blocked on a full queue */
+    cv.notify_all();
+
+    return r;
 }
-template void Controller::print_csv<int32_t>(FILE *, std::vector<int32_t> &);
-template void Controller::print_csv<uint32_t>(FILE *, std::vector<uint32_t> &);
+
+template <class Data> continuous_stats ContinuousAcquisition<Data>::get_stats()
+{
+    std::lock_guard lock(m);
+    return stats;
+}
+
+template class ContinuousAcquisition<uint32_t>;
+template class ContinuousAcquisition<uint16_t>;
+template class ContinuousAcquisition<uint8_t>;
+template class ContinuousAcquisition<int32_t>;
+template class ContinuousAcquisition<int16_t>;
+template class ContinuousAcquisition<int8_t>;
 
 } /* namespace acq */
@@ -0,0 +1,465 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "modules/acq_archive.h"
+
+namespace acq {
+
+static_assert(sizeof(struct archive_file_header) == 32);
+static_assert(sizeof(struct archive_record) == 80);
+static_assert(sizeof(struct archive_index_entry) == 32);
+
+namespace {
+    const uint32_t archive_version = 1;
+    /* large enough for direct I/O and so records can be mapped individually */
+    const uint32_t record_alignment = 4096;
+    const char data_magic[8] = "UHALARC";
+    const char idx_magic[8] = "UHALIDX";
+    const char record_magic[8] = "UHALREC";
+
+    [[noreturn]] void throw_errno(const std::string &msg)
+    {
+        throw std::runtime_error(msg + ": " + strerror(errno));
+    }
+
+    archive_file_header file_header(const char (&magic)[8])
+    {
+        archive_file_header h = { };
+        memcpy(h.magic, magic, sizeof h.magic);
+        h.version = archive_version;
+        h.header_size = sizeof h;
+        h.record_alignment = record_alignment;
+        h.entry_size = sizeof(archive_index_entry);
+        return h;
+    }
+
+    void check_file_header(
+        const archive_file_header &h, const char (&magic)[8])
+    {
+        if (memcmp(h.magic, magic, sizeof h.magic))
+            throw std::runtime_error("not an acquisition archive");
+        if (h.version != archive_version
+            || h.record_alignment != record_alignment
+            || h.entry_size != sizeof(archive_index_entry))
+            throw std::runtime_error("unsupported acquisition archive version");
+    }
+
+    /* write everything in iov, even if the kernel returns early */
+    void pwritev_all(int fd, struct iovec *iov, int iovcnt, uint64_t offset)
+    {
+        while (iovcnt) {
+            ssize_t r = pwritev(fd, iov, iovcnt, offset);
+            if (r < 0) {
+                if (errno == EINTR)
+                    continue;
+                throw_errno("couldn't write archive");
+            }
+            offset += r;
+            for (; iovcnt && (size_t)r >= iov->iov_len; iov++, iovcnt--)
+                r -= iov->iov_len;
+            if (iovcnt) {
+                iov->iov_base = (char *)iov->iov_base + r;
+                iov->iov_len -= r;
+            }
+        }
+    }
+
+    uint64_t align_up(uint64_t v)
+    {
+        return (v + record_alignment - 1) / record_alignment * record_alignment;
+    }
+
+    /* amount of complete index entries whose records fit in data_len */
+    size_t valid_entries(
+        const archive_index_entry *entries, size_t n, uint64_t data_len)
+    {
+        size_t i = 0;
+        for (; i < n; i++) {
+            const auto &e = entries[i];
+            if (e.offset % record_alignment || e.size < sizeof(archive_record)
+                || e.offset > data_len || e.size > data_len - e.offset)
+                break;
+        }
+        return i;
+    }
+
+    const unsigned char *map_file(int fd, size_t len)
+    {
+        if (len == 0)
+            return nullptr;
+        void *p = mmap(nullptr, len, PROT_READ, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED)
+            throw_errno("couldn't map archive");
+        return (const unsigned char *)p;
+    }
+
+    size_t file_size(int fd)
+    {
+        struct stat st;
+        if (fstat(fd, &st))
+            throw_errno("couldn't stat archive");
+        return st.st_size;
+    }
+
+    /* opens path for writing, creating it only if allowed; created is set if
+     * it didn't exist before */
+    int open_file(const std::string &path, bool create, bool &created)
+    {
+        int fd = open(path.c_str(), O_RDWR | O_CLOEXEC);
+        if (fd < 0 && errno == ENOENT && create) {
+            fd = open(path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC,
+                0644);
+            created = fd >= 0;
+        }
+        if (fd < 0)
+            throw_errno("couldn't open " + path);
+        return fd;
+    }
+
+    /* returns false for an empty file, and throws if it holds anything other
+     * than a header with magic */
+    bool read_file_header(int fd, const char (&magic)[8])
+    {
+        if (file_size(fd) == 0)
+            return false;
+        archive_file_header h;
+        if (pread(fd, &h, sizeof h, 0) != sizeof h)
+            throw std::runtime_error("truncated acquisition archive");
+        check_file_header(h, magic);
+        return true;
+    }
+}
+
+ArchiveWriter::ArchiveWriter(const std::string &path)
+{
+    const std::string idx_path = path + ".idx";
+    bool created = false, idx_created = false;
+    try {
+        /* only files which are empty or already hold an archive are written
+         * to, so anything else at path is left alone */
+        fd = open_file(path, true, created);
+        const bool has_header = read_file_header(fd, data_magic);
+        const size_t data_len = file_size(fd);
+
+        /* an archive without records can be created again if the first
+         * writer was interrupted, which is the only case where a missing index
+         * is created */
+        idx_fd = open_file(idx_path, data_len <= record_alignment, idx_created);
+        const bool has_idx_header = read_file_header(idx_fd, idx_magic);
+        const size_t idx_len = file_size(idx_fd);
+        if (idx_len < sizeof(archive_file_header) + sizeof(archive_index_entry)
+            && data_len <= record_alignment) {
+            auto h = file_header(data_magic);
+            struct iovec iov[] = { { &h, sizeof h } };
+            pwritev_all(fd, iov, 1, 0);
+            h = file_header(idx_magic);
+            iov[0] = { &h, sizeof h };
+            pwritev_all(idx_fd, iov, 1, 0);
+            if (ftruncate(fd, record_alignment))
+                throw_errno("couldn't resize archive");
+
+            data_end = record_alignment;
+            num_records = 0;
+            return;
+        }
+        if (!has_header || !has_idx_header)
+            throw std::runtime_error("truncated acquisition archive");
+
+        /* drop whatever an interrupted writer left after the last complete
+         * record */
+        const size_t header_size = sizeof(archive_file_header);
+        std::vector<archive_index_entry> entries(
+            (idx_len - header_size) / sizeof(archive_index_entry));
+        const ssize_t entries_len = entries.size() * sizeof entries[0];
+        if (pread(idx_fd, entries.data(), entries_len, header_size)
+            != entries_len)
+            throw_errno("couldn't read archive index");
+        num_records = valid_entries(entries.data(), entries.size(), data_len);
+        data_end = num_records
+            ? align_up(entries[num_records - 1].offset
+                + entries[num_records - 1].size)
+            : record_alignment;
+
+        if (ftruncate(fd, data_end)
+            || ftruncate(idx_fd,
+                header_size + num_records * sizeof(archive_index_entry)))
+            throw_errno("couldn't truncate archive");
+    } catch (...) {
+        if (fd >= 0)
+            close(fd);
+        if (idx_fd >= 0)
+            close(idx_fd);
+        if (idx_created)
+            unlink(idx_path.c_str());
+        if (created)
+            unlink(path.c_str());
+        throw;
+    }
+}
+
+ArchiveWriter::~ArchiveWriter()
+{
+    close(fd);
+    close(idx_fd);
+}
+
+template <class Data>
+void ArchiveWriter::append(
+    const shot_info &info, uint64_t sequence, std::span<const Data> data)
+{
+    static_assert(std::is_integral_v<Data>);
+
+    struct archive_record r = { };
+    memcpy(r.magic, record_magic, sizeof r.magic);
+    r.header_size = sizeof r;
+    r.element_size = sizeof(Data);
+    r.element_signed = std::is_signed_v<Data>;
+    r.channel = info.channel;
+    r.int_width = info.int_width;
+    r.num_atoms = info.num_atoms;
+    r.atom_width = info.atom_width;
+    r.pre_samples = info.pre_samples;
+    r.post_samples = info.post_samples;
+    r.sequence = sequence;
+    r.timestamp_ns = info.timestamp_ns;
+    r.trigger_pos = info.trigger_pos;
+    r.data_size = data.size_bytes();
+
+    static const unsigned char padding[record_alignment] = { };
+    const uint64_t size = sizeof r + r.data_size;
+    struct iovec iov[] = {
+        { &r, sizeof r },
+        { (void *)data.data(), data.size_bytes() },
+        { (void *)padding, align_up(size) - size },
+    };
+    pwritev_all(fd, iov, 3, data_end);
+
+    struct archive_index_entry e = { data_end, size, sequence,
+        info.timestamp_ns };
+    struct iovec idx_iov[] = { { &e, sizeof e } };
+    pwritev_all(idx_fd, idx_iov, 1,
+        sizeof(archive_file_header) + num_records * sizeof e);
+
+    data_end += align_up(size);
+    num_records++;
+}
+
+template <class Data> void ArchiveWriter::append(const shot_result<Data> &res)
+{
+    append(res.info, res.sequence, std::span<const Data>(res.data));
+}
+
+template void ArchiveWriter::append(
+    const shot_info &, uint64_t, std::span<const int32_t>);
+template void ArchiveWriter::append(
+    const shot_info &, uint64_t, std::span<const uint32_t>);
+template void ArchiveWriter::append(
+    const shot_info &, uint64_t, std::span<const int16_t>);
+template void ArchiveWriter::append(
+    const shot_info &, uint64_t, std::span<const uint16_t>);
+template void ArchiveWriter::append(
+    const shot_info &, uint64_t, std::span<const int8_t>);
+template void ArchiveWriter::append(
+    const shot_info &, uint64_t, std::span<const uint8_t>);
+template void ArchiveWriter::append(const shot_result<int32_t> &);
+template void ArchiveWriter::append(const shot_result<uint32_t> &);
+template void ArchiveWriter::append(const shot_result<int16_t> &);
+template void ArchiveWriter::append(const shot_result<uint16_t> &);
+template void ArchiveWriter::append(const shot_result<int8_t> &);
+template void ArchiveWriter::append(const shot_result<uint8_t> &);
+
+size_t ArchiveWriter::size() const
+{
+    return num_records;
+}
+
+ArchiveReader::ArchiveReader(const std::string &path)
+{
+    int fd = -1, idx_fd = -1;
+    try {
+        fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            throw_errno("couldn't open " + path);
+        idx_fd = open((path + ".idx").c_str(), O_RDONLY | O_CLOEXEC);
+        if (idx_fd < 0)
+            throw_errno("couldn't open " + path + ".idx");
+
+        data_len = file_size(fd);
+        idx_len = file_size(idx_fd);
+        if (data_len < sizeof(archive_file_header)
+            || idx_len < sizeof(archive_file_header))
+            throw std::runtime_error("truncated acquisition archive");
+
+        data_map = map_file(fd, data_len);
+        idx_map = map_file(idx_fd, idx_len);
+        check_file_header(
+            *(const archive_file_header *)data_map, data_magic);
+        check_file_header(*(const archive_file_header *)idx_map, idx_magic);
+
+        entries = (const archive_index_entry *)(idx_map
+            + sizeof(archive_file_header));
+        num_records = valid_entries(entries,
+            (idx_len - sizeof(archive_file_header))
+                / sizeof(archive_index_entry),
+            data_len);
+    } catch (...) {
+        if (data_map)
+            munmap((void *)data_map, data_len);
+        if (idx_map)
+            munmap((void *)idx_map, idx_len);
+        if (fd >= 0)
+            close(fd);
+        if (idx_fd >= 0)
+            close(idx_fd);
+        throw;
+    }
+
+    /* the mappings stay valid after the files are closed */
+    close(fd);
+    close(idx_fd);
+}
+
+ArchiveReader::~ArchiveReader()
+{
+    munmap((void *)data_map, data_len);
+    munmap((void *)idx_map, idx_len);
+}
+
+size_t ArchiveReader::size() const
+{
+    return num_records;
+}
+
+const archive_record &ArchiveReader::record(size_t i) const
+{
+    if (i >= num_records)
+        throw std::out_of_range("archive record " + std::to_string(i)
+            + " doesn't exist, archive has " + std::to_string(num_records)
+            + " records");
+
+    const auto &e = entries[i];
+    const auto &r = *(const archive_record *)(data_map + e.offset);
+    if (memcmp(r.magic, record_magic, sizeof r.magic)
+        || r.header_size != sizeof r || r.sequence != e.sequence
+        || r.data_size != e.size - sizeof r || r.element_size == 0
+        || r.data_size % r.element_size)
+        throw std::runtime_error(
+            "corrupted archive record " + std::to_string(i));
+
+    return r;
+}
+
+shot_info ArchiveReader::info(size_t i) const
+{
+    const auto &r = record(i);
+    return { r.channel, r.int_width, r.num_atoms, r.atom_width, r.pre_samples,
+        r.post_samples, r.trigger_pos, r.timestamp_ns };
+}
+
+template <class Data> std::span<const Data> ArchiveReader::data(size_t i) const
+{
+    const auto &r = record(i);
+    if (r.element_size != sizeof(Data)
+        || (bool)r.element_signed != std::is_signed_v<Data>)
+        throw std::runtime_error("archive record " + std::to_string(i)
+            + " doesn't hold elements of the requested type");
+
+    return { (const Data *)((const unsigned char *)&r + r.header_size),
+        r.data_size / sizeof(Data) };
+}
+template std::span<const int32_t> ArchiveReader::data(size_t) const;
+template std::span<const uint32_t> ArchiveReader::data(size_t) const;
+template std::span<const int16_t> ArchiveReader::data(size_t) const;
+template std::span<const uint16_t> ArchiveReader::data(size_t) const;
+template std::span<const int8_t> ArchiveReader::data(size_t) const;
+template std::span<const uint8_t> ArchiveReader::data(size_t) const;
+
+namespace {
+    template <class Data, class Stored>
+    std::vector<Data> convert(std::span<const Stored> src)
+    {
+        return std::vector<Data>(src.begin(), src.end());
+    }
+
+    template <class Data>
+    std::vector<Data> convert_record(
+        const ArchiveReader &reader, const archive_record &r, size_t i)
+    {
+        switch (r.element_size * 2 + !!r.element_signed) {
+        case 8:
+            return convert<Data>(reader.data<uint32_t>(i));
+        case 9:
+            return convert<Data>(reader.data<int32_t>(i));
+        case 4:
+            return convert<Data>(reader.data<uint16_t>(i));
+        case 5:
+            return convert<Data>(reader.data<int16_t>(i));
+        case 2:
+            return convert<Data>(reader.data<uint8_t>(i));
+        case 3:
+            return convert<Data>(reader.data<int8_t>(i));
+        default:
+            throw std::runtime_error("archive record " + std::to_string(i)
+                + " has unsupported element size");
+        }
+    }
+}
+
+template <class Data>
+ArchiveReplay<Data>::ArchiveReplay(const ArchiveReader &reader, bool paced)
+    : reader(reader)
+    , paced(paced)
+{
+}
+
+template <class Data>
+std::optional<shot_result<Data>> ArchiveReplay<Data>::pop(
+    std::optional<std::chrono::milliseconds> wait_time)
+{
+    if (next >= reader.size())
+        return std::nullopt;
+
+    const auto &r = reader.record(next);
+
+    if (paced) {
+        const auto now = std::chrono::steady_clock::now();
+        if (next == 0) {
+            start_time = now;
+            start_ns = r.timestamp_ns;
+        }
+
+        const auto due = start_time
+            + std::chrono::nanoseconds(r.timestamp_ns - start_ns);
+        if (wait_time && due > now + *wait_time) {
+            std::this_thread::sleep_for(*wait_time);
+            return std::nullopt;
+        }
+        std::this_thread::sleep_until(due);
+    }
+
+    shot_result<Data> res = { r.sequence, std::chrono::steady_clock::now(),
+        reader.info(next), convert_record<Data>(reader, r, next) };
+    next++;
+
+    return res;
+}
+
+template class ArchiveReplay<int32_t>;
+template class ArchiveReplay<uint32_t>;
+template class ArchiveReplay<int16_t>;
+template class ArchiveReplay<uint16_t>;
+template class ArchiveReplay<int8_t>;
+template class ArchiveReplay<uint8_t>;
+
+} /* namespace acq */
@@ -1,9 +1,71 @@
+#include <algorithm>
+#include <array>
+
 #include "modules/ad9510.h"
 #include "printer.h"
 #include "util.h"
 
 namespace ad9510 {
 
+namespace {
+    /* the instruction takes two bytes, and the rest of the frame can be used
+     * for data in streaming mode */
+    constexpr size_t MAX_BLOCK = spi::Controller::MAX_FRAME_SIZE - 2;
+
+/* transfer the buffered registers into the active ones */
+#define UPDATE spi::write_reg(0x5a, 1, false), spi::wait_reg(0x5a, 0)
+
+    const spi::Command defaults[] = {
+        /* PLL_2 = normal CP | digital lock detect active-high | positive PFD */
+        spi::write_reg(0x08, 0x03 | 0x04 | 0x40),
+        /* PLL_3 = 600mA CP */
+        spi::write_reg(0x09, 0),
+        /* PLL_4 = default */
+        spi::write_reg(0x0a, 0),
+        /* LVPECL_OUT0 = power up | 810mV output */
+        spi::write_reg(0x3c, 0x08),
+        /* LVPECL_OUT1 = power up | 810mV output */
+        spi::write_reg(0x3d, 0x08),
+        /* LVPECL_OUT2 = power up | 810mV output */
+        spi::write_reg(0x3e, 0x08),
+        /* LVPECL_OUT3 = power up | 810mV output */
+        spi::write_reg(0x3f, 0x08),
+        /* CMOS_OUT4 = power up | 3.5mA output */
+        spi::write_reg(0x40, 0x02),
+        /* CMOS_OUT5 = power down | 3.5mA output */
+        spi::write_reg(0x41, 0x03),
+        /* CMOS_OUT6 = power down | 3.5mA output */
+        spi::write_reg(0x42, 0x03),
+        /* CMOS_OUT7 = power down | 3.5mA output */
+        spi::write_reg(0x43, 0x03),
+        /* CLK_SELECT = sel clk2 | CLK1 power down */
+        spi::write_reg(0x45, 0x02),
+        /* DIV0_PHASE = bypass | start high */
+        spi::write_reg(0x49, 0x90),
+        /* DIV1_PHASE = bypass | start high */
+        spi::write_reg(0x4b, 0x90),
+        /* DIV2_PHASE = bypass | start high */
+        spi::write_reg(0x4d, 0x90),
+        /* DIV3_PHASE = bypass | start high */
+        spi::write_reg(0x4f, 0x90),
+        /* DIV4_PHASE = bypass | start high */
+        spi::write_reg(0x51, 0x90),
+        /* FUNCTION = SYNCB */
+        spi::write_reg(0x58, 0x20),
+        UPDATE,
+
+        /* force a software synchronization */
+        /* FUNCTION = SYNCB | SOFT_SYNC */
+        spi::write_reg(0x58, 0x20 | 0x04),
+        UPDATE,
+        /* FUNCTION = SYNCB */
+        spi::write_reg(0x58, 0x20),
+        UPDATE,
+    };
+
+#undef UPDATE
+}
+
 Controller::Controller(struct pcie_bars &bars)
     : spi_regs(bars)
     , fac_regs(bars)
@@ -34,17 +96,18 @@ void Controller::set_devinfo(const struct sdb_device_info &new_devinfo)
     spi_regs.set_devinfo(new_devinfo);
 }
 
-bool Controller::get_reg(uint8_t addr, uint8_t &rdata, spi::Channel)
+bool Controller::get_reg(uint8_t addr, uint8_t &rdata, spi::Channel channel)
 {
     const unsigned char wdata[] = {
         0x80, /* read 1 byte */
         addr,
     };
 
-    return spi_regs.write_read_data(wdata, sizeof wdata, &rdata, sizeof rdata);
+    return spi_regs.write_read_data(
+        wdata, sizeof wdata, &rdata, sizeof rdata, channel);
 }
 
-bool Controller::set_reg_ll(uint8_t addr, uint8_t value)
+bool Controller::set_reg_ll(uint8_t addr, uint8_t value, spi::Channel channel)
 {
     const unsigned char wdata[] = {
         0x00, /* write 1 byte */
@@ -52,7 +115,35 @@ bool Controller::set_reg_ll(uint8_t addr, uint8_t value)
         value,
     };
 
-    return spi_regs.write_read_data(wdata, sizeof wdata, nullptr, 0);
+    return spi_regs.write_read_data(wdata, sizeof wdata, nullptr, 0, channel);
+}
+
+bool Controller::get_regs(
+    uint8_t addr, std::span<uint8_t> values, spi::Channel channel)
+{
+    return spi::CommandQueue(spi_regs, channel, MAX_BLOCK)
+        .read_block(addr, values);
+}
+
+bool Controller::set_regs(
+    uint8_t addr, std::span<const uint8_t> values, spi::Channel channel)
+{
+    if (!spi::CommandQueue(spi_regs, channel, MAX_BLOCK)
+            .write_block(addr, values))
+        return false;
+
+    /* verify the whole block at once */
+    std::array<uint8_t, 0x100> reg_read;
+    if (!get_regs(addr, std::span(reg_read).first(values.size()), channel))
+        return false;
+
+    return std::equal(values.begin(), values.end(), reg_read.begin());
+}
+
+spi::CommandResult Controller::run(
+    std::span<const spi::Command> commands, spi::Channel channel)
+{
+    return spi::CommandQueue(spi_regs, channel, MAX_BLOCK).run(commands);
 }
 
 bool Controller::update_parameters()
@@ -70,13 +161,14 @@ bool Controller::update_parameters()
     return true;
 }
 
-bool Controller::set_reg(const uint8_t addr, uint8_t value, spi::Channel)
+bool Controller::set_reg(
+    const uint8_t addr, uint8_t value, spi::Channel channel)
 {
-    if (!set_reg_ll(addr, value))
+    if (!set_reg_ll(addr, value, channel))
         return false;
 
     uint8_t reg_read;
-    if (!get_reg(addr, reg_read))
+    if (!get_reg(addr, reg_read, channel))
         return false;
 
     return reg_read == value;
@@ -92,9 +184,8 @@ bool Controller::set_a_div(uint8_t value)
 
 bool Controller::set_b_div(uint16_t value)
 {
-    if (!set_reg(0x06, value & 0xff))
-        return false;
-    if (!set_reg(0x05, value >> 8))
+    const uint8_t values[] = { (uint8_t)(value >> 8), (uint8_t)value };
+    if (!set_regs(0x05, values))
         return false;
 
     return update_parameters();
@@ -102,87 +193,16 @@ bool Controller::set_b_div(uint16_t value)
 
 bool Controller::set_r_div(uint16_t value)
 {
-    if (!set_reg(0x0c, value & 0xff))
-        return false;
-    if (!set_reg(0x0b, value >> 8))
+    const uint8_t values[] = { (uint8_t)(value >> 8), (uint8_t)value };
+    if (!set_regs(0x0b, values))
         return false;
 
     return update_parameters();
 }
 
-bool Controller::set_defaults(spi::Channel)
+bool Controller::set_defaults(spi::Channel channel)
 {
-    bool rv = true;
-    if (rv)
-        /* PLL_2 = normal CP | digital lock detect active-high | positive PFD */
-        rv = set_reg(0x08, 0x03 | 0x04 | 0x40);
-    if (rv)
-        /* PLL_3 = 600mA CP */
-        rv = set_reg(0x09, 0);
-    if (rv)
-        /* PLL_4 = default */
-        rv = set_reg(0x0a, 0);
-    if (rv)
-        /* LVPECL_OUT0 = power up | 810mV output */
-        rv = set_reg(0x3c, 0x08);
-    if (rv)
-        /* LVPECL_OUT1 = power up | 810mV output */
-        rv = set_reg(0x3d, 0x08);
-    if (rv)
-        /* LVPECL_OUT2 = power up | 810mV output */
-        rv = set_reg(0x3e, 0x08);
-    if (rv)
-        /* LVPECL_OUT3 = power up | 810mV output */
-        rv = set_reg(0x3f, 0x08);
-    if (rv)
-        /* CMOS_OUT4 = power up | 3.5mA output */
-        rv = set_reg(0x40, 0x02);
-    if (rv)
-        /* CMOS_OUT5 = power down | 3.5mA output */
-        rv = set_reg(0x41, 0x03);
-    if (rv)
-        /* CMOS_OUT6 = power down | 3.5mA output */
-        rv = set_reg(0x42, 0x03);
-    if (rv)
-        /* CMOS_OUT7 = power down | 3.5mA output */
-        rv = set_reg(0x43, 0x03);
-    if (rv)
-        /* CLK_SELECT = sel clk2 | CLK1 power down */
-        rv = set_reg(0x45, 0x02);
-    if (rv)
-        /* DIV0_PHASE = bypass | start high */
-        rv = set_reg(0x49, 0x90);
-    if (rv)
-        /* DIV1_PHASE = bypass | start high */
-        rv = set_reg(0x4b, 0x90);
-    if (rv)
-        /* DIV2_PHASE = bypass | start high */
-        rv = set_reg(0x4d, 0x90);
-    if (rv)
-        /* DIV3_PHASE = bypass | start high */
-        rv = set_reg(0x4f, 0x90);
-    if (rv)
-        /* DIV4_PHASE = bypass | start high */
-        rv = set_reg(0x51, 0x90);
-    if (rv)
-        /* FUNCTION = SYNCB */
-        rv = set_reg(0x58, 0x20);
-    if (rv)
-        rv = update_parameters();
-
-    /* force a software synchronization */
-    if (rv)
-        /* FUNCTION = SYNCB | SOFT_SYNC */
-        rv = set_reg(0x58, 0x20 | 0x04);
-    if (rv)
-        rv = update_parameters();
-    if (rv)
-        /* FUNCTION = SYNCB */
-        rv = set_reg(0x58, 0x20);
-    if (rv)
-        rv = update_parameters();
-
-    return rv;
+    return run(defaults, channel).ok();
 }
 
 } /* namespace ad9510 */
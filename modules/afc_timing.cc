@@ -1,7 +1,9 @@
+#include <chrono>
 #include <cmath>
 #include <stdexcept>
 
 #include "modules/afc_timing.h"
+#include "pcie.h"
 #include "printer.h"
 #include "si57x_util.h"
 #include "util.h"
@@ -45,6 +47,14 @@ namespace {
 static_assert((TIMING_REG_AMC1 - TIMING_REG_AMC0) * NUM_CHANNELS
     == TIMING_REG_FMC2CH4_WDT - TIMING_REG_AMC0 + 4);
 
+namespace {
+    /* the counts are read in a single burst, from the first channel's count
+     * to the last one's */
+    constexpr size_t CHANNEL_WORDS
+        = (TIMING_REG_AMC1 - TIMING_REG_AMC0) / sizeof(uint32_t);
+    constexpr size_t COUNT_BURST_WORDS = (NUM_CHANNELS - 1) * CHANNEL_WORDS + 1;
+}
+
 struct afc_timing {
     uint32_t stat, alive;
     struct {
@@ -57,6 +67,8 @@ struct afc_timing {
     uint32_t dbg_ctl, dbg_cfg_1, dbg_cfg_2, dbg_sta;
 };
 
+static_assert(offsetof(afc_timing, trigger[0].count) == TIMING_REG_AMC0_COUNT);
+
 Core::Core(struct pcie_bars &bars)
     : RegisterDecoder(bars, ref_devinfo,
           {
@@ -290,4 +302,56 @@ void Controller::unset_commands()
     write_general("DBG_COUNTER_RST", 0);
 }
 
+struct config_layout Controller::get_config_layout() const
+{
+    /* the status register only has EVREN and the strobe to configure, and
+     * the count and the debug status are read only */
+    struct config_layout layout = {
+        {
+            { TIMING_REG_STAT, sizeof regs.stat },
+            { TIMING_REG_RTM_RFREQ_HI,
+                TIMING_REG_AMC0 - TIMING_REG_RTM_RFREQ_HI },
+            { TIMING_REG_DBG_CTL, TIMING_REG_DBG_STA - TIMING_REG_DBG_CTL },
+        },
+        {
+            { TIMING_REG_STAT, ~(uint32_t)TIMING_STAT_EVREN },
+            { TIMING_REG_DBG_CTL, TIMING_DBG_CTL_COUNTER_RST },
+        },
+    };
+    for (unsigned i = 0; i < NUM_CHANNELS; i++) {
+        const size_t ch = i * sizeof regs.trigger[0];
+        layout.regions.push_back(
+            { ch + offsetof(afc_timing, trigger[0].config),
+                sizeof regs.trigger[0].config
+                    + sizeof regs.trigger[0].pulses });
+        layout.regions.push_back({ ch + offsetof(afc_timing, trigger[0].evt),
+            offsetof(afc_timing, trigger[1])
+                - offsetof(afc_timing, trigger[0].evt) });
+        layout.volatile_bits.push_back(
+            { ch + offsetof(afc_timing, trigger[0].config),
+                TIMING_AMC0_COUNT_RST });
+    }
+    return layout;
+}
+
+RateMonitor::RateMonitor(Core &dec, size_t history_size)
+    : CounterRates(NUM_CHANNELS, 32, history_size)
+    , dec(dec)
+    , burst(COUNT_BURST_WORDS)
+    , counts(NUM_CHANNELS)
+{
+    dec.check_devinfo_is_set();
+}
+
+void RateMonitor::poll()
+{
+    bar4_read_v(&dec.bars, dec.addr + TIMING_REG_AMC0_COUNT, burst.data(),
+        burst.size() * sizeof burst[0]);
+    const auto time = std::chrono::steady_clock::now();
+
+    for (unsigned i = 0; i < NUM_CHANNELS; i++)
+        counts[i] = burst[i * CHANNEL_WORDS];
+    update(time, counts);
+}
+
 } /* namespace afc_timing */
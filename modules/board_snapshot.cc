@@ -0,0 +1,431 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "pcie.h"
+#include "util_sdb.h"
+
+#include "modules/acq.h"
+#include "modules/afc_timing.h"
+#include "modules/board_snapshot.h"
+#include "modules/bpm_swap.h"
+#include "modules/fmc250m_4ch.h"
+#include "modules/fmc_active_clk.h"
+#include "modules/fmc_adc_common.h"
+#include "modules/fmcpico1m_4ch.h"
+#include "modules/fofb_cc.h"
+#include "modules/fofb_processing.h"
+#include "modules/fofb_shaper_filt.h"
+#include "modules/lamp.h"
+#include "modules/orbit_intlk.h"
+#include "modules/pos_calc.h"
+#include "modules/si57x_ctrl.h"
+#include "modules/spi.h"
+#include "modules/sysid.h"
+#include "modules/trigger_iface.h"
+#include "modules/trigger_mux.h"
+
+namespace board_snapshot {
+
+static_assert(sizeof(struct snapshot_file_header) == 24);
+static_assert(sizeof(struct snapshot_file_core) == 32);
+static_assert(sizeof(struct snapshot_file_entry) == 8);
+
+namespace {
+    const uint32_t snapshot_version = 1;
+    const char snapshot_magic[8] = "UHALSNP";
+
+    template <class C>
+    std::unique_ptr<RegisterController> make_controller(
+        struct pcie_bars &bars)
+    {
+        return std::make_unique<C>(bars);
+    }
+
+    /* every controller, so that cores whose controllers don't describe their
+     * configuration layout can be reported */
+    const struct {
+        const char *name;
+        std::unique_ptr<RegisterController> (*make)(struct pcie_bars &);
+    } controller_factories[] = {
+        { "acq", make_controller<acq::Controller> },
+        { "afc_timing", make_controller<afc_timing::Controller> },
+        { "bpm_swap", make_controller<bpm_swap::Controller> },
+        { "fmc250m_4ch", make_controller<fmc250m_4ch::Controller> },
+        { "fmc_active_clk", make_controller<fmc_active_clk::Controller> },
+        { "fmc_adc_common", make_controller<fmc_adc_common::Controller> },
+        { "fmcpico1m_4ch", make_controller<fmcpico1m_4ch::Controller> },
+        { "fofb_cc", make_controller<fofb_cc::Controller> },
+        { "fofb_processing", make_controller<fofb_processing::Controller> },
+        { "fofb_shaper_filt", make_controller<fofb_shaper_filt::Controller> },
+        { "lamp", make_controller<lamp::Controller> },
+        { "orbit_intlk", make_controller<orbit_intlk::Controller> },
+        { "pos_calc", make_controller<pos_calc::Controller> },
+        { "si57x_ctrl", make_controller<si57x_ctrl::Controller> },
+        { "spi", make_controller<spi::Controller> },
+        { "sys_id", make_controller<sys_id::Controller> },
+        { "trigger_iface", make_controller<trigger_iface::Controller> },
+        { "trigger_mux", make_controller<trigger_mux::Controller> },
+    };
+
+    [[noreturn]] void throw_errno(const std::string &msg)
+    {
+        throw std::runtime_error(msg + ": " + strerror(errno));
+    }
+
+    std::vector<struct sdb_device_info> list_devices(struct pcie_bars &bars)
+    {
+        std::vector<struct sdb_device_info> devices;
+        read_sdb(
+            &bars,
+            [&devices](const struct sdb_device_info &devinfo) {
+                devices.push_back(devinfo);
+                return false;
+            },
+            0);
+        return devices;
+    }
+
+    std::string core_name(const struct sdb_device_info &devinfo, unsigned index)
+    {
+        char name[64];
+        snprintf(name, sizeof name, "core %016jx:%08jx #%u",
+            (uintmax_t)devinfo.vendor_id, (uintmax_t)devinfo.device_id, index);
+        return name;
+    }
+
+    /* position in core_image::data of the register at offset, if it's inside
+     * one of the regions */
+    std::optional<size_t> data_index(
+        const struct config_layout &layout, size_t offset)
+    {
+        size_t pos = 0;
+        for (const auto &r : layout.regions) {
+            if (offset >= r.offset && offset < r.offset + r.size)
+                return pos + (offset - r.offset) / sizeof(uint32_t);
+            pos += r.size / sizeof(uint32_t);
+        }
+        return std::nullopt;
+    }
+
+    /* the bits of each word in core_image::data which are configuration */
+    std::vector<uint32_t> config_masks(const core_image &image)
+    {
+        size_t words = 0;
+        for (const auto &r : image.layout.regions) {
+            if (r.offset % sizeof(uint32_t) || r.size % sizeof(uint32_t))
+                throw std::runtime_error(
+                    core_name(image.devinfo, image.index)
+                    + " has unaligned configuration regions");
+            words += r.size / sizeof(uint32_t);
+        }
+        if (words != image.data.size())
+            throw std::runtime_error(core_name(image.devinfo, image.index)
+                + " doesn't have data for all of its configuration regions");
+
+        std::vector<uint32_t> masks(words, UINT32_MAX);
+        for (const auto &b : image.layout.volatile_bits) {
+            auto i = data_index(image.layout, b.offset);
+            if (!i || b.offset % sizeof(uint32_t))
+                throw std::runtime_error(core_name(image.devinfo, image.index)
+                    + " has volatile bits outside of its configuration");
+            masks[*i] &= ~b.mask;
+        }
+        return masks;
+    }
+
+    template <class T>
+    void append(std::vector<unsigned char> &buf, const T &value)
+    {
+        auto p = (const unsigned char *)&value;
+        buf.insert(buf.end(), p, p + sizeof value);
+    }
+
+    struct reader {
+        const std::vector<unsigned char> &buf;
+        size_t pos = 0;
+
+        template <class T> T get()
+        {
+            T value;
+            if (buf.size() - pos < sizeof value)
+                throw std::runtime_error("truncated board snapshot");
+            memcpy(&value, buf.data() + pos, sizeof value);
+            pos += sizeof value;
+            return value;
+        }
+    };
+}
+
+std::vector<core_image> take(
+    struct pcie_bars &bars, std::vector<skipped_core> *skipped)
+{
+    /* the controllers are only used for matching and for their layouts, so
+     * they don't need device information */
+    std::vector<std::unique_ptr<RegisterController>> controllers;
+    for (const auto &f : controller_factories)
+        controllers.push_back(f.make(bars));
+
+    std::vector<core_image> images;
+    std::map<std::pair<uint64_t, uint32_t>, unsigned> positions;
+    for (const auto &devinfo : list_devices(bars)) {
+        const unsigned index
+            = positions[{ devinfo.vendor_id, devinfo.device_id }]++;
+
+        auto c = std::find_if(controllers.begin(), controllers.end(),
+            [&devinfo](const auto &c) {
+                return c->match_devinfo_lambda(devinfo);
+            });
+        if (c == controllers.end())
+            continue;
+
+        core_image image { devinfo, index, (*c)->get_config_layout(), { } };
+        if (image.layout.regions.empty()) {
+            if (skipped)
+                skipped->push_back({
+                    controller_factories[c - controllers.begin()].name,
+                    devinfo, index });
+            continue;
+        }
+        for (const auto &r : image.layout.regions) {
+            const size_t pos = image.data.size();
+            image.data.resize(pos + r.size / sizeof(uint32_t));
+            bar4_read_v(
+                &bars, devinfo.start_addr + r.offset, &image.data[pos], r.size);
+        }
+
+        const auto masks = config_masks(image);
+        for (size_t i = 0; i < masks.size(); i++)
+            image.data[i] &= masks[i];
+        images.push_back(std::move(image));
+    }
+    return images;
+}
+
+void save(const std::string &path, const std::vector<core_image> &images)
+{
+    std::vector<unsigned char> buf;
+
+    snapshot_file_header h = { };
+    memcpy(h.magic, snapshot_magic, sizeof h.magic);
+    h.version = snapshot_version;
+    h.header_size = sizeof h;
+    h.num_cores = images.size();
+    append(buf, h);
+
+    for (const auto &image : images) {
+        config_masks(image);
+
+        snapshot_file_core c = { };
+        c.vendor_id = image.devinfo.vendor_id;
+        c.device_id = image.devinfo.device_id;
+        c.abi_ver_major = image.devinfo.abi_ver_major;
+        c.abi_ver_minor = image.devinfo.abi_ver_minor;
+        c.index = image.index;
+        c.start_addr = image.devinfo.start_addr;
+        c.num_regions = image.layout.regions.size();
+        c.num_volatile_bits = image.layout.volatile_bits.size();
+        append(buf, c);
+
+        for (const auto &r : image.layout.regions)
+            append(buf,
+                snapshot_file_entry { (uint32_t)r.offset, (uint32_t)r.size });
+        for (const auto &b : image.layout.volatile_bits)
+            append(buf, snapshot_file_entry { (uint32_t)b.offset, b.mask });
+        for (auto word : image.data)
+            append(buf, word);
+    }
+
+    /* write a new file and rename it, so an existing snapshot is only
+     * replaced by a complete one */
+    const std::string tmp_path = path + ".tmp";
+    int fd = open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+        0644);
+    if (fd < 0)
+        throw_errno("couldn't create " + tmp_path);
+    for (size_t pos = 0; pos < buf.size();) {
+        ssize_t r = write(fd, buf.data() + pos, buf.size() - pos);
+        if (r < 0) {
+            if (errno == EINTR)
+                continue;
+            close(fd);
+            unlink(tmp_path.c_str());
+            throw_errno("couldn't write " + tmp_path);
+        }
+        pos += r;
+    }
+    if (close(fd) < 0 || rename(tmp_path.c_str(), path.c_str()) < 0) {
+        unlink(tmp_path.c_str());
+        throw_errno("couldn't write " + path);
+    }
+}
+
+std::vector<core_image> load(const std::string &path)
+{
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        throw_errno("couldn't open " + path);
+
+    std::vector<unsigned char> buf;
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        throw_errno("couldn't stat " + path);
+    }
+    buf.resize(st.st_size);
+    for (size_t pos = 0; pos < buf.size();) {
+        ssize_t r = read(fd, buf.data() + pos, buf.size() - pos);
+        if (r < 0 && errno == EINTR)
+            continue;
+        if (r <= 0) {
+            close(fd);
+            if (r == 0)
+                throw std::runtime_error("truncated board snapshot");
+            throw_errno("couldn't read " + path);
+        }
+        pos += r;
+    }
+    close(fd);
+
+    reader rd { buf };
+    const auto h = rd.get<snapshot_file_header>();
+    if (memcmp(h.magic, snapshot_magic, sizeof h.magic))
+        throw std::runtime_error("not a board snapshot");
+    if (h.version != snapshot_version || h.header_size < sizeof h)
+        throw std::runtime_error("unsupported board snapshot version");
+    rd.pos = h.header_size;
+
+    std::vector<core_image> images;
+    for (uint32_t i = 0; i < h.num_cores; i++) {
+        const auto c = rd.get<snapshot_file_core>();
+
+        core_image image = { };
+        image.devinfo.vendor_id = c.vendor_id;
+        image.devinfo.device_id = c.device_id;
+        image.devinfo.abi_ver_major = c.abi_ver_major;
+        image.devinfo.abi_ver_minor = c.abi_ver_minor;
+        image.devinfo.start_addr = c.start_addr;
+        image.index = c.index;
+
+        size_t words = 0;
+        for (uint32_t j = 0; j < c.num_regions; j++) {
+            const auto e = rd.get<snapshot_file_entry>();
+            image.layout.regions.push_back({ e.offset, e.value });
+            words += e.value / sizeof(uint32_t);
+        }
+        for (uint32_t j = 0; j < c.num_volatile_bits; j++) {
+            const auto e = rd.get<snapshot_file_entry>();
+            image.layout.volatile_bits.push_back({ e.offset, e.value });
+        }
+        if (words > (buf.size() - rd.pos) / sizeof(uint32_t))
+            throw std::runtime_error("truncated board snapshot");
+        image.data.resize(words);
+        for (auto &word : image.data)
+            word = rd.get<uint32_t>();
+
+        config_masks(image);
+        images.push_back(std::move(image));
+    }
+    return images;
+}
+
+struct restore_report restore(
+    struct pcie_bars &bars, const std::vector<core_image> &images)
+{
+    /* every register to write, at its address in BAR4 */
+    struct word {
+        uint64_t addr;
+        uint32_t value, mask;
+    };
+    std::vector<word> words;
+
+    /* find all cores and check their versions before writing anything */
+    const auto devices = list_devices(bars);
+    for (const auto &image : images) {
+        const auto &saved = image.devinfo;
+        auto d = devices.begin();
+        for (unsigned n = 0;; d++) {
+            d = std::find_if(d, devices.end(), [&saved](const auto &d) {
+                return d.vendor_id == saved.vendor_id
+                    && d.device_id == saved.device_id;
+            });
+            if (d == devices.end())
+                throw std::runtime_error(
+                    core_name(saved, image.index) + " not found");
+            if (n++ == image.index)
+                break;
+        }
+        if (d->abi_ver_major != saved.abi_ver_major
+            || d->abi_ver_minor != saved.abi_ver_minor)
+            throw std::runtime_error(core_name(saved, image.index)
+                + " has ABI version " + std::to_string(d->abi_ver_major) + "."
+                + std::to_string(d->abi_ver_minor) + " instead of "
+                + std::to_string(saved.abi_ver_major) + "."
+                + std::to_string(saved.abi_ver_minor));
+
+        const auto masks = config_masks(image);
+        size_t pos = 0;
+        for (const auto &r : image.layout.regions)
+            for (size_t off = 0; off < r.size; off += sizeof(uint32_t)) {
+                words.push_back({ d->start_addr + r.offset + off,
+                    image.data[pos] & masks[pos], masks[pos] });
+                pos++;
+            }
+    }
+
+    std::sort(words.begin(), words.end(),
+        [](const word &a, const word &b) { return a.addr < b.addr; });
+    for (size_t i = 1; i < words.size(); i++)
+        if (words[i].addr == words[i - 1].addr)
+            throw std::runtime_error("board snapshot writes a register twice");
+
+    /* consecutive registers are written and read back in a single burst,
+     * from values laid out in address order */
+    struct burst {
+        size_t first, count;
+    };
+    std::vector<burst> bursts;
+    std::vector<uint32_t> values(words.size()), readback(words.size());
+    for (size_t i = 0; i < words.size(); i++) {
+        values[i] = words[i].value;
+        if (i && words[i].addr == words[i - 1].addr + sizeof(uint32_t))
+            bursts.back().count++;
+        else
+            bursts.push_back({ i, 1 });
+    }
+
+    struct restore_report report = { };
+    report.cores = images.size();
+    report.words = words.size();
+    report.bursts = bursts.size();
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (const auto &b : bursts)
+        bar4_write_v(&bars, words[b.first].addr, &values[b.first],
+            b.count * sizeof(uint32_t));
+    auto t1 = std::chrono::steady_clock::now();
+    for (const auto &b : bursts)
+        bar4_read_v(&bars, words[b.first].addr, &readback[b.first],
+            b.count * sizeof(uint32_t));
+    auto t2 = std::chrono::steady_clock::now();
+    report.write_time = t1 - t0;
+    report.verify_time = t2 - t1;
+
+    for (size_t i = 0; i < words.size(); i++)
+        if ((readback[i] ^ words[i].value) & words[i].mask)
+            report.mismatches.push_back(
+                { words[i].addr, words[i].value, readback[i] & words[i].mask });
+
+    return report;
+}
+
+} /* namespace board_snapshot */
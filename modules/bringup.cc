@@ -0,0 +1,128 @@
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "modules/ad9510.h"
+#include "modules/bringup.h"
+#include "modules/fmc250m_4ch.h"
+#include "modules/fmc_active_clk.h"
+#include "modules/si57x_ctrl.h"
+#include "util_sdb.h"
+
+namespace bringup {
+
+namespace {
+    template <typename Controller>
+    bool locate(struct pcie_bars &bars, unsigned pos, Controller &ctl,
+        const device_match_fn &match)
+    {
+        if (auto v = read_sdb(&bars, match, pos)) {
+            ctl.set_devinfo(*v);
+            return true;
+        }
+        return false;
+    }
+}
+
+StepGraph make_board_steps(struct pcie_bars &bars, const board_config &config)
+{
+    StepGraph g;
+    std::vector<size_t> clocks;
+
+    if (config.si57x_freq) {
+        auto si57x = std::make_shared<si57x_ctrl::Controller>(
+            bars, config.si57x_fstartup);
+        if (locate(bars, 0, *si57x, si57x->match_devinfo_lambda)) {
+            auto startup = g.add("si57x read_startup_regs",
+                [si57x]() { return si57x->read_startup_regs(); });
+            clocks.push_back(g.add(
+                "si57x apply_config",
+                [si57x, freq = *config.si57x_freq]() {
+                    return si57x->set_freq(freq) && si57x->apply_config();
+                },
+                { startup }));
+        }
+    }
+    const std::vector<size_t> si57x_steps = clocks;
+
+    for (unsigned i = 0;; i++) {
+        /* controllers are owned by the steps using them */
+        auto fac = std::make_shared<fmc_active_clk::Controller>(bars);
+        if (!locate(bars, i, *fac, fac->match_devinfo_lambda))
+            break;
+        /* the AD9510 is found through the FMC_ACTIVE_CLK core before it */
+        auto ad9510 = std::make_shared<ad9510::Controller>(bars);
+        const bool has_ad9510 = locate(bars, i, *ad9510,
+            [&ad9510](auto const &d) { return ad9510->match_devinfo(d); });
+
+        const auto suffix = " " + std::to_string(i);
+        auto fac_step = g.add(
+            "fmc_active_clk" + suffix,
+            [fac]() {
+                fac->write_general("SI571_OE", 1);
+                fac->write_general("PLL_FUNCTION", 1);
+                fac->write_general("CLK_SEL", 1);
+                fac->write_params();
+                return true;
+            },
+            si57x_steps);
+        clocks.push_back(fac_step);
+
+        if (has_ad9510)
+            clocks.push_back(g.add("ad9510" + suffix,
+                [ad9510]() { return ad9510->set_defaults(); }, { fac_step }));
+    }
+
+    for (unsigned i = 0;; i++) {
+        auto adc = std::make_shared<fmc250m_4ch::Controller>(bars);
+        if (!locate(bars, i, *adc, adc->match_devinfo_lambda))
+            break;
+
+        g.add(
+            "fmc250m_4ch " + std::to_string(i),
+            [adc]() {
+                adc->write_general("RST_ADCS", 1);
+                adc->write_general("RST_DIV_ADCS", 1);
+                adc->write_general("SLEEP_ADCS", 0);
+                adc->write_params();
+                return true;
+            },
+            clocks);
+    }
+
+    return g;
+}
+
+std::vector<board_report> bring_up(
+    const std::vector<struct pcie_bars *> &boards, const board_config &config)
+{
+    const auto epoch = std::chrono::steady_clock::now();
+    std::vector<board_report> reports(boards.size());
+
+    auto worker = [&](size_t i) {
+        auto &r = reports[i];
+        try {
+            const auto g = make_board_steps(*boards[i], config);
+            r.setup = std::chrono::steady_clock::now() - epoch;
+            r.steps = g.run(epoch);
+            r.critical_path = g.critical_path(r.steps);
+        } catch (const std::exception &e) {
+            /* errors while looking for the cores are reported as a failed
+             * step */
+            r.setup = std::chrono::steady_clock::now() - epoch;
+            r.steps = { { "setup", StepGraph::status::failed, e.what(),
+                r.setup, r.setup } };
+            r.critical_path = { 0 };
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < boards.size(); i++)
+        threads.emplace_back(worker, i);
+    for (auto &t : threads)
+        t.join();
+
+    return reports;
+}
+
+} /* namespace bringup */
@@ -64,4 +64,13 @@ Controller::Controller(struct pcie_bars &bars)
 }
 Controller::~Controller() = default;
 
+struct config_layout Controller::get_config_layout() const
+{
+    return {
+        { { WB_FMC_ACTIVE_CLK_CSR_REG_CLK_DISTRIB, sizeof regs.clk_distrib } },
+        { { WB_FMC_ACTIVE_CLK_CSR_REG_CLK_DISTRIB,
+            WB_FMC_ACTIVE_CLK_CSR_CLK_DISTRIB_PLL_STATUS } },
+    };
+}
+
 } /* namespace fmc_active_clk */
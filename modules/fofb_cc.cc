@@ -1,4 +1,5 @@
 #include <cmath>
+#include <cstddef>
 #include <stdexcept>
 
 #include "modules/fofb_cc.h"
@@ -253,4 +254,121 @@ void Controller::write_params()
         regs.cfg_val | FOFB_CC_REGS_CFG_VAL_ACT_PART);
 }
 
+/* the status registers read by LinkMonitor are contiguous, and laid out in the
+ * same order as in link_sample */
+static_assert(TIME_FRAME_CNT == LINK_UP + 1);
+static_assert(HARD_ERR_CNT_1 == TIME_FRAME_CNT + 1);
+static_assert(SOFT_ERR_CNT_1 == HARD_ERR_CNT_1 + num_links);
+static_assert(FRAME_ERR_CNT_1 == SOFT_ERR_CNT_1 + num_links);
+static_assert(RX_PCK_CNT_1 == FRAME_ERR_CNT_1 + num_links);
+static_assert(TX_PCK_CNT_1 == RX_PCK_CNT_1 + num_links);
+static_assert(num_links == NUMBER_OF_CHANS);
+static_assert(offsetof(link_sample, counters)
+    == offsetof(link_sample, link_up) + 2 * sizeof(uint32_t));
+
+namespace {
+    const size_t LINK_STATUS_SIZE = (TX_PCK_CNT_1 + num_links - LINK_UP) * 4;
+    static_assert(sizeof(link_sample) - offsetof(link_sample, link_up)
+        == LINK_STATUS_SIZE);
+
+    /* counters which go back by more than half their range have been
+     * cleared instead of having wrapped around */
+    uint32_t counter_delta(uint32_t cur, uint32_t prev)
+    {
+        const uint32_t delta = cur - prev;
+        return delta > UINT32_MAX / 2 ? cur : delta;
+    }
+}
+
+LinkStats::LinkStats(size_t history_size)
+    : history(history_size)
+{
+    if (history_size < 2)
+        throw std::logic_error("history must hold at least 2 samples");
+}
+
+size_t LinkStats::size() const
+{
+    return count;
+}
+
+const link_sample &LinkStats::sample(size_t age) const
+{
+    if (age >= count)
+        throw std::out_of_range("sample is not in history");
+
+    return history[(head + history.size() - 1 - age) % history.size()];
+}
+
+std::array<link_rates, num_links> LinkStats::add(
+    const link_sample &new_sample)
+{
+    link_sample &cur = history[head];
+    cur = new_sample;
+
+    head = (head + 1) % history.size();
+    if (count < history.size())
+        count++;
+
+    std::array<link_rates, num_links> r { };
+    for (unsigned i = 0; i < num_links; i++)
+        r[i].up = cur.link_up & (1U << i);
+    if (count < 2)
+        return r;
+
+    const link_sample &prev = sample(1), &oldest = sample(count - 1);
+    const double dt
+        = std::chrono::duration<double>(cur.timestamp - prev.timestamp).count();
+    const double dt_history
+        = std::chrono::duration<double>(cur.timestamp - oldest.timestamp)
+              .count();
+
+    for (unsigned i = 0; i < num_links; i++) {
+        link_rates &l = r[i];
+        for (unsigned c = 0; c < num_link_counters; c++) {
+            l.deltas[c]
+                = counter_delta(cur.counters[c][i], prev.counters[c][i]);
+            l.rates[c] = l.deltas[c] / dt;
+        }
+
+        if (!l.up && (prev.link_up & (1U << i)))
+            l.anomalies |= link_lost;
+
+        const double errors
+            = l.rates[hard_err] + l.rates[soft_err] + l.rates[frame_err];
+        if (errors > limits.max_error_rate)
+            l.anomalies |= error_rate;
+
+        /* the average is only meaningful with more than one interval */
+        if (count > 2) {
+            const double average = counter_delta(cur.counters[rx_pck][i],
+                                       oldest.counters[rx_pck][i])
+                / dt_history;
+            if (l.rates[rx_pck] < limits.packet_drop_ratio * average)
+                l.anomalies |= packet_rate_drop;
+        }
+    }
+
+    return r;
+}
+
+LinkMonitor::LinkMonitor(struct pcie_bars &bars, size_t history_size)
+    : RegisterDecoderBase(bars, ref_devinfo)
+    , LinkStats(history_size)
+{
+}
+
+std::array<link_rates, num_links> LinkMonitor::update()
+{
+    check_devinfo_is_set();
+
+    link_sample cur;
+    bar4_read_v(&bars,
+        addr + offsetof(fofb_cc_regs, ram_reg[LINK_UP]), &cur.link_up,
+        LINK_STATUS_SIZE);
+    cur.timestamp = std::chrono::steady_clock::now();
+
+    return add(cur);
+}
+
 } /* namespace fofb_cc */
@@ -1,8 +1,12 @@
 #include <algorithm>
+#include <array>
 #include <cstring>
+#include <span>
 #include <stdexcept>
+#include <string>
 #include <type_traits>
 
+#include "matrix_file.h"
 #include "modules/fofb_processing.h"
 #include "pcie.h"
 #include "printer.h"
@@ -14,6 +18,9 @@ namespace fofb_processing {
 
 static_assert(WB_FOFB_PROCESSING_REGS_SPS_RAM_BANK
     == offsetof(wb_fofb_processing_regs, sps_ram_bank));
+/* coefficients are converted in batches, and copied as arrays of words */
+static_assert(sizeof(wb_fofb_processing_regs::ch::coeff_ram_bank)
+    == WB_FOFB_PROCESSING_REGS_CH_COEFF_RAM_BANK_SIZE * 512);
 /* check channel 1 to make sure all values are correct, including the channel
  * size */
 static_assert(WB_FOFB_PROCESSING_REGS_CH
@@ -130,22 +137,16 @@ void Core::decode()
 
     /* XXX: use C++20's std::ranges::generate when available */
 
+    std::array<uint32_t, 2 * MAX_BPMS> ram_bank;
     for (unsigned i = 0; i < *number_of_channels; i++) {
-        auto &ram_bank = regs.ch[i].coeff_ram_bank;
-        const size_t elements = MAX_BPMS;
-        coefficients_x[i].resize(elements);
-        coefficients_y[i].resize(elements);
-
-        size_t u = 0;
-        std::generate(
-            coefficients_x[i].begin(), coefficients_x[i].end(), [&]() {
-                return fixed2float(ram_bank[u++].data, fixed_point_coeff);
-            });
-        u = MAX_BPMS;
-        std::generate(
-            coefficients_y[i].begin(), coefficients_y[i].end(), [&]() {
-                return fixed2float(ram_bank[u++].data, fixed_point_coeff);
-            });
+        memcpy(ram_bank.data(), regs.ch[i].coeff_ram_bank, sizeof ram_bank);
+        coefficients_x[i].resize(MAX_BPMS);
+        coefficients_y[i].resize(MAX_BPMS);
+
+        fixed2float(std::span(ram_bank).first(MAX_BPMS), coefficients_x[i],
+            fixed_point_coeff);
+        fixed2float(std::span(ram_bank).last(MAX_BPMS), coefficients_y[i],
+            fixed_point_coeff);
 
         add_channel("CH_ACC_CTL_FREEZE", i,
             get_bit(
@@ -228,8 +229,40 @@ void Controller::set_devinfo_callback()
         WB_FOFB_PROCESSING_REGS_FIXED_POINT_POS_ACCS_GAINS_VAL_MASK);
 }
 
+void Controller::check_ref_orb() const
+{
+    if (ref_orb_x.size() != MAX_BPMS || ref_orb_y.size() != MAX_BPMS)
+        throw std::logic_error("reference orbit must have "
+            + std::to_string(MAX_BPMS) + " elements per plane");
+}
+
+void Controller::encode_ref_orb()
+{
+    check_ref_orb();
+
+    for (unsigned j = 0; j < MAX_BPMS; j++) {
+        regs.sps_ram_bank[j].data = ref_orb_x[j];
+        regs.sps_ram_bank[j + MAX_BPMS].data = ref_orb_y[j];
+    }
+}
+
 void Controller::encode_params()
 {
+    /* update_ref_orb() uses regs as a copy of what's in the device, so every
+     * parameter is validated before anything in regs changes */
+    if (parameters.size() != MAX_NUM_CHAN)
+        throw std::logic_error("there must be parameters for "
+            + std::to_string(MAX_NUM_CHAN) + " channels");
+    for (const auto &p : parameters) {
+        if (p.sp_decim_ratio < 1)
+            throw std::runtime_error("decimation ratio can't be 0");
+        if (p.coefficients_x.size() != MAX_BPMS
+            || p.coefficients_y.size() != MAX_BPMS)
+            throw std::logic_error("coefficients must have "
+                + std::to_string(MAX_BPMS) + " elements per plane");
+    }
+    encode_ref_orb();
+
     insert_bit(regs.loop_intlk.ctl, intlk_sta_clr,
         WB_FOFB_PROCESSING_REGS_LOOP_INTLK_CTL_STA_CLR);
     insert_bit(regs.loop_intlk.ctl, intlk_en_orb_distort,
@@ -240,21 +273,13 @@ void Controller::encode_params()
     regs.loop_intlk.orb_distort_limit = orb_distort_limit;
     regs.loop_intlk.min_num_pkts = min_num_packets;
 
-    for (unsigned j = 0; j < MAX_BPMS; j++) {
-        regs.sps_ram_bank[j].data = ref_orb_x[j];
-        regs.sps_ram_bank[j + MAX_BPMS].data = ref_orb_y[j];
-    }
-
     for (unsigned i = 0; i < MAX_NUM_CHAN; i++) {
-        if (parameters[i].sp_decim_ratio < 1)
-            throw std::runtime_error("decimation ratio can't be 0");
-
-        for (unsigned j = 0; j < MAX_BPMS; j++) {
-            regs.ch[i].coeff_ram_bank[j].data = float2fixed(
-                parameters[i].coefficients_x[j], fixed_point_coeff);
-            regs.ch[i].coeff_ram_bank[j + MAX_BPMS].data = float2fixed(
-                parameters[i].coefficients_y[j], fixed_point_coeff);
-        }
+        std::array<uint32_t, 2 * MAX_BPMS> ram_bank;
+        float2fixed(parameters[i].coefficients_x,
+            std::span(ram_bank).first(MAX_BPMS), fixed_point_coeff);
+        float2fixed(parameters[i].coefficients_y,
+            std::span(ram_bank).last(MAX_BPMS), fixed_point_coeff);
+        memcpy(regs.ch[i].coeff_ram_bank, ram_bank.data(), sizeof ram_bank);
 
         insert_bit(regs.ch[i].acc.ctl, parameters[i].acc_clear,
             WB_FOFB_PROCESSING_REGS_CH_ACC_CTL_CLEAR);
@@ -283,4 +308,146 @@ void Controller::write_params()
         p.acc_clear = false;
 }
 
+struct config_layout Controller::get_config_layout() const
+{
+    /* the loop interlock limits, the reference orbit and each channel's
+     * coefficients, accumulator, limits and decimation ratio; the decimated
+     * setpoint before the ratio is read only */
+    struct config_layout layout = {
+        {
+            { WB_FOFB_PROCESSING_REGS_LOOP_INTLK_CTL,
+                sizeof regs.loop_intlk.ctl },
+            { WB_FOFB_PROCESSING_REGS_LOOP_INTLK_ORB_DISTORT_LIMIT,
+                sizeof regs.loop_intlk.orb_distort_limit
+                    + sizeof regs.loop_intlk.min_num_pkts },
+            { WB_FOFB_PROCESSING_REGS_SPS_RAM_BANK, sizeof regs.sps_ram_bank },
+        },
+        {
+            { WB_FOFB_PROCESSING_REGS_LOOP_INTLK_CTL,
+                WB_FOFB_PROCESSING_REGS_LOOP_INTLK_CTL_STA_CLR },
+        },
+    };
+    for (unsigned i = 0; i < MAX_NUM_CHAN; i++) {
+        const size_t ch
+            = WB_FOFB_PROCESSING_REGS_CH + i * WB_FOFB_PROCESSING_REGS_CH_SIZE;
+        layout.regions.push_back(
+            { ch + WB_FOFB_PROCESSING_REGS_CH_COEFF_RAM_BANK,
+                sizeof regs.ch[i].coeff_ram_bank });
+        layout.regions.push_back({ ch + WB_FOFB_PROCESSING_REGS_CH_ACC_CTL,
+            sizeof regs.ch[i].acc.ctl + sizeof regs.ch[i].acc.gain });
+        layout.regions.push_back({ ch + WB_FOFB_PROCESSING_REGS_CH_SP_LIMITS,
+            sizeof regs.ch[i].sp_limits });
+        layout.regions.push_back(
+            { ch + WB_FOFB_PROCESSING_REGS_CH_SP_DECIM_RATIO,
+                sizeof regs.ch[i].sp_decim.ratio });
+        layout.volatile_bits.push_back(
+            { ch + WB_FOFB_PROCESSING_REGS_CH_ACC_CTL,
+                WB_FOFB_PROCESSING_REGS_CH_ACC_CTL_CLEAR });
+    }
+    return layout;
+}
+
+void Controller::write_ref_orb()
+{
+    check_devinfo_is_set();
+
+    encode_ref_orb();
+    bar4_write_v(&bars, addr + WB_FOFB_PROCESSING_REGS_SPS_RAM_BANK,
+        regs.sps_ram_bank, sizeof regs.sps_ram_bank);
+}
+
+void Controller::update_ref_orb(
+    const std::vector<ref_orb_change> &x, const std::vector<ref_orb_change> &y)
+{
+    check_devinfo_is_set();
+
+    /* all changes are checked before any of them is applied, so regs keeps
+     * matching the device if one is invalid */
+    check_ref_orb();
+    for (const auto *changes : { &x, &y })
+        for (const auto &c : *changes)
+            if (c.bpm >= MAX_BPMS)
+                throw std::logic_error("BPM " + std::to_string(c.bpm)
+                    + " doesn't exist, maximum is "
+                    + std::to_string(MAX_BPMS - 1));
+
+    /* words which have to be written; regs holds what was written last */
+    std::array<bool, 2 * MAX_BPMS> dirty { };
+
+    auto apply = [this, &dirty](const std::vector<ref_orb_change> &changes,
+                     std::vector<int32_t> &ref_orb, unsigned offset) {
+        for (const auto &c : changes) {
+            ref_orb.at(c.bpm) = c.value;
+            auto &word = regs.sps_ram_bank[offset + c.bpm].data;
+            if (word != (uint32_t)c.value) {
+                word = c.value;
+                dirty[offset + c.bpm] = true;
+            }
+        }
+    };
+    apply(x, ref_orb_x, 0);
+    apply(y, ref_orb_y, MAX_BPMS);
+
+    for (unsigned i = 0; i < dirty.size();) {
+        if (!dirty[i]) {
+            i++;
+            continue;
+        }
+
+        unsigned end = i + 1;
+        while (end < dirty.size() && dirty[end])
+            end++;
+        bar4_write_v(&bars,
+            addr + WB_FOFB_PROCESSING_REGS_SPS_RAM_BANK
+                + i * sizeof regs.sps_ram_bank[0],
+            &regs.sps_ram_bank[i], (end - i) * sizeof regs.sps_ram_bank[0]);
+        i = end;
+    }
+}
+
+void Controller::write_coefficients(const MatrixFile &m)
+{
+    check_devinfo_is_set();
+
+    if (m.rows() > MAX_NUM_CHAN || m.cols() != 2 * MAX_BPMS)
+        throw std::runtime_error("coefficient matrix must have up to "
+            + std::to_string(MAX_NUM_CHAN) + " rows and "
+            + std::to_string(2 * MAX_BPMS) + " columns");
+    if (m.is_fixed_point() && m.fixed_point_pos() != fixed_point_coeff)
+        throw std::runtime_error("coefficient matrix has fixed point position "
+            + std::to_string(m.fixed_point_pos()) + ", but core uses "
+            + std::to_string(fixed_point_coeff));
+
+    for (unsigned i = 0; i < m.rows(); i++) {
+        auto &ram_bank = regs.ch[i].coeff_ram_bank;
+        auto &p = parameters[i];
+        p.coefficients_x.resize(MAX_BPMS);
+        p.coefficients_y.resize(MAX_BPMS);
+
+        if (m.is_fixed_point()) {
+            auto row = m.row_fixed(i);
+            memcpy(ram_bank, row.data(), sizeof ram_bank);
+
+            fixed2float(row.first(MAX_BPMS), p.coefficients_x,
+                fixed_point_coeff);
+            fixed2float(row.last(MAX_BPMS), p.coefficients_y,
+                fixed_point_coeff);
+        } else {
+            auto row = m.row(i);
+            std::array<uint32_t, 2 * MAX_BPMS> raw;
+            float2fixed(row, raw, fixed_point_coeff);
+            memcpy(ram_bank, raw.data(), sizeof ram_bank);
+
+            std::ranges::copy(row.first(MAX_BPMS), p.coefficients_x.begin());
+            std::ranges::copy(row.last(MAX_BPMS), p.coefficients_y.begin());
+        }
+
+        bar4_write_v(&bars,
+            addr + WB_FOFB_PROCESSING_REGS_CH
+                + WB_FOFB_PROCESSING_REGS_CH_COEFF_RAM_BANK
+                + i * WB_FOFB_PROCESSING_REGS_CH_SIZE,
+            ram_bank, sizeof ram_bank);
+    }
+}
+
 } /* namespace fofb_processing */
@@ -1,5 +1,8 @@
 #include <algorithm>
+#include <span>
 #include <stdexcept>
+#include <string>
+#include <vector>
 
 #include "modules/fofb_shaper_filt.h"
 #include "pcie.h"
@@ -22,6 +25,8 @@ namespace {
                  NUM_BIQUADS = 10, COEFFS_PER_BIQUAD = 5, UNUSED_PER_BIQUAD = 3,
                  TOTAL_PER_BIQUAD = COEFFS_PER_BIQUAD + UNUSED_PER_BIQUAD;
     static_assert(NUM_COEFFS == NUM_BIQUADS * TOTAL_PER_BIQUAD);
+    /* changed channels are tracked in a bit mask */
+    static_assert(NUM_CHANNELS <= 32);
 
     constexpr unsigned FOFB_SHAPER_FILT_DEVID = 0xf65559b2;
     struct sdb_device_info ref_devinfo = { .vendor_id = LNLS_VENDORID,
@@ -71,14 +76,15 @@ void Core::decode()
 
     coefficients.set_num_biquads(num_biquads);
 
+    /* gather the used coefficients, so each channel is converted at once */
+    std::vector<uint32_t> raw(num_biquads * COEFFS_PER_BIQUAD);
     for (unsigned i = 0; i < NUM_CHANNELS; i++) {
-        for (unsigned j = 0; j < num_biquads; j++) {
-            for (unsigned k = 0; k < COEFFS_PER_BIQUAD; k++) {
-                coefficients.values[i][k + COEFFS_PER_BIQUAD * j] = fixed2float(
-                    regs.ch[i].coeffs[k + TOTAL_PER_BIQUAD * j].val,
-                    fixed_point_coeff);
-            }
-        }
+        for (unsigned j = 0; j < num_biquads; j++)
+            for (unsigned k = 0; k < COEFFS_PER_BIQUAD; k++)
+                raw[k + COEFFS_PER_BIQUAD * j]
+                    = regs.ch[i].coeffs[k + TOTAL_PER_BIQUAD * j].val;
+
+        fixed2float(raw, coefficients.values[i], fixed_point_coeff);
     }
 }
 
@@ -113,6 +119,18 @@ Controller::Controller(struct pcie_bars &bars)
 }
 Controller::~Controller() = default;
 
+struct config_layout Controller::get_config_layout() const
+{
+    /* all biquads, even unused ones, along with the unused words between
+     * them, which are written back with the values read from them */
+    struct config_layout layout;
+    for (unsigned i = 0; i < NUM_CHANNELS; i++)
+        layout.regions.push_back({ WB_FOFB_SHAPER_FILT_REGS_CH
+                + i * sizeof regs.ch[0] + WB_FOFB_SHAPER_FILT_REGS_CH_COEFFS,
+            sizeof regs.ch[0].coeffs });
+    return layout;
+}
+
 void Controller::set_devinfo_callback()
 {
     regs.coeffs_fp_repr
@@ -124,35 +142,90 @@ void Controller::set_devinfo_callback()
     regs.num_biquads
         = bar4_read(&bars, addr + WB_FOFB_SHAPER_FILT_REGS_NUM_BIQUADS);
     num_biquads = regs.num_biquads;
+    if (num_biquads > NUM_BIQUADS)
+        throw std::runtime_error("device has more biquads than supported");
+
+    /* the unused words between biquads are written back with the values read
+     * here, which allows writing each channel in a single burst */
+    bar4_read_v(&bars, addr + WB_FOFB_SHAPER_FILT_REGS_CH, regs.ch,
+        sizeof regs.ch);
+    changed_channels = 0;
 }
 
 void Controller::encode_params()
 {
+    std::vector<uint32_t> raw(num_biquads * COEFFS_PER_BIQUAD);
     for (unsigned i = 0; i < NUM_CHANNELS; i++) {
-        for (unsigned j = 0; j < num_biquads; j++) {
+        if (coefficients.values[i].size() < raw.size())
+            throw std::logic_error("channel " + std::to_string(i) + " needs "
+                + std::to_string(raw.size()) + " coefficients");
+        float2fixed(std::span(coefficients.values[i]).first(raw.size()), raw,
+            fixed_point_coeff);
+
+        for (unsigned j = 0; j < num_biquads; j++)
             for (unsigned k = 0; k < COEFFS_PER_BIQUAD; k++) {
-                regs.ch[i].coeffs[k + TOTAL_PER_BIQUAD * j].val = float2fixed(
-                    coefficients.values[i][k + COEFFS_PER_BIQUAD * j],
-                    fixed_point_coeff);
+                auto &val = regs.ch[i].coeffs[k + TOTAL_PER_BIQUAD * j].val;
+                if (val != raw[k + COEFFS_PER_BIQUAD * j]) {
+                    val = raw[k + COEFFS_PER_BIQUAD * j];
+                    changed_channels |= 1U << i;
+                }
             }
-        }
     }
 }
 
-void Controller::write_params()
+BiquadCascade Controller::make_simulator(
+    fixed_point_format signal_format) const
 {
-    encode_params();
+    check_devinfo_is_set();
 
+    std::vector<std::vector<double>> used(NUM_CHANNELS);
     for (unsigned i = 0; i < NUM_CHANNELS; i++) {
-        for (unsigned j = 0; j < num_biquads; j++) {
-            bar4_write_v(&bars,
-                addr + WB_FOFB_SHAPER_FILT_REGS_CH_COEFFS
-                    + i * sizeof(regs.ch[0])
-                    + TOTAL_PER_BIQUAD * j * sizeof(uint32_t),
-                &regs.ch[i].coeffs[TOTAL_PER_BIQUAD * j].val,
-                COEFFS_PER_BIQUAD * sizeof(uint32_t));
-        }
+        const auto &values = coefficients.values[i];
+        if (values.size() < num_biquads * COEFFS_PER_BIQUAD)
+            throw std::logic_error("channel " + std::to_string(i) + " needs "
+                + std::to_string(num_biquads * COEFFS_PER_BIQUAD)
+                + " coefficients");
+        used[i].assign(
+            values.begin(), values.begin() + num_biquads * COEFFS_PER_BIQUAD);
+    }
+
+    const fixed_point_format coeff_format = { 32 - fixed_point_coeff,
+        extract_value<uint8_t>(regs.coeffs_fp_repr,
+            WB_FOFB_SHAPER_FILT_REGS_COEFFS_FP_REPR_FRAC_WIDTH_MASK) };
+    return { used, coeff_format, signal_format };
+}
+
+void Controller::write_channels(uint32_t channels)
+{
+    /* each channel is written in one burst, from the first coefficient to the
+     * last used one, which includes the unused words in between */
+    const size_t burst_size = num_biquads
+        ? ((num_biquads - 1) * TOTAL_PER_BIQUAD + COEFFS_PER_BIQUAD)
+            * sizeof(uint32_t)
+        : 0;
+    for (unsigned i = 0; i < NUM_CHANNELS; i++) {
+        if (!(channels & (1U << i)))
+            continue;
+
+        bar4_write_v(&bars,
+            addr + WB_FOFB_SHAPER_FILT_REGS_CH_COEFFS + i * sizeof(regs.ch[0]),
+            &regs.ch[i].coeffs[0].val, burst_size);
     }
+    changed_channels = 0;
+}
+
+void Controller::write_params()
+{
+    check_devinfo_is_set();
+    encode_params();
+    write_channels((1U << NUM_CHANNELS) - 1);
+}
+
+void Controller::write_changed_params()
+{
+    check_devinfo_is_set();
+    encode_params();
+    write_channels(changed_channels);
 }
 
 } /* namespace fofb_shaper_filt */
@@ -4,6 +4,11 @@
 
 namespace isla216p {
 
+namespace {
+    /* W1:W0 in the instruction allow transfers of up to 4 bytes */
+    constexpr size_t MAX_BLOCK = 4;
+}
+
 Controller::Controller(struct pcie_bars &bars)
     : spi_regs(bars)
     , f250_regs(bars)
@@ -59,15 +64,36 @@ bool Controller::get_reg(uint8_t addr, uint8_t &rdata, spi::Channel channel)
         wdata, sizeof wdata, &rdata, sizeof rdata, channel.channel);
 }
 
-bool Controller::set_reg(uint8_t addr, uint8_t rdata, spi::Channel channel)
+bool Controller::set_reg(uint8_t addr, uint8_t value, spi::Channel channel)
 {
     const unsigned char wdata[] = {
         0x00, /* write 1 byte */
         addr,
+        value,
     };
 
     return spi_regs.write_read_data(
-        wdata, sizeof wdata, &rdata, sizeof rdata, channel.channel);
+        wdata, sizeof wdata, nullptr, 0, channel.channel);
+}
+
+bool Controller::get_regs(
+    uint8_t addr, std::span<uint8_t> values, spi::Channel channel)
+{
+    return spi::CommandQueue(spi_regs, channel, MAX_BLOCK)
+        .read_block(addr, values);
+}
+
+bool Controller::set_regs(
+    uint8_t addr, std::span<const uint8_t> values, spi::Channel channel)
+{
+    return spi::CommandQueue(spi_regs, channel, MAX_BLOCK)
+        .write_block(addr, values);
+}
+
+spi::CommandResult Controller::run(
+    std::span<const spi::Command> commands, spi::Channel channel)
+{
+    return spi::CommandQueue(spi_regs, channel, MAX_BLOCK).run(commands);
 }
 
 bool Controller::set_defaults(spi::Channel) { return false; }
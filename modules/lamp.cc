@@ -1,4 +1,10 @@
+#include <algorithm>
+#include <cmath>
 #include <cstring>
+#include <stdexcept>
+
+#include <pthread.h>
+#include <sched.h>
 
 #include "pcie.h"
 #include "printer.h"
@@ -9,14 +15,29 @@
 namespace lamp {
 #include "hw/wb_rtmlamp_ohwr_regs.h"
 
+static_assert(WB_RTMLAMP_OHWR_REGS_CH + WB_RTMLAMP_OHWR_REGS_CH_SIZE
+    == offsetof(wb_rtmlamp_ohwr_regs, ch[1]));
+static_assert(WB_RTMLAMP_OHWR_REGS_CH + WB_RTMLAMP_OHWR_REGS_CH_PI_SP
+    == offsetof(wb_rtmlamp_ohwr_regs, ch[0].pi_sp));
+/* both setpoints can be written in a single burst */
+static_assert(WB_RTMLAMP_OHWR_REGS_CH + WB_RTMLAMP_OHWR_REGS_CH_DAC
+    == offsetof(wb_rtmlamp_ohwr_regs, ch[0].dac));
+static_assert(
+    WB_RTMLAMP_OHWR_REGS_CH_DAC == WB_RTMLAMP_OHWR_REGS_CH_PI_SP + 4);
+
 namespace {
-    static constexpr unsigned NUM_CHAN = 12;
+    static constexpr unsigned NUM_CHAN = num_channels;
     static constexpr unsigned TRIGGER_ENABLE_VERSION = 1;
 
     constexpr unsigned LAMP_DEVID = 0xa1248bec;
     struct sdb_device_info ref_devinfo = {
         .vendor_id = LNLS_VENDORID, .device_id = LAMP_DEVID, .abi_ver_major = 2
     };
+
+    /* the player sleeps until this long before each sample, and spins for
+     * the rest of the time, since waking up from sleep isn't precise */
+    constexpr auto spin_time = std::chrono::microseconds(100);
+    constexpr int player_priority = 50;
 }
 
 const std::vector<std::string> mode_list({
@@ -197,10 +218,227 @@ Controller::Controller(struct pcie_bars &bars)
 }
 Controller::~Controller() = default;
 
+void Controller::set_devinfo_callback()
+{
+    /* set_setpoint() compares against regs, so it must start with the
+     * device's setpoints; they are read with the rest of the channels in a
+     * single burst */
+    decltype(regs.ch) channels;
+    bar4_read_v(&bars, addr + WB_RTMLAMP_OHWR_REGS_CH, channels,
+        sizeof channels);
+    for (unsigned i = 0; i < NUM_CHAN; i++) {
+        regs.ch[i].pi_sp = channels[i].pi_sp;
+        regs.ch[i].dac = channels[i].dac;
+    }
+    dirty_dac = dirty_pi_sp = 0;
+}
+
 void Controller::unset_commands()
 {
     for (unsigned i = 0; i < NUM_CHAN; i++)
         write_channel("RST_LATCH", i, 0);
 }
 
+struct config_layout Controller::get_config_layout() const
+{
+    /* the global control register is reserved, and each channel's
+     * configuration goes from its control register to the test mode period */
+    struct config_layout layout;
+    for (unsigned i = 0; i < NUM_CHAN; i++) {
+        const size_t ch
+            = WB_RTMLAMP_OHWR_REGS_CH + i * WB_RTMLAMP_OHWR_REGS_CH_SIZE;
+        layout.regions.push_back({ ch + WB_RTMLAMP_OHWR_REGS_CH_CTL,
+            WB_RTMLAMP_OHWR_REGS_CH_ADC_DAC_EFF
+                - WB_RTMLAMP_OHWR_REGS_CH_CTL });
+        layout.volatile_bits.push_back({ ch + WB_RTMLAMP_OHWR_REGS_CH_CTL,
+            WB_RTMLAMP_OHWR_REGS_CH_CTL_RST_LATCH_STS });
+    }
+    return layout;
+}
+
+SetpointHandle Controller::get_setpoint_handle(
+    unsigned channel, setpoint_type type)
+{
+    if (channel >= NUM_CHAN)
+        throw std::out_of_range("channel " + std::to_string(channel)
+            + " doesn't exist, maximum is " + std::to_string(NUM_CHAN - 1));
+    return { channel, type };
+}
+
+void Controller::set_setpoint(SetpointHandle handle, int16_t value)
+{
+    const bool dac = handle.type == setpoint_type::dac;
+    auto &channel_regs = regs.ch[handle.channel];
+    auto &reg = dac ? channel_regs.dac : channel_regs.pi_sp;
+    const uint32_t mask = dac ? WB_RTMLAMP_OHWR_REGS_CH_DAC_DATA_MASK
+                              : WB_RTMLAMP_OHWR_REGS_CH_PI_SP_DATA_MASK;
+    /* regs holds what was written last, or what the device had when the
+     * device information was set */
+    const uint32_t word = (reg & ~mask) | ((uint16_t)value & mask);
+    if (word == reg)
+        return;
+    reg = word;
+    (dac ? dirty_dac : dirty_pi_sp) |= 1U << handle.channel;
+}
+
+void Controller::write_setpoints()
+{
+    check_devinfo_is_set();
+
+    /* channels aren't contiguous, since other registers lie between their
+     * setpoints, so each one gets its own write */
+    for (unsigned i = 0; i < NUM_CHAN; i++) {
+        const uint32_t bit = 1U << i;
+        const size_t ch_addr
+            = addr + WB_RTMLAMP_OHWR_REGS_CH + i * WB_RTMLAMP_OHWR_REGS_CH_SIZE;
+        if (dirty_pi_sp & dirty_dac & bit)
+            bar4_write_v(&bars, ch_addr + WB_RTMLAMP_OHWR_REGS_CH_PI_SP,
+                &regs.ch[i].pi_sp, 2 * sizeof(uint32_t));
+        else if (dirty_pi_sp & bit)
+            bar4_write(&bars, ch_addr + WB_RTMLAMP_OHWR_REGS_CH_PI_SP,
+                regs.ch[i].pi_sp);
+        else if (dirty_dac & bit)
+            bar4_write(
+                &bars, ch_addr + WB_RTMLAMP_OHWR_REGS_CH_DAC, regs.ch[i].dac);
+    }
+    dirty_dac = dirty_pi_sp = 0;
+}
+
+WaveformPlayer::WaveformPlayer(Controller &ctl,
+    std::vector<SetpointHandle> handles,
+    std::vector<std::vector<int16_t>> tables, std::chrono::nanoseconds period,
+    bool loop)
+    : ctl(ctl)
+    , handles(std::move(handles))
+    , tables(std::move(tables))
+    , period(period)
+    , loop(loop)
+{
+    if (this->handles.empty())
+        throw std::logic_error("there must be at least one setpoint");
+    if (this->tables.size() != this->handles.size())
+        throw std::logic_error("there must be one table per setpoint");
+    if (this->tables[0].empty())
+        throw std::logic_error("tables can't be empty");
+    for (const auto &t : this->tables)
+        if (t.size() != this->tables[0].size())
+            throw std::logic_error("all tables must have the same size");
+    if (period <= std::chrono::nanoseconds::zero())
+        throw std::logic_error("period must be positive");
+}
+
+WaveformPlayer::~WaveformPlayer()
+{
+    stop();
+}
+
+void WaveformPlayer::start()
+{
+    if (play_thread.joinable())
+        throw std::logic_error("waveform player is already running");
+
+    stats = { };
+    lateness_sum = lateness_sum_sq = 0;
+    error = nullptr;
+    running = true;
+
+    play_thread = std::thread(&WaveformPlayer::play_loop, this);
+}
+
+void WaveformPlayer::stop()
+{
+    {
+        std::lock_guard lock(m);
+        running = false;
+    }
+    cv.notify_all();
+
+    if (play_thread.joinable())
+        play_thread.join();
+}
+
+bool WaveformPlayer::is_running()
+{
+    std::lock_guard lock(m);
+    return running;
+}
+
+jitter_stats WaveformPlayer::get_stats()
+{
+    std::lock_guard lock(m);
+    if (error)
+        std::rethrow_exception(error);
+    return stats;
+}
+
+void WaveformPlayer::play_loop()
+{
+    using namespace std::chrono;
+
+    /* failing to get real time priority, usually for lack of privileges,
+     * only makes the jitter worse */
+    sched_param param = { };
+    param.sched_priority = player_priority;
+    const bool realtime
+        = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0;
+    {
+        std::lock_guard lock(m);
+        stats.realtime = realtime;
+    }
+
+    const size_t length = tables[0].size();
+    const auto start = steady_clock::now();
+
+    try {
+        for (uint64_t next = 0;;) {
+            const auto scheduled = start + period * next;
+            {
+                /* stop() can interrupt the sleep */
+                std::unique_lock lock(m);
+                cv.wait_until(lock, scheduled - spin_time,
+                    [this] { return !running; });
+                if (!running)
+                    return;
+            }
+            while (steady_clock::now() < scheduled)
+                ;
+
+            const auto t = steady_clock::now();
+            const uint64_t index = (t - start) / period;
+            if (!loop && index >= length) {
+                std::lock_guard lock(m);
+                stats.missed += length - next;
+                running = false;
+                return;
+            }
+
+            for (size_t i = 0; i < handles.size(); i++)
+                ctl.set_setpoint(handles[i], tables[i][index % length]);
+            ctl.write_setpoints();
+            const auto write_time = steady_clock::now() - t;
+
+            const auto lateness = t - (start + period * index);
+            std::lock_guard lock(m);
+            stats.samples++;
+            stats.missed += index - next;
+            lateness_sum += lateness.count();
+            lateness_sum_sq += (double)lateness.count() * lateness.count();
+            stats.mean_lateness = nanoseconds(
+                (int64_t)(lateness_sum / stats.samples));
+            stats.rms_lateness = nanoseconds(
+                (int64_t)std::sqrt(lateness_sum_sq / stats.samples));
+            stats.max_lateness = std::max<nanoseconds>(
+                stats.max_lateness, lateness);
+            stats.max_write_time = std::max<nanoseconds>(
+                stats.max_write_time, write_time);
+
+            next = index + 1;
+        }
+    } catch (...) {
+        std::lock_guard lock(m);
+        error = std::current_exception();
+        running = false;
+    }
+}
+
 } /* namespace lamp */
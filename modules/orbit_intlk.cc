@@ -1,5 +1,11 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
 #include <stdexcept>
 
+#include <sys/eventfd.h>
+#include <unistd.h>
+
 #include "modules/orbit_intlk.h"
 #include "pcie.h"
 #include "printer.h"
@@ -14,6 +20,31 @@ namespace {
     struct sdb_device_info ref_devinfo = { .vendor_id = LNLS_VENDORID,
         .device_id = ORBIT_INTLK_DEVID,
         .abi_ver_major = 1 };
+
+    /* the flags decoded by Core, in the order it decodes them */
+    const std::pair<std::string_view, uint32_t> sts_flags[] = {
+        { "POS_UPPER_X", ORBIT_INTLK_STS_TRANS_BIGGER_X },
+        { "POS_UPPER_Y", ORBIT_INTLK_STS_TRANS_BIGGER_Y },
+        { "POS_UPPER_LTC_X", ORBIT_INTLK_STS_TRANS_BIGGER_LTC_X },
+        { "POS_UPPER_LTC_Y", ORBIT_INTLK_STS_TRANS_BIGGER_LTC_Y },
+        { "ANG_UPPER_X", ORBIT_INTLK_STS_ANG_BIGGER_X },
+        { "ANG_UPPER_Y", ORBIT_INTLK_STS_ANG_BIGGER_Y },
+        { "ANG_UPPER_LTC_X", ORBIT_INTLK_STS_ANG_BIGGER_LTC_X },
+        { "ANG_UPPER_LTC_Y", ORBIT_INTLK_STS_ANG_BIGGER_LTC_Y },
+        { "INTLK", ORBIT_INTLK_STS_INTLK },
+        { "INTLK_LTC", ORBIT_INTLK_STS_INTLK_LTC },
+        { "POS_LOWER_X", ORBIT_INTLK_STS_TRANS_SMALLER_X },
+        { "POS_LOWER_Y", ORBIT_INTLK_STS_TRANS_SMALLER_Y },
+        { "POS_LOWER_LTC_X", ORBIT_INTLK_STS_TRANS_SMALLER_LTC_X },
+        { "POS_LOWER_LTC_Y", ORBIT_INTLK_STS_TRANS_SMALLER_LTC_Y },
+        { "ANG_LOWER_X", ORBIT_INTLK_STS_ANG_SMALLER_X },
+        { "ANG_LOWER_Y", ORBIT_INTLK_STS_ANG_SMALLER_Y },
+        { "ANG_LOWER_LTC_X", ORBIT_INTLK_STS_ANG_SMALLER_LTC_X },
+        { "ANG_LOWER_LTC_Y", ORBIT_INTLK_STS_ANG_SMALLER_LTC_Y },
+    };
+
+    constexpr uint32_t TRIP_MASK
+        = ORBIT_INTLK_STS_INTLK | ORBIT_INTLK_STS_INTLK_LTC;
 }
 
 struct orbit_intlk_regs {
@@ -182,4 +213,234 @@ void Controller::write_params()
     clear = pos_clear = ang_clear = false;
 }
 
+struct config_layout Controller::get_config_layout() const
+{
+    /* the thresholds follow the status register, and are followed by the
+     * read only differences */
+    return {
+        {
+            { ORBIT_INTLK_REG_CTRL, sizeof regs.ctrl },
+            { ORBIT_INTLK_REG_MIN_SUM,
+                ORBIT_INTLK_REG_TRANS_X_DIFF - ORBIT_INTLK_REG_MIN_SUM },
+        },
+        {
+            { ORBIT_INTLK_REG_CTRL,
+                ORBIT_INTLK_CTRL_CLR | ORBIT_INTLK_CTRL_TRANS_CLR
+                    | ORBIT_INTLK_CTRL_ANG_CLR },
+        },
+    };
+}
+
+std::vector<std::string_view> status_flags(uint32_t sts)
+{
+    std::vector<std::string_view> r;
+    for (const auto &[name, mask] : sts_flags)
+        if (sts & mask)
+            r.push_back(name);
+    return r;
+}
+
+Watcher::Watcher(
+    Core &dec, std::chrono::nanoseconds poll_period, size_t history_size)
+    : dec(dec)
+    , poll_period(poll_period)
+    , history_size(history_size)
+{
+    dec.check_devinfo_is_set();
+    if (poll_period <= std::chrono::nanoseconds::zero())
+        throw std::logic_error("poll period must be positive");
+    if (history_size == 0)
+        throw std::logic_error("history must hold at least one event");
+}
+
+Watcher::~Watcher()
+{
+    stop();
+    for (int fd : eventfds)
+        close(fd);
+}
+
+void Watcher::add_snapshot(std::string name, RegisterDecoder &dec)
+{
+    if (watch_thread.joinable())
+        throw std::logic_error("can't add snapshots while the watcher is "
+                               "running");
+    dec.check_devinfo_is_set();
+    snapshot_cores.emplace_back(std::move(name), &dec);
+}
+
+void Watcher::start()
+{
+    if (watch_thread.joinable())
+        throw std::logic_error("watcher is already running");
+
+    stats = { };
+    error = nullptr;
+    running = true;
+
+    watch_thread = std::thread(&Watcher::watch_loop, this);
+}
+
+void Watcher::stop()
+{
+    {
+        std::lock_guard lock(m);
+        running = false;
+    }
+    cv.notify_all();
+
+    if (watch_thread.joinable())
+        watch_thread.join();
+}
+
+int Watcher::subscribe()
+{
+    int fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (fd < 0)
+        throw std::runtime_error("couldn't create eventfd");
+
+    std::lock_guard lock(m);
+    eventfds.push_back(fd);
+    return fd;
+}
+
+void Watcher::unsubscribe(int fd)
+{
+    std::lock_guard lock(m);
+    auto it = std::find(eventfds.begin(), eventfds.end(), fd);
+    if (it == eventfds.end())
+        throw std::logic_error("fd isn't subscribed");
+    eventfds.erase(it);
+    close(fd);
+}
+
+std::vector<intlk_event> Watcher::events_after(uint64_t sequence) const
+{
+    auto it = std::find_if(history.begin(), history.end(),
+        [sequence](const auto &e) { return e.sequence > sequence; });
+    return { it, history.end() };
+}
+
+std::vector<intlk_event> Watcher::get_events(uint64_t sequence)
+{
+    std::lock_guard lock(m);
+    return events_after(sequence);
+}
+
+std::vector<intlk_event> Watcher::wait_events(
+    uint64_t sequence, std::chrono::milliseconds wait_time)
+{
+    std::unique_lock lock(m);
+    cv.wait_for(lock, wait_time, [this, sequence] {
+        return error
+            || (!history.empty() && history.back().sequence > sequence);
+    });
+    if (error)
+        std::rethrow_exception(error);
+    return events_after(sequence);
+}
+
+watcher_stats Watcher::get_stats()
+{
+    std::lock_guard lock(m);
+    if (error)
+        std::rethrow_exception(error);
+    return stats;
+}
+
+void Watcher::notify(intlk_event &&e)
+{
+    {
+        std::lock_guard lock(m);
+        e.sequence = ++stats.events;
+        history.push_back(std::move(e));
+        if (history.size() > history_size)
+            history.pop_front();
+
+        const uint64_t one = 1;
+        for (int fd : eventfds)
+            /* can only fail if the counter is about to overflow, in which
+             * case the subscriber will still be woken up */
+            (void)!write(fd, &one, sizeof one);
+    }
+    cv.notify_all();
+}
+
+void Watcher::watch_loop()
+{
+    using namespace std::chrono;
+
+    try {
+        uint32_t previous = 0;
+        auto last_poll = steady_clock::now();
+        for (auto next = last_poll;;) {
+            {
+                std::unique_lock lock(m);
+                cv.wait_until(lock, next, [this] { return !running; });
+                if (!running)
+                    return;
+            }
+
+            const uint32_t sts
+                = bar4_read(&dec.bars, dec.addr + ORBIT_INTLK_REG_STS);
+            const auto now = steady_clock::now();
+            const auto wall = system_clock::now();
+            const nanoseconds interval = now - last_poll;
+            last_poll = now;
+            {
+                std::lock_guard lock(m);
+                stats.polls++;
+                if (stats.polls > 1)
+                    stats.max_interval = std::max(stats.max_interval, interval);
+            }
+
+            if (sts != previous) {
+                intlk_event e { };
+                e.timestamp = wall;
+                e.window = interval;
+                e.previous = previous;
+                e.current = sts;
+
+                uint32_t diff[4];
+                bar4_read_v(&dec.bars, dec.addr + ORBIT_INTLK_REG_TRANS_X_DIFF,
+                    diff, sizeof diff);
+                e.pos_x = diff[0];
+                e.pos_y = diff[1];
+                e.ang_x = diff[2];
+                e.ang_y = diff[3];
+
+                e.trip = e.set_bits() & TRIP_MASK;
+                if (e.trip)
+                    for (auto &[name, core] : snapshot_cores) {
+                        core->get_data();
+
+                        char *text;
+                        size_t size;
+                        FILE *f = open_memstream(&text, &size);
+                        if (!f)
+                            throw std::runtime_error(
+                                "couldn't open memory stream");
+                        core->print(f, false);
+                        fclose(f);
+                        e.snapshots.push_back({ name, { text, size } });
+                        free(text);
+                    }
+
+                notify(std::move(e));
+                previous = sts;
+            }
+
+            /* polls which were missed aren't made up for */
+            next = std::max(next + poll_period, steady_clock::now());
+        }
+    } catch (...) {
+        {
+            std::lock_guard lock(m);
+            error = std::current_exception();
+            running = false;
+        }
+        cv.notify_all();
+    }
+}
+
 } /* namespace orbit_intlk */
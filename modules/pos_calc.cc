@@ -1,5 +1,6 @@
 #include <array>
 #include <cmath>
+#include <cstring>
 #include <stdexcept>
 
 #include "modules/pos_calc.h"
@@ -287,6 +288,71 @@ void Core::get_fifo_amps()
     decode_fifo_amps();
 }
 
+size_t Core::drain_fifo(SpscRing<fifo_entry> &ring)
+{
+    constexpr size_t max_entries
+        = POS_CALC_AMPFIFO_MONIT_AMPFIFO_MONIT_CSR_COUNT_MASK + 1;
+    constexpr size_t entry_size = POS_CALC_AMPFIFO_MONIT_AMPFIFO_MONIT_CSR
+        - POS_CALC_AMPFIFO_MONIT_AMPFIFO_MONIT_R0;
+    static_assert(entry_size == sizeof(fifo_entry::amps));
+
+    const uint32_t csr
+        = bar4_read(&bars, addr + POS_CALC_AMPFIFO_MONIT_AMPFIFO_MONIT_CSR);
+    size_t count = extract_value<uint32_t>(
+        csr, POS_CALC_AMPFIFO_MONIT_AMPFIFO_MONIT_CSR_COUNT_MASK);
+    /* the count field wraps around when the FIFO is full */
+    const bool full
+        = get_bit(csr, POS_CALC_AMPFIFO_MONIT_AMPFIFO_MONIT_CSR_FULL);
+    if (full)
+        count = max_entries;
+    if (count == 0)
+        return 0;
+
+    uint32_t raw[max_entries][4];
+    bar4_read_repeat(&bars, addr + POS_CALC_AMPFIFO_MONIT_AMPFIFO_MONIT_R0,
+        raw, entry_size, count);
+
+    const auto now = std::chrono::steady_clock::now();
+    std::array<fifo_entry, max_entries> entries;
+    for (size_t i = 0; i < count; i++) {
+        entries[i].timestamp = now;
+        memcpy(entries[i].amps.data(), raw[i], entry_size);
+    }
+
+    stats.bursts++;
+    stats.entries += count;
+    stats.full += full;
+    stats.ring_overflows += count - ring.push(entries.data(), count);
+
+    return count;
+}
+
+fifo_stats Core::get_fifo_stats()
+{
+    return stats;
+}
+
+position_params Core::get_position_params(bool direct) const
+{
+    position_params p;
+    p.kx = get_general_data<int32_t>("KX");
+    p.ky = get_general_data<int32_t>("KY");
+    p.ksum = get_general_data<double>("KSUM");
+    p.offset_x = get_general_data<int32_t>("OFFSET_X");
+    p.offset_y = get_general_data<int32_t>("OFFSET_Y");
+
+    const char *gain = direct ? "ADC_SWCLK_DIR_GAIN" : "ADC_SWCLK_INV_GAIN";
+    const char *offset
+        = direct ? "ADC_SWCLK_DIR_OFFSET" : "ADC_SWCLK_INV_OFFSET";
+    for (unsigned i = 0; i < NUM_CHANNELS; i++) {
+        p.gains[i] = get_channel_data<double>(gain, i);
+        if (devinfo.abi_ver_minor >= ADC_OFFSET_VERSION)
+            p.offsets[i] = get_channel_data<int32_t>(offset, i);
+    }
+
+    return p;
+}
+
 Controller::Controller(struct pcie_bars &bars)
     : RegisterDecoderController(bars, ref_devinfo, &dec)
     , CONSTRUCTOR_REGS(struct pos_calc)
@@ -314,4 +380,36 @@ void Controller::write_params()
         write_channel("DESYNC_CNT_RST", i, 0);
 }
 
+struct config_layout Controller::get_config_layout() const
+{
+    /* everything but the DSP counters and monitors, the FIFOs and the gains'
+     * fixed point position, which are read only. The desynchronization
+     * counters share registers with the tags' configuration */
+    return {
+        {
+            { POS_CALC_DS_TBT_THRES,
+                POS_CALC_KSUM + 4 - POS_CALC_DS_TBT_THRES },
+            { POS_CALC_DDS_CFG, POS_CALC_DDS_POFF_CH3 + 4 - POS_CALC_DDS_CFG },
+            { POS_CALC_SW_TAG,
+                POS_CALC_ADC_GAINS_FIXED_POINT_POS - POS_CALC_SW_TAG },
+            { POS_CALC_ADC_CH0_SWCLK_0_GAIN,
+                POS_CALC_SIZE - POS_CALC_ADC_CH0_SWCLK_0_GAIN },
+        },
+        {
+            { POS_CALC_SW_TAG,
+                POS_CALC_SW_TAG_DESYNC_CNT_RST
+                    | POS_CALC_SW_TAG_DESYNC_CNT_MASK },
+            { POS_CALC_TBT_TAG,
+                POS_CALC_TBT_TAG_DESYNC_CNT_RST
+                    | POS_CALC_TBT_TAG_DESYNC_CNT_MASK },
+            { POS_CALC_MONIT1_TAG,
+                POS_CALC_MONIT1_TAG_DESYNC_CNT_RST
+                    | POS_CALC_MONIT1_TAG_DESYNC_CNT_MASK },
+            { POS_CALC_MONIT_TAG,
+                POS_CALC_MONIT_TAG_DESYNC_CNT_RST
+                    | POS_CALC_MONIT_TAG_DESYNC_CNT_MASK },
+        },
+    };
+}
+
 } /* namespace pos_calc */
@@ -1,10 +1,10 @@
 #include <chrono>
-#include <thread>
 
 #include "modules/si57x_ctrl.h"
 #include "printer.h"
 #include "si57x_util.h"
 #include "util.h"
+#include "wait_bits.h"
 
 namespace si57x_ctrl {
 
@@ -17,8 +17,9 @@ namespace {
         .abi_ver_major = 1 };
 
     using namespace std::chrono_literals;
-    constexpr auto busy_loop_time = 10ms;
-    constexpr unsigned busy_wait_attempts = 2s / busy_loop_time;
+    constexpr auto busy_timeout = 2s;
+    /* I2C transactions usually take well under 10ms */
+    const backoff_policy busy_backoff = { .initial = 20us, .max = 5ms };
 }
 
 Core::Core(struct pcie_bars &bars)
@@ -110,13 +111,11 @@ bool Controller::get_busy()
 
 bool Controller::still_busy()
 {
-    bool busy = get_busy();
-    for (unsigned i = 0; busy && i < busy_wait_attempts; i++) {
-        std::this_thread::sleep_for(busy_loop_time);
-
-        busy = get_busy();
-    }
+    const bool busy = !wait_for_bits(bars, addr + WB_SI57X_CTRL_REGS_STA,
+        WB_SI57X_CTRL_REGS_STA_BUSY, 0,
+        std::chrono::steady_clock::now() + busy_timeout, busy_backoff);
 
+    dec.get_data();
     return busy;
 }
 
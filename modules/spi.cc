@@ -1,9 +1,12 @@
-#include <arpa/inet.h>
-#include <cstring>
+#include <algorithm>
+#include <chrono>
+#include <map>
 
 #include "modules/spi.h"
+#include "pcie.h"
 #include "printer.h"
 #include "util.h"
+#include "wait_bits.h"
 
 namespace spi {
 
@@ -25,6 +28,9 @@ struct spi {
 };
 
 static_assert(SPI_PROTO_REG_RX3_SINGLE == offsetof(struct spi, rx3_single));
+static_assert(SPI_PROTO_REG_CTRL == offsetof(struct spi, ctrl));
+static_assert(SPI_PROTO_REG_SS == offsetof(struct spi, ss));
+static_assert(SPI_PROTO_REG_RX0_SINGLE == offsetof(struct spi, rx0_single));
 
 namespace {
     constexpr uint64_t CERN_VENDORID = 0x000000000000ce42;
@@ -32,6 +38,33 @@ namespace {
     struct sdb_device_info ref_devinfo = {
         .vendor_id = CERN_VENDORID, .device_id = SPI_DEVID, .abi_ver_major = 1
     };
+
+    using namespace std::chrono_literals;
+    /* the longest frame takes 1.3ms at the default 100kHz clock */
+    constexpr auto busy_timeout = 100ms;
+    /* short frames finish while spinning, and longer ones are polled with
+     * delays that stay short next to the frame's duration */
+    const backoff_policy busy_backoff
+        = { .spins = 64, .initial = 1us, .max = 50us };
+
+    /* instruction bytes before the data in CommandQueue frames */
+    constexpr size_t INSTRUCTION_SIZE = 2;
+    /* unwritten registers read along with the ones being verified, which is
+     * harmless since reads have no side effects */
+    constexpr int MAX_VERIFY_GAP = 2;
+    constexpr unsigned wait_attempts = 1000;
+
+    unsigned char instruction(bool read, size_t n)
+    {
+        return (read ? 0x80 : 0) | (std::min<size_t>(n, 4) - 1) << 5;
+    }
+
+    void check_block(uint8_t addr, size_t n)
+    {
+        if (addr + n > 0x100)
+            throw std::out_of_range("register block goes past the last "
+                                    "address");
+    }
 }
 
 Core::Core(struct pcie_bars &bars)
@@ -121,48 +154,202 @@ void Controller::set_defaults()
 bool Controller::write_read_data(const unsigned char *wdata, size_t wsize,
     unsigned char *rdata, size_t rsize, Channel slave)
 {
-    if (wsize + rsize > 16)
+    check_devinfo_is_set();
+
+    const size_t size = wsize + rsize;
+    if (size > MAX_FRAME_SIZE)
         throw std::logic_error("unsupported wsize + rsize");
-    if (wsize + rsize > 4)
-        throw std::logic_error(
-            "TODO: deal with commands spanning more than one register");
-    if (rsize > 1)
-        throw std::logic_error("TODO: deal with reading more than one byte");
-
-    int32_t charlen = (wsize + rsize) * 8;
-    if (charlen == 128)
-        charlen = 0;
-    write_general("CHARLEN", charlen);
-
-    write_general("SS", 1 << slave.channel);
-
-    /* TODO: deal with commands spanning more than one register */
-    regs.x0 = 0;
-    memcpy(&regs.x0, wdata, wsize);
-    /* the bytes were in network order (MSB first), and were copied into x0, so
-     * we need to revert that */
-    regs.x0 = ntohl(regs.x0);
-    /* now the bytes are at the register's MSB, so we need to shift them to LSB
-     */
-    regs.x0 >>= (4 - wsize) * 8;
-    /* finally, we need to make room for the response bytes */
-    regs.x0 <<= rsize * 8;
 
-    write_params();
+    /* the frame is a 128-bit value spread over x3:x0, with x0 holding the
+     * least significant word. The core shifts out bits starting from bit
+     * CHARLEN - 1, so the first byte (in network order, MSB first) goes in the
+     * highest used byte, and room is left for the response bytes at the
+     * bottom */
+    uint32_t x[4] = { };
+    for (size_t i = 0; i < wsize; i++) {
+        const size_t bit = (size - 1 - i) * 8;
+        x[bit / 32] |= (uint32_t)wdata[i] << (bit % 32);
+    }
+    regs.x0 = x[0];
+    regs.x1 = x[1];
+    regs.x2 = x[2];
+    regs.x3 = x[3];
 
-    write_general("BSY", 1);
-    write_params();
-    write_general("BSY", 0);
+    /* regs mirrors what was last written to the device, so only the registers
+     * used by this frame, and the ones which changed, are written */
+    bar4_write_v(&bars, addr, x, (size + 3) / 4 * sizeof *x);
+
+    const uint32_t ss = 1U << slave.channel;
+    if (regs.ss != ss) {
+        regs.ss = ss;
+        bar4_write(&bars, addr + SPI_PROTO_REG_SS, ss);
+    }
+
+    const uint32_t charlen = size == MAX_FRAME_SIZE ? 0 : size * 8;
+    const uint32_t ctrl = (regs.ctrl & ~SPI_PROTO_CTRL_CHARLEN_MASK
+                              & ~SPI_PROTO_CTRL_GO_BSY)
+        | SPI_PROTO_CTRL_CHARLEN_W(charlen);
+    if (regs.ctrl != ctrl) {
+        regs.ctrl = ctrl;
+        bar4_write(&bars, addr + SPI_PROTO_REG_CTRL, ctrl);
+    }
+    bar4_write(&bars, addr + SPI_PROTO_REG_CTRL, ctrl | SPI_PROTO_CTRL_GO_BSY);
+
+    /* only the control register is polled */
+    if (!wait_for_bits(bars, addr + SPI_PROTO_REG_CTRL, SPI_PROTO_CTRL_BSY, 0,
+            std::chrono::steady_clock::now() + busy_timeout, busy_backoff))
+        return false;
+
+    /* received bits are shifted in at bit 0, so the last byte of the response
+     * ends up in the least significant byte */
+    if (rsize) {
+        uint32_t rx[4];
+        bar4_read_v(&bars, addr + SPI_PROTO_REG_RX0_SINGLE, rx,
+            (rsize + 3) / 4 * sizeof *rx);
+        for (size_t i = 0; i < rsize; i++) {
+            const size_t bit = (rsize - 1 - i) * 8;
+            rdata[i] = rx[bit / 32] >> (bit % 32);
+        }
+    }
+
+    return true;
+}
+
+CommandQueue::CommandQueue(Controller &ctl, Channel channel, size_t max_block)
+    : ctl(ctl)
+    , channel(channel)
+    , max_block(max_block)
+{
+    if (max_block < 1
+        || max_block > Controller::MAX_FRAME_SIZE - INSTRUCTION_SIZE)
+        throw std::logic_error("unsupported block size");
+}
+
+bool CommandQueue::read_block(uint8_t addr, std::span<uint8_t> values)
+{
+    check_block(addr, values.size());
+
+    for (size_t done = 0; done < values.size();) {
+        const size_t n = std::min(values.size() - done, max_block);
+        /* the address is decremented after each byte, so the transfer starts
+         * from the block's last register */
+        const unsigned char wdata[] = {
+            instruction(true, n),
+            (unsigned char)(addr + done + n - 1),
+        };
 
-    do {
-        dec.get_data();
-    } while (dec.get_general_data<int32_t>("BSY"));
+        unsigned char rdata[Controller::MAX_FRAME_SIZE];
+        if (!ctl.write_read_data(wdata, sizeof wdata, rdata, n, channel))
+            return false;
+        std::reverse_copy(rdata, rdata + n, &values[done]);
 
-    /* TODO: deal with reading more than one byte */
-    if (rsize)
-        *rdata = (uint32_t)dec.get_channel_data<int32_t>("RX_SINGLE", 0);
+        done += n;
+    }
 
     return true;
 }
 
+bool CommandQueue::write_block(uint8_t addr, std::span<const uint8_t> values)
+{
+    check_block(addr, values.size());
+
+    for (size_t done = 0; done < values.size();) {
+        const size_t n = std::min(values.size() - done, max_block);
+        unsigned char wdata[Controller::MAX_FRAME_SIZE];
+        wdata[0] = instruction(false, n);
+        wdata[1] = addr + done + n - 1;
+        std::reverse_copy(
+            &values[done], &values[done] + n, wdata + INSTRUCTION_SIZE);
+
+        if (!ctl.write_read_data(
+                wdata, INSTRUCTION_SIZE + n, nullptr, 0, channel))
+            return false;
+
+        done += n;
+    }
+
+    return true;
+}
+
+CommandResult CommandQueue::run(std::span<const Command> commands)
+{
+    CommandResult r;
+    /* last value to verify for each register, and the write it came from */
+    std::map<uint8_t, std::pair<size_t, uint8_t>> verify;
+
+    for (size_t i = 0; i < commands.size();) {
+        const Command &c = commands[i];
+        size_t next = i + 1;
+        bool ok = false;
+        uint8_t value;
+
+        switch (c.op) {
+        case Command::Op::write: {
+            uint8_t values[Controller::MAX_FRAME_SIZE];
+            size_t n = 0;
+            values[n++] = c.value;
+            while (next < commands.size() && n < max_block
+                && commands[next].op == Command::Op::write
+                && commands[next].reg == c.reg + (int)n)
+                values[n++] = commands[next++].value;
+
+            ok = write_block(c.reg, std::span(values, n));
+
+            for (size_t j = i; j < next; j++) {
+                if (commands[j].verify)
+                    verify[commands[j].reg] = { j, commands[j].value };
+                else
+                    verify.erase(commands[j].reg);
+            }
+            break;
+        }
+        case Command::Op::read:
+            ok = read_block(c.reg, std::span(&value, 1));
+            if (ok)
+                r.reads.push_back(value);
+            break;
+        case Command::Op::wait:
+            for (unsigned a = 0; a < wait_attempts; a++) {
+                if (!read_block(c.reg, std::span(&value, 1)))
+                    break;
+                if (value == c.value) {
+                    ok = true;
+                    break;
+                }
+            }
+            break;
+        }
+
+        if (!ok) {
+            r.failed = i;
+            return r;
+        }
+        i = next;
+    }
+
+    for (auto it = verify.begin(); it != verify.end();) {
+        /* registers separated by small gaps are read together */
+        auto last = it, end = std::next(it);
+        while (end != verify.end()
+            && end->first - last->first <= MAX_VERIFY_GAP + 1)
+            last = end++;
+
+        const uint8_t first = it->first;
+        uint8_t values[0x100];
+        if (!read_block(first, std::span(values, last->first - first + 1))) {
+            r.failed = it->second.first;
+            return r;
+        }
+
+        for (; it != end; it++) {
+            const auto [index, expected] = it->second;
+            if (values[it->first - first] != expected)
+                r.mismatches.emplace_back(index, values[it->first - first]);
+        }
+    }
+    std::sort(r.mismatches.begin(), r.mismatches.end());
+
+    return r;
+}
+
 } /* namespace spi */
@@ -1,7 +1,11 @@
+#include <array>
 #include <cmath>
+#include <cstring>
+#include <span>
 #include <stdexcept>
 
 #include "modules/sysid.h"
+#include "pcie.h"
 #include "printer.h"
 #include "util.h"
 
@@ -12,12 +16,17 @@ namespace sys_id {
 static_assert(WB_FOFB_SYS_ID_REGS_PRBS_BPM_POS_DISTORT
     == offsetof(wb_fofb_sys_id_regs, prbs.bpm_pos_distort.distort_ram));
 
+static_assert(WB_FOFB_SYS_ID_REGS_PRBS_SP_DISTORT_CH
+    == offsetof(wb_fofb_sys_id_regs, prbs.sp_distort.ch));
+
 static_assert(WB_FOFB_SYS_ID_REGS_PRBS_SP_DISTORT_CH_LEVELS_LEVEL_0_MASK
     == WB_FOFB_SYS_ID_REGS_PRBS_BPM_POS_DISTORT_DISTORT_RAM_LEVELS_LEVEL_0_MASK);
 static_assert(WB_FOFB_SYS_ID_REGS_PRBS_SP_DISTORT_CH_LEVELS_LEVEL_1_MASK
     == WB_FOFB_SYS_ID_REGS_PRBS_BPM_POS_DISTORT_DISTORT_RAM_LEVELS_LEVEL_1_MASK);
 #define LEVEL_0_MASK WB_FOFB_SYS_ID_REGS_PRBS_SP_DISTORT_CH_LEVELS_LEVEL_0_MASK
 #define LEVEL_1_MASK WB_FOFB_SYS_ID_REGS_PRBS_SP_DISTORT_CH_LEVELS_LEVEL_1_MASK
+/* layout produced by pack_pairs() */
+static_assert(LEVEL_0_MASK == 0xffff && LEVEL_1_MASK == 0xffff0000);
 
 namespace {
     const size_t NUM_SETPOINTS = 12, NUM_POSITIONS = 256;
@@ -26,6 +35,50 @@ namespace {
     struct sdb_device_info ref_devinfo = { .vendor_id = LNLS_VENDORID,
         .device_id = SYS_ID_DEVID,
         .abi_ver_major = 1 };
+
+    /* unchanged words between changed ones which are still written as part of
+     * a single burst, since each burst has a fixed cost */
+    const size_t MAX_BURST_GAP = 4;
+
+    void pack_levels(const distortion_levels &levels, std::span<uint32_t> out)
+    {
+        if (levels.prbs_0.size() != out.size()
+            || levels.prbs_1.size() != out.size())
+            throw std::logic_error("distortion levels must have "
+                + std::to_string(out.size()) + " values");
+
+        pack_pairs(levels.prbs_0, levels.prbs_1, out);
+    }
+
+    /* write the words from packed which differ from shadow, updating it */
+    template <typename Word, size_t N>
+    void write_changed(struct pcie_bars &bars, size_t base, Word (&shadow)[N],
+        const std::array<uint32_t, N> &packed)
+    {
+        static_assert(sizeof(Word) == sizeof(uint32_t));
+
+        for (size_t i = 0; i < N;) {
+            if (shadow[i].levels == packed[i]) {
+                i++;
+                continue;
+            }
+
+            /* extend the burst over changed words and small gaps */
+            size_t end = i, gap = 0;
+            for (size_t j = i; j < N && gap <= MAX_BURST_GAP; j++) {
+                if (shadow[j].levels != packed[j]) {
+                    shadow[j].levels = packed[j];
+                    end = j + 1;
+                    gap = 0;
+                } else {
+                    gap++;
+                }
+            }
+            bar4_write_v(&bars, base + i * sizeof(Word), &shadow[i],
+                (end - i) * sizeof(Word));
+            i = end;
+        }
+    }
 }
 
 distortion_levels::distortion_levels(size_t size)
@@ -151,6 +204,23 @@ Controller::~Controller() = default;
 
 void Controller::set_devinfo_callback() { read(); }
 
+struct config_layout Controller::get_config_layout() const
+{
+    /* the PRBS reset is an enable, not a command */
+    return {
+        {
+            { WB_FOFB_SYS_ID_REGS_BPM_POS_FLATENIZER_CTL,
+                sizeof regs.bpm_pos_flatenizer.ctl },
+            { WB_FOFB_SYS_ID_REGS_PRBS_CTL, sizeof regs.prbs.ctl },
+            { WB_FOFB_SYS_ID_REGS_PRBS_SP_DISTORT_CH,
+                sizeof regs.prbs.sp_distort.ch },
+            { WB_FOFB_SYS_ID_REGS_PRBS_BPM_POS_DISTORT_DISTORT_RAM,
+                sizeof regs.prbs.bpm_pos_distort.distort_ram },
+        },
+        { },
+    };
+}
+
 void Controller::encode_params()
 {
     if (step_duration < 1 || step_duration > 0x3FF + 1)
@@ -176,22 +246,40 @@ void Controller::encode_params()
     clear_and_insert(regs.prbs.ctl, sp_mov_avg_samples,
         WB_FOFB_SYS_ID_REGS_PRBS_CTL_SP_DISTORT_MOV_AVG_NUM_TAPS_SEL_MASK);
 
-    auto set_distortion = [](auto &levels, auto index, const auto &distort) {
-        /* the uint16_t casts are necessary to avoid sign extension issues */
-        clear_and_insert(levels, (uint16_t)distort.prbs_0[index], LEVEL_0_MASK);
-        clear_and_insert(levels, (uint16_t)distort.prbs_1[index], LEVEL_1_MASK);
-    };
-    for (size_t i = 0; i < NUM_SETPOINTS; i++) {
-        set_distortion(
-            regs.prbs.sp_distort.ch[i].levels, i, setpoint_distortion);
-    }
-    for (size_t i = 0; i < NUM_POSITIONS; i++) {
-        set_distortion(regs.prbs.bpm_pos_distort.distort_ram[i].levels, i,
-            posx_distortion);
-        set_distortion(
-            regs.prbs.bpm_pos_distort.distort_ram[i + NUM_POSITIONS].levels, i,
-            posy_distortion);
-    }
+    std::array<uint32_t, NUM_SETPOINTS> sp;
+    std::array<uint32_t, 2 * NUM_POSITIONS> pos;
+    pack_distortion(sp, pos);
+    memcpy(regs.prbs.sp_distort.ch, sp.data(), sizeof sp);
+    memcpy(regs.prbs.bpm_pos_distort.distort_ram, pos.data(), sizeof pos);
+}
+
+void Controller::pack_distortion(
+    std::span<uint32_t> sp, std::span<uint32_t> pos) const
+{
+    pack_levels(setpoint_distortion, sp);
+    pack_levels(posx_distortion, pos.first(NUM_POSITIONS));
+    pack_levels(posy_distortion, pos.last(NUM_POSITIONS));
+}
+
+void Controller::write_distortion()
+{
+    check_devinfo_is_set();
+
+    std::array<uint32_t, NUM_SETPOINTS> sp;
+    std::array<uint32_t, 2 * NUM_POSITIONS> pos;
+    pack_distortion(sp, pos);
+
+    /* regs holds what was last read from or written into the device */
+    write_changed(bars, addr + WB_FOFB_SYS_ID_REGS_PRBS_SP_DISTORT_CH,
+        regs.prbs.sp_distort.ch, sp);
+    write_changed(bars,
+        addr + WB_FOFB_SYS_ID_REGS_PRBS_BPM_POS_DISTORT_DISTORT_RAM,
+        regs.prbs.bpm_pos_distort.distort_ram, pos);
+}
+
+PrbsCorrelator Controller::make_correlator(size_t max_samples) const
+{
+    return { lfsr_length, step_duration, max_samples };
 }
 
 } /* namespace sys_id */
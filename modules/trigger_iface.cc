@@ -1,3 +1,6 @@
+#include <chrono>
+
+#include "pcie.h"
 #include "util.h"
 
 #include "modules/trigger_iface.h"
@@ -25,6 +28,14 @@ struct trigger_iface_regs {
     } ch[internal::number_of_channels];
 };
 
+namespace {
+    constexpr size_t CHANNEL_WORDS = sizeof trigger_iface_regs::ch[0] / 4;
+    /* the counts are read in a single burst, from the first channel's count
+     * to the last one's */
+    constexpr size_t COUNT_BURST_WORDS
+        = (internal::number_of_channels - 1) * CHANNEL_WORDS + 1;
+}
+
 Core::Core(struct pcie_bars &bars)
     : RegisterDecoder(bars, ref_devinfo,
           {
@@ -119,4 +130,46 @@ void Controller::write_params()
     }
 }
 
+struct config_layout Controller::get_config_layout() const
+{
+    struct config_layout layout;
+    for (unsigned i = 0; i < internal::number_of_channels; i++) {
+        const size_t ch = i * sizeof regs.ch[0];
+        /* the count is read only */
+        layout.regions.push_back(
+            { ch + offsetof(trigger_iface_regs, ch[0].ctl),
+                sizeof regs.ch[0].ctl + sizeof regs.ch[0].cfg });
+        layout.volatile_bits.push_back(
+            { ch + offsetof(trigger_iface_regs, ch[0].ctl),
+                WB_TRIG_IFACE_CH0_CTL_RCV_COUNT_RST
+                    | WB_TRIG_IFACE_CH0_CTL_TRANSM_COUNT_RST });
+    }
+    return layout;
+}
+
+RateMonitor::RateMonitor(Core &dec, size_t history_size)
+    : CounterRates(2 * internal::number_of_channels, 16, history_size)
+    , dec(dec)
+    , burst(COUNT_BURST_WORDS)
+    , counts(2 * internal::number_of_channels)
+{
+    dec.check_devinfo_is_set();
+}
+
+void RateMonitor::poll()
+{
+    bar4_read_v(&dec.bars, dec.addr + offsetof(trigger_iface_regs, ch[0].count),
+        burst.data(), burst.size() * sizeof burst[0]);
+    const auto time = std::chrono::steady_clock::now();
+
+    for (unsigned i = 0; i < internal::number_of_channels; i++) {
+        const uint32_t t = burst[i * CHANNEL_WORDS];
+        counts[2 * i]
+            = extract_value<uint16_t>(t, WB_TRIG_IFACE_CH0_COUNT_RCV_MASK);
+        counts[2 * i + 1]
+            = extract_value<uint16_t>(t, WB_TRIG_IFACE_CH0_COUNT_TRANSM_MASK);
+    }
+    update(time, counts);
+}
+
 } /* namespace trigger_iface */
@@ -93,4 +93,13 @@ void Controller::encode_params()
     }
 }
 
+struct config_layout Controller::get_config_layout() const
+{
+    struct config_layout layout;
+    for (unsigned i = 0; i < internal::number_of_channels; i++)
+        layout.regions.push_back(
+            { i * sizeof regs.ch[0], sizeof regs.ch[0].ctl });
+    return layout;
+}
+
 } /* namespace trigger_mux */
@@ -0,0 +1,266 @@
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+#include <stdexcept>
+
+#include "biquad.h"
+#include "simd.h"
+#include "util.h"
+
+namespace {
+
+/* values for each biquad in the coefficient and state arrays */
+const size_t STATE_PER_BIQUAD = 4;
+#ifdef USE_SSE2
+const size_t SIMD_WIDTH = 2;
+#else
+const size_t SIMD_WIDTH = 1;
+#endif
+
+/* limits of the signal format, in units of its least significant bit */
+struct signal_limits {
+    double min, max;
+};
+
+/* run one sample of one lane through the cascade; coeffs and state point to
+ * the lane's first element */
+template <bool quantize>
+double step_scalar(const double *coeffs, double *state, size_t lanes,
+    size_t num_biquads, const signal_limits &lim, double x, uint64_t &sat)
+{
+    for (size_t b = 0; b < num_biquads; b++) {
+        const double *c = coeffs + b * BiquadCascade::coeffs_per_biquad * lanes;
+        double *s = state + b * STATE_PER_BIQUAD * lanes;
+
+        double acc = c[0] * x + c[lanes] * s[0] + c[2 * lanes] * s[lanes]
+            - c[3 * lanes] * s[2 * lanes] - c[4 * lanes] * s[3 * lanes];
+        if constexpr (quantize) {
+            if (acc > lim.max || acc < lim.min)
+                sat++;
+            acc = std::nearbyint(std::clamp(acc, lim.min, lim.max));
+        }
+
+        s[lanes] = s[0];
+        s[0] = x;
+        s[3 * lanes] = s[2 * lanes];
+        s[2 * lanes] = acc;
+        x = acc;
+    }
+    return x;
+}
+
+#ifdef USE_SSE2
+/* same as step_scalar(), for two lanes */
+template <bool quantize>
+__m128d step_sse(const double *coeffs, double *state, size_t lanes,
+    size_t num_biquads, const signal_limits &lim, __m128d x, uint64_t *sat)
+{
+    const __m128d vmin = _mm_set1_pd(lim.min), vmax = _mm_set1_pd(lim.max);
+    /* adding and subtracting 1.5 * 2^52 rounds to the nearest integer, with
+     * ties to even, for values below 2^51 */
+    const __m128d round = _mm_set1_pd(6755399441055744.0);
+
+    for (size_t b = 0; b < num_biquads; b++) {
+        const double *c = coeffs + b * BiquadCascade::coeffs_per_biquad * lanes;
+        double *s = state + b * STATE_PER_BIQUAD * lanes;
+
+        const __m128d x1 = _mm_loadu_pd(s), x2 = _mm_loadu_pd(s + lanes),
+                      y1 = _mm_loadu_pd(s + 2 * lanes),
+                      y2 = _mm_loadu_pd(s + 3 * lanes);
+        __m128d acc = _mm_mul_pd(_mm_loadu_pd(c), x);
+        acc = _mm_add_pd(acc, _mm_mul_pd(_mm_loadu_pd(c + lanes), x1));
+        acc = _mm_add_pd(acc, _mm_mul_pd(_mm_loadu_pd(c + 2 * lanes), x2));
+        acc = _mm_sub_pd(acc, _mm_mul_pd(_mm_loadu_pd(c + 3 * lanes), y1));
+        acc = _mm_sub_pd(acc, _mm_mul_pd(_mm_loadu_pd(c + 4 * lanes), y2));
+        if constexpr (quantize) {
+            const int out_of_range = _mm_movemask_pd(
+                _mm_or_pd(_mm_cmpgt_pd(acc, vmax), _mm_cmplt_pd(acc, vmin)));
+            sat[0] += out_of_range & 1;
+            sat[1] += out_of_range >> 1;
+            acc = _mm_min_pd(_mm_max_pd(acc, vmin), vmax);
+            acc = _mm_sub_pd(_mm_add_pd(acc, round), round);
+        }
+
+        _mm_storeu_pd(s + lanes, x1);
+        _mm_storeu_pd(s, x);
+        _mm_storeu_pd(s + 3 * lanes, y1);
+        _mm_storeu_pd(s + 2 * lanes, acc);
+        x = acc;
+    }
+    return x;
+}
+#endif
+
+}
+
+BiquadCascade::BiquadCascade(
+    const std::vector<std::vector<double>> &coefficients,
+    fixed_point_format coeff_format, fixed_point_format signal_format)
+    : num_channels(coefficients.size())
+    , coeff_format(coeff_format)
+    , signal_format(signal_format)
+    , coeffs(coefficients)
+    , quantized(coefficients)
+    , reports(coefficients.size())
+{
+    if (num_channels == 0)
+        throw std::logic_error("there must be at least one channel");
+    if (coeffs[0].size() % coeffs_per_biquad)
+        throw std::logic_error("each biquad needs "
+            + std::to_string(coeffs_per_biquad) + " coefficients");
+    for (const auto &c : coeffs)
+        if (c.size() != coeffs[0].size())
+            throw std::logic_error(
+                "all channels must have the same number of biquads");
+    if (coeff_format.int_width < 1
+        || coeff_format.int_width + coeff_format.frac_width > 32)
+        throw std::logic_error("coefficients must have from 1 to 32 bits");
+    /* the rounding in step_sse() only works below 2^51 */
+    if (signal_format.int_width < 1
+        || signal_format.int_width + signal_format.frac_width > 50)
+        throw std::logic_error("signal values must have from 1 to 50 bits");
+
+    num_biquads = coeffs[0].size() / coeffs_per_biquad;
+    lanes = (num_channels + SIMD_WIDTH - 1) / SIMD_WIDTH * SIMD_WIDTH;
+
+    /* converted with the full register width, from which the device only
+     * uses the upper bits */
+    const unsigned point_pos = 32 - coeff_format.int_width,
+                   dropped = point_pos - coeff_format.frac_width;
+    for (auto &c : quantized)
+        for (auto &v : c)
+            v = std::ldexp(
+                (int32_t)float2fixed(v, point_pos) >> dropped,
+                -(int)coeff_format.frac_width);
+
+    q_coeffs.resize(num_biquads * coeffs_per_biquad * lanes);
+    ref_coeffs.resize(q_coeffs.size());
+    for (size_t ch = 0; ch < num_channels; ch++)
+        for (size_t k = 0; k < coeffs[ch].size(); k++) {
+            q_coeffs[k * lanes + ch] = quantized[ch][k];
+            ref_coeffs[k * lanes + ch] = coeffs[ch][k];
+        }
+
+    reset();
+}
+
+bool BiquadCascade::is_exact() const
+{
+    /* each product needs the sum of the widths, and adding the five products
+     * needs three more bits */
+    const unsigned coeff_width
+        = coeff_format.int_width + coeff_format.frac_width,
+        signal_width = signal_format.int_width + signal_format.frac_width;
+    return coeff_width + signal_width + 3 <= 53;
+}
+
+const std::vector<std::vector<double>> &BiquadCascade::get_quantized() const
+{
+    return quantized;
+}
+
+void BiquadCascade::reset()
+{
+    q_state.assign(num_biquads * STATE_PER_BIQUAD * lanes, 0);
+    ref_state.assign(q_state.size(), 0);
+    reports.assign(num_channels, { });
+    samples = 0;
+}
+
+void BiquadCascade::run(const std::vector<std::span<const double>> &in,
+    const std::vector<std::span<double>> &out)
+{
+    if (in.size() != num_channels || out.size() != num_channels)
+        throw std::logic_error("there must be one input and one output for "
+                               "each channel");
+    const size_t n = in[0].size();
+    for (size_t ch = 0; ch < num_channels; ch++)
+        if (in[ch].size() != n || out[ch].size() != n)
+            throw std::logic_error(
+                "all inputs and outputs must have the same size");
+
+    const double scale = std::ldexp(1., signal_format.frac_width);
+    const signal_limits lim = {
+        -std::ldexp(1., signal_format.int_width + signal_format.frac_width - 1),
+        std::ldexp(1., signal_format.int_width + signal_format.frac_width - 1)
+            - 1,
+    };
+
+    /* per lane values for the current sample, in units of the signal's least
+     * significant bit */
+    std::vector<double> x(lanes), q(lanes), ref(lanes);
+    std::vector<uint64_t> sat(lanes);
+    std::vector<double> sum_sq(lanes);
+
+    for (size_t i = 0; i < n; i++) {
+        for (size_t ch = 0; ch < num_channels; ch++) {
+            x[ch] = in[ch][i] * scale;
+            q[ch] = std::nearbyint(std::clamp(x[ch], lim.min, lim.max));
+            if (x[ch] > lim.max || x[ch] < lim.min)
+                sat[ch]++;
+        }
+
+        size_t lane = 0;
+#ifdef USE_SSE2
+        for (; lane + 2 <= num_channels; lane += 2) {
+            _mm_storeu_pd(&q[lane],
+                step_sse<true>(&q_coeffs[lane], &q_state[lane], lanes,
+                    num_biquads, lim, _mm_loadu_pd(&q[lane]), &sat[lane]));
+            _mm_storeu_pd(&ref[lane],
+                step_sse<false>(&ref_coeffs[lane], &ref_state[lane], lanes,
+                    num_biquads, lim, _mm_loadu_pd(&x[lane]), &sat[lane]));
+        }
+#endif
+        for (; lane < num_channels; lane++) {
+            q[lane] = step_scalar<true>(&q_coeffs[lane], &q_state[lane], lanes,
+                num_biquads, lim, q[lane], sat[lane]);
+            ref[lane] = step_scalar<false>(&ref_coeffs[lane], &ref_state[lane],
+                lanes, num_biquads, lim, x[lane], sat[lane]);
+        }
+
+        for (size_t ch = 0; ch < num_channels; ch++) {
+            out[ch][i] = q[ch] / scale;
+            const double error = std::abs(q[ch] - ref[ch]) / scale;
+            sum_sq[ch] += error * error;
+            reports[ch].max_error = std::max(reports[ch].max_error, error);
+        }
+    }
+
+    /* merge this run into the reports, which hold the RMS values */
+    for (size_t ch = 0; ch < num_channels; ch++) {
+        auto &r = reports[ch];
+        const double total_sq
+            = r.rms_error * r.rms_error * samples + sum_sq[ch];
+        r.rms_error = samples + n ? std::sqrt(total_sq / (samples + n)) : 0;
+        r.saturations += sat[ch];
+    }
+    samples += n;
+}
+
+std::vector<BiquadCascade::channel_report> BiquadCascade::get_reports() const
+{
+    return reports;
+}
+
+std::vector<std::complex<double>> BiquadCascade::frequency_response(
+    size_t channel, std::span<const double> freqs, bool quantized) const
+{
+    if (channel >= num_channels)
+        throw std::out_of_range("channel doesn't exist");
+    const auto &c = quantized ? this->quantized[channel] : coeffs[channel];
+
+    std::vector<std::complex<double>> r(freqs.size());
+    for (size_t i = 0; i < freqs.size(); i++) {
+        /* z^-1 and z^-2 */
+        const auto z1 = std::polar(1., -2 * std::numbers::pi * freqs[i]),
+                   z2 = z1 * z1;
+        std::complex<double> h = 1;
+        for (size_t b = 0; b < num_biquads; b++) {
+            const double *bc = &c[b * coeffs_per_biquad];
+            h *= (bc[0] + bc[1] * z1 + bc[2] * z2)
+                / (1. + bc[3] * z1 + bc[4] * z2);
+        }
+        r[i] = h;
+    }
+    return r;
+}
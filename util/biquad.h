@@ -0,0 +1,83 @@
+#ifndef BIQUAD_H
+#define BIQUAD_H
+
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/** Signed fixed point format, with the sign bit counted in \p int_width */
+struct fixed_point_format {
+    unsigned int_width, frac_width;
+};
+
+/** Simulates cascades of biquads as implemented with fixed point arithmetic,
+ * one cascade per channel, alongside the same cascades with the original
+ * coefficients and no quantization. Each biquad is in direct form I: its
+ * output is accumulated at full precision from the current and previous two
+ * inputs and previous two outputs, then rounded to the nearest signal value
+ * and saturated. Coefficients are quantized the way the device does it: they
+ * are converted by float2fixed() with 32 - int_width fractional bits, and only
+ * the upper int_width + frac_width bits are used. Channels are processed in
+ * parallel with SIMD instructions. */
+class BiquadCascade {
+public:
+    /** b0, b1, b2, a1 and a2, with a0 being 1 */
+    static constexpr size_t coeffs_per_biquad = 5;
+
+    struct channel_report {
+        /** Differences between the fixed point and the reference outputs */
+        double rms_error = 0, max_error = 0;
+        /** Biquad outputs and inputs which didn't fit in the signal format */
+        uint64_t saturations = 0;
+    };
+
+private:
+    size_t num_channels, num_biquads, lanes;
+    fixed_point_format coeff_format, signal_format;
+    /* original and quantized coefficients, per channel */
+    std::vector<std::vector<double>> coeffs, quantized;
+    /* coefficients and state, laid out as [biquad][coefficient][lane] and
+     * [biquad][x1, x2, y1, y2][lane], with lanes being the channels padded
+     * to the SIMD width */
+    std::vector<double> q_coeffs, ref_coeffs, q_state, ref_state;
+    std::vector<channel_report> reports;
+    /* amount of samples included in the reports */
+    size_t samples = 0;
+
+public:
+    /** \p coefficients holds the coefficients of each channel, which must
+     * all have the same number of biquads */
+    BiquadCascade(const std::vector<std::vector<double>> &coefficients,
+        fixed_point_format coeff_format, fixed_point_format signal_format);
+
+    /** Whether the accumulation is exact, which happens when coefficients
+     * and signal values are narrow enough to fit a double's mantissa */
+    bool is_exact() const;
+
+    /** Coefficients after quantization, per channel */
+    const std::vector<std::vector<double>> &get_quantized() const;
+
+    /** Run \p in through the cascades, continuing from the state left by the
+     * previous call, writing the fixed point outputs into \p out. There must
+     * be one input and one output per channel, all with the same size, and
+     * values are in the signal's units */
+    void run(const std::vector<std::span<const double>> &in,
+        const std::vector<std::span<double>> &out);
+    /** Clear the filter states and reports */
+    void reset();
+
+    /** Quantization errors and saturations for each channel since the last
+     * reset() */
+    std::vector<channel_report> get_reports() const;
+
+    /** Frequency response of a channel's cascade at each frequency in \p freqs,
+     * given as fractions of the sampling frequency, from the quantized or the
+     * original coefficients */
+    std::vector<std::complex<double>> frequency_response(
+        size_t channel, std::span<const double> freqs, bool quantized = true)
+        const;
+};
+
+#endif
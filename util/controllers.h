@@ -4,6 +4,27 @@
 #include "decoders.h"
 #include "sdb-defs.h"
 
+/** A range of a core's register map, in bytes from its start */
+struct register_region {
+    size_t offset, size;
+};
+
+/** Bits of a single register, at an offset in bytes from the core's start */
+struct register_bits {
+    size_t offset;
+    uint32_t mask;
+};
+
+/** Which parts of a core's register map hold its configuration. Volatile bits
+ * are the ones inside those regions which aren't configuration: strobes and
+ * other commands, which unset_commands() would clear, and status bits which
+ * share a register with configuration. They are cleared before being written
+ * and ignored when comparing configurations */
+struct config_layout {
+    std::vector<register_region> regions;
+    std::vector<register_bits> volatile_bits;
+};
+
 class RegisterController : public RegisterDecoderBase {
 protected:
     RegisterController(struct pcie_bars &bars, const struct sdb_device_info &);
@@ -26,6 +47,11 @@ public:
     /** Child classes can implement this function when their write procedures
      * require more than simply writing the regs structure */
     virtual void write_params();
+
+    /** Child classes can implement this function to describe their
+     * configuration registers, which don't depend on the device information.
+     * Cores with an empty layout aren't part of board snapshots */
+    virtual struct config_layout get_config_layout() const { return { }; }
 };
 
 /** Controller base class which can use the register fields as decoded by a
@@ -0,0 +1,134 @@
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "counter_rates.h"
+
+CounterRates::CounterRates(
+    size_t num_counters, unsigned counter_bits, size_t history_size)
+    : num_counters(num_counters)
+    , history_size(history_size)
+{
+    if (counter_bits < 1 || counter_bits > 32)
+        throw std::logic_error("counters must have from 1 to 32 bits");
+    if (history_size < 2)
+        throw std::logic_error("time series must hold at least 2 entries");
+    counter_mask = counter_bits == 32 ? UINT32_MAX : (1U << counter_bits) - 1;
+
+    expected.resize(num_counters);
+    times.resize(history_size);
+    deltas.resize(history_size * num_counters);
+    reset();
+}
+
+void CounterRates::set_expected_rate(
+    size_t counter, double rate, double tolerance)
+{
+    if (counter >= num_counters)
+        throw std::out_of_range("counter doesn't exist");
+    if (rate < 0 || tolerance < 0)
+        throw std::logic_error("rate and tolerance can't be negative");
+
+    expected[counter] = { rate, tolerance, -1 };
+}
+
+void CounterRates::reset()
+{
+    status.assign(num_counters, { });
+    last_counts.assign(num_counters, 0);
+    window_sums.assign(num_counters, 0);
+    has_counts = false;
+    next = stored = 0;
+    for (auto &e : expected)
+        e.deficit = -1;
+}
+
+void CounterRates::update(std::chrono::steady_clock::time_point time,
+    std::span<const uint32_t> counts)
+{
+    if (counts.size() != num_counters)
+        throw std::logic_error("there must be one count per counter");
+
+    if (!has_counts) {
+        std::copy(counts.begin(), counts.end(), last_counts.begin());
+        last_time = window_start = time;
+        has_counts = true;
+        return;
+    }
+
+    const double dt = std::chrono::duration<double>(time - last_time).count();
+    last_time = time;
+
+    /* the entry being overwritten leaves the window, which then starts at
+     * its time, since the next entry counts the pulses from there */
+    uint16_t *entry = &deltas[next * num_counters];
+    if (stored == history_size) {
+        for (size_t i = 0; i < num_counters; i++)
+            window_sums[i] -= entry[i];
+        window_start = times[next];
+    }
+    times[next] = time;
+
+    for (size_t i = 0; i < num_counters; i++) {
+        const uint32_t delta = (counts[i] - last_counts[i]) & counter_mask;
+        last_counts[i] = counts[i];
+
+        entry[i] = std::min<uint32_t>(delta, UINT16_MAX);
+        window_sums[i] += entry[i];
+
+        auto &s = status[i];
+        s.total += delta;
+
+        auto &e = expected[i];
+        if (e.rate == 0)
+            continue;
+        if (!s.synced) {
+            s.synced = delta > 0;
+            continue;
+        }
+        e.deficit = std::max(e.deficit + e.rate * dt - delta, -1.);
+        if (e.deficit > e.tolerance) {
+            const double missed = std::floor(e.deficit - e.tolerance) + 1;
+            s.missed += (uint64_t)missed;
+            e.deficit -= missed;
+        }
+    }
+
+    next = (next + 1) % history_size;
+    stored = std::min(stored + 1, history_size);
+
+    const double window
+        = std::chrono::duration<double>(time - window_start).count();
+    for (size_t i = 0; i < num_counters; i++)
+        status[i].rate = window > 0 ? window_sums[i] / window : 0;
+}
+
+const std::vector<CounterRates::counter_status> &
+CounterRates::get_status() const
+{
+    return status;
+}
+
+std::vector<std::chrono::steady_clock::time_point>
+CounterRates::get_times() const
+{
+    std::vector<std::chrono::steady_clock::time_point> r;
+    r.reserve(stored);
+    for (size_t k = 0; k < stored; k++)
+        r.push_back(times[(next + history_size - stored + k) % history_size]);
+    return r;
+}
+
+std::vector<uint16_t> CounterRates::get_deltas(size_t counter) const
+{
+    if (counter >= num_counters)
+        throw std::out_of_range("counter doesn't exist");
+
+    std::vector<uint16_t> r;
+    r.reserve(stored);
+    for (size_t k = 0; k < stored; k++) {
+        const size_t entry = (next + history_size - stored + k) % history_size;
+        r.push_back(deltas[entry * num_counters + counter]);
+    }
+    return r;
+}
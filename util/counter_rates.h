@@ -0,0 +1,93 @@
+#ifndef COUNTER_RATES_H
+#define COUNTER_RATES_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/** Turns successive reads of free running pulse counters into rates, keeps
+ * the pulses counted between reads as a time series, and detects missed
+ * pulses in counters with a known rate.
+ *
+ * A counter with an expected rate is synchronized by its first pulse, after
+ * which it keeps a deficit: the pulses it should have counted minus the ones
+ * it did. The deficit is kept at or above -1, since pulses arriving earlier
+ * than expected mean the counter's phase is later than assumed. A pulse is
+ * reported as missed when the deficit goes over the tolerance, given as a
+ * fraction of the pulse period, so it's never reported before the pulse is
+ * late by that much. The counter's phase is only learned as well as the
+ * reads sample it, so reads which are always at the same phase relative to
+ * the pulses, which jittery reads from software aren't, can hide a missed
+ * pulse. */
+class CounterRates {
+public:
+    struct counter_status {
+        /** Pulses per second over the time series */
+        double rate = 0;
+        /** Pulses counted since the first read */
+        uint64_t total = 0;
+        /** Missed pulses, only for counters with an expected rate */
+        uint64_t missed = 0;
+        /** Whether a pulse has been counted, which starts the missed pulse
+         * detection */
+        bool synced = false;
+    };
+
+private:
+    size_t num_counters, history_size;
+    uint32_t counter_mask;
+
+    struct expectation {
+        double rate = 0, tolerance = 0;
+        double deficit = 0;
+    };
+    std::vector<expectation> expected;
+    std::vector<counter_status> status;
+
+    std::vector<uint32_t> last_counts;
+    std::chrono::steady_clock::time_point last_time;
+    bool has_counts = false;
+    /* time of the read before the oldest entry in the time series */
+    std::chrono::steady_clock::time_point window_start;
+
+    /* time series, in a ring with the oldest entry at next - size, laid out
+     * as [entry][counter]; deltas which don't fit are saturated */
+    std::vector<std::chrono::steady_clock::time_point> times;
+    std::vector<uint16_t> deltas;
+    size_t next = 0, stored = 0;
+    /* pulses in the time series, per counter */
+    std::vector<uint64_t> window_sums;
+
+public:
+    /** \p counter_bits is the width of the hardware counters, which wrap
+     * around; \p history_size is the number of reads kept in the time
+     * series */
+    CounterRates(size_t num_counters, unsigned counter_bits,
+        size_t history_size = 1024);
+
+    size_t size() const { return num_counters; }
+
+    /** Enable missed pulse detection for a counter, with \p rate in pulses
+     * per second; a rate of 0 disables it */
+    void set_expected_rate(size_t counter, double rate, double tolerance = 0.5);
+
+    /** Add a read of all counters, made at \p time. The first read only sets
+     * the reference for the next ones */
+    void update(
+        std::chrono::steady_clock::time_point time,
+        std::span<const uint32_t> counts);
+    /** Forget all reads, keeping the expected rates */
+    void reset();
+
+    const std::vector<counter_status> &get_status() const;
+
+    /** Times of the reads in the time series, oldest first. Each entry in
+     * the series holds the pulses counted since the previous read */
+    std::vector<std::chrono::steady_clock::time_point> get_times() const;
+    /** Pulses counted by \p counter for each entry in the time series */
+    std::vector<uint16_t> get_deltas(size_t counter) const;
+};
+
+#endif
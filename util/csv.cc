@@ -0,0 +1,85 @@
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "csv.h"
+
+namespace {
+
+/* lines formatted by each thread before the buffers are written */
+const size_t block_lines = 1 << 16;
+
+template <typename T>
+void format_csv(std::vector<char> &buf, const T *data, size_t first_line,
+    size_t last_line, unsigned num_columns)
+{
+    /* digits, sign and comma */
+    constexpr size_t max_len = std::numeric_limits<T>::digits10 + 3;
+    buf.resize((last_line - first_line) * (num_columns * max_len + 1));
+
+    char *p = buf.data();
+    for (size_t i = first_line; i < last_line; i++) {
+        const T *line = data + i * num_columns;
+        for (unsigned j = 0; j < num_columns; j++) {
+            p = std::to_chars(p, p + max_len, line[j]).ptr;
+            *p++ = ',';
+        }
+        *p++ = '\n';
+    }
+    buf.resize(p - buf.data());
+}
+
+}
+
+template <typename T>
+void write_csv(FILE *f, const T *data, size_t size, unsigned num_columns,
+    unsigned num_threads)
+{
+    if (num_columns == 0)
+        throw std::logic_error("CSV needs at least one column");
+    if (num_threads == 0)
+        num_threads = 1;
+
+    const size_t lines = size / num_columns;
+
+    /* reused for every block, so they are only allocated once */
+    std::vector<std::vector<char>> bufs(num_threads);
+    std::vector<std::thread> threads;
+
+    for (size_t line = 0; line < lines;) {
+        /* the next lines are split into one block per thread, with the first
+         * block being formatted by this thread */
+        const size_t first = line,
+                     first_last = std::min(line + block_lines, lines);
+        line = first_last;
+
+        unsigned used = 1;
+        for (; used < num_threads && line < lines; used++) {
+            const size_t last = std::min(line + block_lines, lines);
+            threads.emplace_back(format_csv<T>, std::ref(bufs[used]), data,
+                line, last, num_columns);
+            line = last;
+        }
+
+        format_csv(bufs[0], data, first, first_last, num_columns);
+        for (auto &t : threads)
+            t.join();
+        threads.clear();
+
+        for (unsigned i = 0; i < used; i++)
+            if (fwrite(bufs[i].data(), 1, bufs[i].size(), f) != bufs[i].size())
+                throw std::runtime_error("couldn't write CSV output");
+    }
+}
+
+template void write_csv(FILE *, const int8_t *, size_t, unsigned, unsigned);
+template void write_csv(FILE *, const uint8_t *, size_t, unsigned, unsigned);
+template void write_csv(FILE *, const int16_t *, size_t, unsigned, unsigned);
+template void write_csv(FILE *, const uint16_t *, size_t, unsigned, unsigned);
+template void write_csv(FILE *, const int32_t *, size_t, unsigned, unsigned);
+template void write_csv(FILE *, const uint32_t *, size_t, unsigned, unsigned);
@@ -0,0 +1,16 @@
+#ifndef CSV_H
+#define CSV_H
+
+#include <cstddef>
+#include <cstdio>
+
+/** Write \p size values from \p data as CSV lines with \p num_columns values
+ * each, every value followed by a comma. Values are formatted into large
+ * buffers which are written with a single call each, and formatting can be
+ * split between \p num_threads threads. Throws std::runtime_error if writing
+ * fails. */
+template <typename T>
+void write_csv(FILE *f, const T *data, size_t size, unsigned num_columns,
+    unsigned num_threads = 1);
+
+#endif
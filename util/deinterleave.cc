@@ -0,0 +1,276 @@
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+#if defined(__x86_64__) && defined(__SSE4_1__)
+#define USE_SSE41
+#include <immintrin.h>
+#endif
+
+#include "deinterleave.h"
+
+namespace {
+
+#ifdef USE_SSE41
+/* transpose a matrix of A x A lanes, each lane being 16/A bytes wide */
+template <unsigned A> void transpose(__m128i (&v)[A])
+{
+    if constexpr (A == 2) {
+        __m128i t0 = _mm_unpacklo_epi64(v[0], v[1]),
+                t1 = _mm_unpackhi_epi64(v[0], v[1]);
+        v[0] = t0;
+        v[1] = t1;
+    } else if constexpr (A == 4) {
+        __m128i t0 = _mm_unpacklo_epi32(v[0], v[1]),
+                t1 = _mm_unpacklo_epi32(v[2], v[3]),
+                t2 = _mm_unpackhi_epi32(v[0], v[1]),
+                t3 = _mm_unpackhi_epi32(v[2], v[3]);
+        v[0] = _mm_unpacklo_epi64(t0, t1);
+        v[1] = _mm_unpackhi_epi64(t0, t1);
+        v[2] = _mm_unpacklo_epi64(t2, t3);
+        v[3] = _mm_unpackhi_epi64(t2, t3);
+    } else if constexpr (A == 8) {
+        __m128i a[8], b[8];
+        for (unsigned i = 0; i < 8; i += 2) {
+            a[i] = _mm_unpacklo_epi16(v[i], v[i + 1]);
+            a[i + 1] = _mm_unpackhi_epi16(v[i], v[i + 1]);
+        }
+        for (unsigned i = 0; i < 8; i += 4) {
+            b[i] = _mm_unpacklo_epi32(a[i], a[i + 2]);
+            b[i + 1] = _mm_unpackhi_epi32(a[i], a[i + 2]);
+            b[i + 2] = _mm_unpacklo_epi32(a[i + 1], a[i + 3]);
+            b[i + 3] = _mm_unpackhi_epi32(a[i + 1], a[i + 3]);
+        }
+        for (unsigned i = 0; i < 4; i++) {
+            v[2 * i] = _mm_unpacklo_epi64(b[i], b[i + 4]);
+            v[2 * i + 1] = _mm_unpackhi_epi64(b[i], b[i + 4]);
+        }
+    }
+}
+
+/* shuffle mask which groups the atoms inside a vector, so that atom k ends up
+ * in lane k */
+template <unsigned A, unsigned W> constexpr std::array<uint8_t, 16> lane_mask()
+{
+    std::array<uint8_t, 16> m { };
+    constexpr unsigned lane = 16 / A;
+    for (unsigned p = 0; p < 16; p++) {
+        unsigned k = p / lane, sample = (p % lane) / W, byte = p % W;
+        m[p] = sample * A * W + k * W + byte;
+    }
+    return m;
+}
+
+/* convert the 4 lowest elements into int32 */
+template <class T> __m128i low_to_epi32(__m128i v)
+{
+    if constexpr (std::is_same_v<T, int8_t>)
+        return _mm_cvtepi8_epi32(v);
+    else if constexpr (std::is_same_v<T, uint8_t>)
+        return _mm_cvtepu8_epi32(v);
+    else if constexpr (std::is_same_v<T, int16_t>)
+        return _mm_cvtepi16_epi32(v);
+    else if constexpr (std::is_same_v<T, uint16_t>)
+        return _mm_cvtepu16_epi32(v);
+    else
+        return v;
+}
+
+/* conversions which can be done with vector instructions; uint32_t to floating
+ * point would require handling values which don't fit in an int32 */
+template <class T, class Out>
+constexpr bool sse_convertible = std::is_same_v<T, Out>
+    || (std::is_floating_point_v<Out> && !std::is_same_v<T, uint32_t>)
+    || (std::is_integral_v<Out> && sizeof(Out) == 4);
+
+template <class T, class Out> void store_atom(Out *dst, __m128i v, Out scale)
+{
+    if constexpr (std::is_same_v<T, Out>) {
+        _mm_storeu_si128((__m128i *)dst, v);
+    } else {
+        for (unsigned c = 0; c < 16 / sizeof(T); c += 4) {
+            __m128i e = low_to_epi32<T>(v);
+            v = _mm_srli_si128(v, 4 * sizeof(T));
+
+            if constexpr (std::is_same_v<Out, float>) {
+                _mm_storeu_ps(dst + c,
+                    _mm_mul_ps(_mm_cvtepi32_ps(e), _mm_set1_ps(scale)));
+            } else if constexpr (std::is_same_v<Out, double>) {
+                __m128d s = _mm_set1_pd(scale);
+                _mm_storeu_pd(dst + c, _mm_mul_pd(_mm_cvtepi32_pd(e), s));
+                _mm_storeu_pd(dst + c + 2,
+                    _mm_mul_pd(_mm_cvtepi32_pd(_mm_srli_si128(e, 8)), s));
+            } else {
+                _mm_storeu_si128((__m128i *)(dst + c), e);
+            }
+        }
+    }
+}
+
+/* returns the number of samples which were processed */
+template <unsigned A, class T, class Out>
+size_t deinterleave_sse(const T *src, size_t samples, Out *const *dest,
+    size_t offset, const Out *scale)
+{
+    constexpr unsigned w = sizeof(T);
+    /* a block is 16 bytes of each atom */
+    constexpr size_t block = 16 / w;
+
+    size_t i = 0;
+    if constexpr (w * A <= 16) {
+        static constexpr auto mask_array = lane_mask<A, w>();
+        const __m128i mask
+            = _mm_loadu_si128((const __m128i *)mask_array.data());
+
+        for (; i + block <= samples; i += block) {
+            const __m128i *p = (const __m128i *)(src + i * A);
+            __m128i v[A];
+            for (unsigned j = 0; j < A; j++)
+                v[j] = _mm_shuffle_epi8(_mm_loadu_si128(p + j), mask);
+            transpose(v);
+            for (unsigned k = 0; k < A; k++)
+                store_atom<T>(dest[k] + offset + i, v[k], scale[k]);
+        }
+    } else {
+        /* 8 atoms of 32 bits: each sample is two vectors with 4 atoms each,
+         * so the atoms are already in their lanes */
+        static_assert(A == 8 && w == 4);
+        for (; i + block <= samples; i += block) {
+            const __m128i *p = (const __m128i *)(src + i * A);
+            __m128i lo[4], hi[4];
+            for (unsigned j = 0; j < 4; j++) {
+                lo[j] = _mm_loadu_si128(p + 2 * j);
+                hi[j] = _mm_loadu_si128(p + 2 * j + 1);
+            }
+            transpose(lo);
+            transpose(hi);
+            for (unsigned k = 0; k < 4; k++) {
+                store_atom<T>(dest[k] + offset + i, lo[k], scale[k]);
+                store_atom<T>(dest[k + 4] + offset + i, hi[k], scale[k + 4]);
+            }
+        }
+    }
+
+    return i;
+}
+#endif
+
+}
+
+template <class T, class Out>
+Deinterleaver<T, Out>::Deinterleaver(
+    std::vector<Out *> dest, std::vector<double> scale)
+    : dest(std::move(dest))
+{
+    const size_t num_atoms = this->dest.size();
+    if (num_atoms == 0)
+        throw std::logic_error("no atoms to de-interleave");
+    if (!scale.empty() && scale.size() != num_atoms)
+        throw std::logic_error("scale must have one value per atom");
+    if (!scale.empty() && !std::is_floating_point_v<Out>)
+        throw std::logic_error("scale is only supported for floating point");
+
+    this->scale.resize(num_atoms, 1);
+    for (size_t i = 0; i < scale.size(); i++)
+        this->scale[i] = scale[i];
+
+    sample_size = num_atoms * sizeof(T);
+    partial.resize(num_atoms);
+}
+
+template <class T, class Out>
+void Deinterleaver<T, Out>::process(const T *src, size_t samples)
+{
+    const size_t num_atoms = dest.size();
+    size_t i = 0;
+
+#ifdef USE_SSE41
+    if constexpr (sse_convertible<T, Out>) {
+        switch (num_atoms) {
+        case 2:
+            i = deinterleave_sse<2>(
+                src, samples, dest.data(), written, scale.data());
+            break;
+        case 4:
+            i = deinterleave_sse<4>(
+                src, samples, dest.data(), written, scale.data());
+            break;
+        case 8:
+            i = deinterleave_sse<8>(
+                src, samples, dest.data(), written, scale.data());
+            break;
+        }
+    }
+#endif
+
+    if constexpr (std::is_same_v<T, Out>) {
+        if (num_atoms == 1) {
+            memcpy(dest[0] + written, src, samples * sizeof(T));
+            i = samples;
+        }
+    }
+
+    for (; i < samples; i++) {
+        for (size_t k = 0; k < num_atoms; k++) {
+            if constexpr (std::is_floating_point_v<Out>)
+                dest[k][written + i] = src[i * num_atoms + k] * scale[k];
+            else
+                dest[k][written + i] = static_cast<Out>(src[i * num_atoms + k]);
+        }
+    }
+
+    written += samples;
+}
+
+template <class T, class Out>
+void Deinterleaver<T, Out>::push(const void *src, size_t bytes)
+{
+    const unsigned char *p = (const unsigned char *)src;
+
+    if (partial_bytes) {
+        size_t n = std::min(sample_size - partial_bytes, bytes);
+        memcpy((unsigned char *)partial.data() + partial_bytes, p, n);
+        partial_bytes += n;
+        p += n;
+        bytes -= n;
+
+        if (partial_bytes < sample_size)
+            return;
+        process(partial.data(), 1);
+        partial_bytes = 0;
+    }
+
+    size_t samples = bytes / sample_size;
+    if ((uintptr_t)p % alignof(T) == 0) {
+        process((const T *)p, samples);
+    } else {
+        /* chunks split at odd offsets leave the data misaligned for T */
+        std::vector<T> v(samples * dest.size());
+        memcpy(v.data(), p, samples * sample_size);
+        process(v.data(), samples);
+    }
+    p += samples * sample_size;
+    bytes -= samples * sample_size;
+
+    memcpy(partial.data(), p, bytes);
+    partial_bytes = bytes;
+}
+
+#define INSTANTIATE_DEINTERLEAVER(T)                                           \
+    template class Deinterleaver<T, int8_t>;                                   \
+    template class Deinterleaver<T, uint8_t>;                                  \
+    template class Deinterleaver<T, int16_t>;                                  \
+    template class Deinterleaver<T, uint16_t>;                                 \
+    template class Deinterleaver<T, int32_t>;                                  \
+    template class Deinterleaver<T, uint32_t>;                                 \
+    template class Deinterleaver<T, float>;                                    \
+    template class Deinterleaver<T, double>;
+
+INSTANTIATE_DEINTERLEAVER(int8_t)
+INSTANTIATE_DEINTERLEAVER(uint8_t)
+INSTANTIATE_DEINTERLEAVER(int16_t)
+INSTANTIATE_DEINTERLEAVER(uint16_t)
+INSTANTIATE_DEINTERLEAVER(int32_t)
+INSTANTIATE_DEINTERLEAVER(uint32_t)
@@ -0,0 +1,37 @@
+#ifndef DEINTERLEAVE_H
+#define DEINTERLEAVE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/** De-interleaves a stream of samples, each made of a fixed number of atoms of
+ * type T, into one array per atom, converting them to Out. When Out is a
+ * floating point type, each atom can be multiplied by its own scale factor.
+ *
+ * Data can be pushed in chunks of any size, including ones which split
+ * samples, so this can be done in the same pass as a copy from the device. */
+template <class T, class Out> class Deinterleaver {
+    std::vector<Out *> dest;
+    std::vector<Out> scale;
+    size_t sample_size;
+    size_t written = 0;
+
+    /* holds a sample which was split between chunks */
+    std::vector<T> partial;
+    size_t partial_bytes = 0;
+
+    void process(const T *src, size_t samples);
+
+public:
+    /** \p dest has one pointer per atom, each of which must have space for all
+     * the samples that will be pushed. \p scale can be empty, or have one
+     * value per atom; it's only supported for floating point Out. */
+    Deinterleaver(std::vector<Out *> dest, std::vector<double> scale = {});
+
+    void push(const void *src, size_t bytes);
+    /** Amount of complete samples written into each atom's array */
+    size_t samples() const { return written; }
+};
+
+#endif
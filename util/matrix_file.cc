@@ -0,0 +1,173 @@
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "matrix_file.h"
+
+static_assert(sizeof(struct matrix_file_header) == 32);
+
+namespace {
+
+const uint32_t matrix_version = 1;
+const char matrix_magic[8] = "UHALMTX";
+enum : uint32_t {
+    element_double,
+    element_fixed,
+};
+
+[[noreturn]] void throw_errno(const std::string &msg)
+{
+    throw std::runtime_error(msg + ": " + strerror(errno));
+}
+
+void write_file(const std::string &path, const matrix_file_header &h,
+    const void *data, size_t size)
+{
+    FILE *f = fopen(path.c_str(), "wb");
+    if (!f)
+        throw_errno("couldn't open " + path);
+
+    bool ok = fwrite(&h, sizeof h, 1, f) == 1
+        && fwrite(data, 1, size, f) == size;
+    ok = (fclose(f) == 0) && ok;
+    if (!ok)
+        throw std::runtime_error("couldn't write " + path);
+}
+
+matrix_file_header make_header(size_t rows, size_t cols, size_t size,
+    uint32_t element_type, unsigned fixed_point_pos)
+{
+    if (rows * cols != size)
+        throw std::logic_error("matrix data doesn't match its dimensions");
+
+    matrix_file_header h = { };
+    memcpy(h.magic, matrix_magic, sizeof h.magic);
+    h.version = matrix_version;
+    h.header_size = sizeof h;
+    h.rows = rows;
+    h.cols = cols;
+    h.element_type = element_type;
+    h.fixed_point_pos = fixed_point_pos;
+    return h;
+}
+
+}
+
+MatrixFile::MatrixFile(const std::string &path)
+{
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        throw_errno("couldn't open " + path);
+
+    struct stat st;
+    if (fstat(fd, &st)) {
+        close(fd);
+        throw_errno("couldn't stat " + path);
+    }
+    len = st.st_size;
+
+    if (len < sizeof(matrix_file_header)) {
+        close(fd);
+        throw std::runtime_error(path + " is too small for a matrix file");
+    }
+
+    void *p = mmap(nullptr, len, PROT_READ, MAP_SHARED, fd, 0);
+    /* the mapping stays valid after the file is closed */
+    close(fd);
+    if (p == MAP_FAILED)
+        throw_errno("couldn't map " + path);
+    map = (const unsigned char *)p;
+    header = (const matrix_file_header *)map;
+
+    const char *error = nullptr;
+    const size_t element_size = header->element_type == element_double
+        ? sizeof(double)
+        : sizeof(uint32_t);
+    if (memcmp(header->magic, matrix_magic, sizeof header->magic))
+        error = " isn't a matrix file";
+    else if (header->version != matrix_version
+        || header->header_size < sizeof *header
+        || header->header_size % sizeof(double)
+        || header->element_type > element_fixed)
+        error = " has an unsupported matrix file version";
+    else if (header->element_type == element_fixed
+        && header->fixed_point_pos > 31)
+        error = " has an invalid fixed point position";
+    else if (header->header_size > len
+        || (len - header->header_size) / element_size
+        < (uint64_t)header->rows * header->cols)
+        error = " is truncated";
+
+    if (error) {
+        munmap((void *)map, len);
+        throw std::runtime_error(path + error);
+    }
+}
+
+MatrixFile::~MatrixFile()
+{
+    munmap((void *)map, len);
+}
+
+size_t MatrixFile::rows() const
+{
+    return header->rows;
+}
+
+size_t MatrixFile::cols() const
+{
+    return header->cols;
+}
+
+bool MatrixFile::is_fixed_point() const
+{
+    return header->element_type == element_fixed;
+}
+
+unsigned MatrixFile::fixed_point_pos() const
+{
+    return header->fixed_point_pos;
+}
+
+std::span<const double> MatrixFile::row(size_t i) const
+{
+    if (is_fixed_point())
+        throw std::logic_error("matrix holds fixed point values");
+    if (i >= rows())
+        throw std::out_of_range("matrix row doesn't exist");
+
+    return { (const double *)(map + header->header_size) + i * cols(),
+        cols() };
+}
+
+std::span<const uint32_t> MatrixFile::row_fixed(size_t i) const
+{
+    if (!is_fixed_point())
+        throw std::logic_error("matrix holds doubles");
+    if (i >= rows())
+        throw std::out_of_range("matrix row doesn't exist");
+
+    return { (const uint32_t *)(map + header->header_size) + i * cols(),
+        cols() };
+}
+
+void MatrixFile::write(const std::string &path, size_t rows, size_t cols,
+    std::span<const double> data)
+{
+    write_file(path, make_header(rows, cols, data.size(), element_double, 0),
+        data.data(), data.size_bytes());
+}
+
+void MatrixFile::write(const std::string &path, size_t rows, size_t cols,
+    std::span<const uint32_t> data, unsigned fixed_point_pos)
+{
+    write_file(path,
+        make_header(rows, cols, data.size(), element_fixed, fixed_point_pos),
+        data.data(), data.size_bytes());
+}
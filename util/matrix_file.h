@@ -0,0 +1,55 @@
+#ifndef MATRIX_FILE_H
+#define MATRIX_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+
+/** Header of a binary matrix file, in native byte order. It's followed by the
+ * elements in row-major order */
+struct matrix_file_header {
+    /** "UHALMTX" followed by a NUL character */
+    char magic[8];
+    uint32_t version;
+    /** Size of this header in bytes, which is where the elements start */
+    uint32_t header_size;
+    uint32_t rows, cols;
+    /** 0 for doubles, 1 for 32-bit fixed point values */
+    uint32_t element_type;
+    /** Position of the point for fixed point values */
+    uint32_t fixed_point_pos;
+};
+
+/** Maps a binary matrix file into memory, giving access to its rows without
+ * copying them. Errors are reported with std::runtime_error. */
+class MatrixFile {
+    const unsigned char *map = nullptr;
+    size_t len = 0;
+    const matrix_file_header *header;
+
+public:
+    MatrixFile(const std::string &path);
+    ~MatrixFile();
+    MatrixFile(const MatrixFile &) = delete;
+    MatrixFile &operator=(const MatrixFile &) = delete;
+
+    size_t rows() const;
+    size_t cols() const;
+    bool is_fixed_point() const;
+    unsigned fixed_point_pos() const;
+
+    /** Only valid for files with doubles */
+    std::span<const double> row(size_t i) const;
+    /** Only valid for files with fixed point values */
+    std::span<const uint32_t> row_fixed(size_t i) const;
+
+    /** Write a file with \p rows * \p cols doubles */
+    static void write(const std::string &path, size_t rows, size_t cols,
+        std::span<const double> data);
+    /** Write a file with \p rows * \p cols fixed point values */
+    static void write(const std::string &path, size_t rows, size_t cols,
+        std::span<const uint32_t> data, unsigned fixed_point_pos);
+};
+
+#endif
@@ -201,6 +201,62 @@ void bar2_read_v(struct pcie_bars *bars, size_t addr, void *dest, size_t n)
     pthread_mutex_unlock(&bars->locks[BAR2]);
 }
 
+void bar2_read_cb(struct pcie_bars *bars, size_t addr, size_t n,
+    void (*cb)(void *arg, const void *src, size_t n), void *arg)
+{
+    pthread_mutex_lock(&bars->locks[BAR2]);
+
+    size_t sz = bars->sizes[1];
+
+    uint32_t scratch[1024] __attribute__((aligned(64)));
+    const size_t read_size = sizeof scratch / sizeof scratch[0];
+
+    while (n) {
+        const size_t addr_now = PCIE_ADDR_SDRAM_PG_OFFS(addr);
+        const size_t can_read = sz - addr_now;
+        const size_t to_read = can_read < n ? can_read : n;
+
+        set_sdram_pg(bars, PCIE_ADDR_SDRAM_PG(addr));
+
+        /* stores number of uint32_t's read */
+        size_t i = 0;
+
+#ifdef USE_SSE41
+        const size_t alignment = 64;
+
+        size_t head = addr_now % alignment;
+        head = head ? alignment - head : 0;
+        for (size_t j = head; i < to_read / 4 && j; i++, j -= 4)
+            scratch[i] = *bar2_get_u32p_small(bars, addr_now, i);
+        if (i)
+            cb(arg, scratch, i * 4);
+
+        for (; i + (read_size - 1) < to_read / 4; i += read_size) {
+            _mm_mfence();
+            for (size_t j = 0; j < read_size; j += 4)
+                _mm_store_si128((__m128i *)(scratch + j),
+                    _mm_stream_load_si128(
+                        (__m128i *)bar2_get_u32p_small(bars, addr_now, i + j)));
+            _mm_mfence();
+
+            cb(arg, scratch, read_size * 4);
+        }
+#endif
+        while (i < to_read / 4) {
+            size_t j = 0;
+            for (; j < read_size && i < to_read / 4; i++, j++)
+                scratch[j] = *bar2_get_u32p_small(bars, addr_now, i);
+            cb(arg, scratch, j * 4);
+        }
+
+        n -= to_read;
+        addr += to_read;
+        assert((to_read & 0x3) == 0);
+    }
+
+    pthread_mutex_unlock(&bars->locks[BAR2]);
+}
+
 static size_t bar4_access_offset(struct pcie_bars *bars, size_t addr)
 {
     uint32_t pg_num = PCIE_ADDR_WB_PG(addr);
@@ -371,6 +427,17 @@ unlock:
     pthread_mutex_unlock(&bars->locks[BAR4]);
 }
 
+void bar4_read_repeat(struct pcie_bars *bars, size_t addr, void *dest,
+    size_t n, size_t count)
+{
+    pthread_mutex_lock(&bars->locks[BAR4]);
+
+    for (size_t i = 0; i < count; i++)
+        bar4_read_v(bars, addr, (unsigned char *)dest + i * n, n);
+
+    pthread_mutex_unlock(&bars->locks[BAR4]);
+}
+
 static void bar4_reset(const struct pcie_bars *bars)
 {
     bar0_write(bars, PCIE_CFG_REG_TX_CTRL, PCIE_CFG_TX_CTRL_CHANNEL_RST);
@@ -11,11 +11,21 @@
 extern "C" {
 #endif
 void bar2_read_v(struct pcie_bars *bars, size_t addr, void *dest, size_t n);
+/** Read from BAR2 into an internal buffer, calling \p cb for each chunk that
+ * was read, which allows processing the data while it's still in cache. \p cb
+ * is called with the BAR2 lock held, and must not throw. */
+void bar2_read_cb(struct pcie_bars *bars, size_t addr, size_t n,
+    void (*cb)(void *arg, const void *src, size_t n), void *arg);
 void bar4_write(struct pcie_bars *bars, size_t addr, uint32_t value);
 void bar4_write_v(
     struct pcie_bars *bars, size_t addr, const void *src, size_t n);
 uint32_t bar4_read(struct pcie_bars *bars, size_t addr);
 void bar4_read_v(struct pcie_bars *bars, size_t addr, void *dest, size_t n);
+/** Read the same \p n bytes at \p addr \p count times into consecutive
+ * positions of \p dest, with the BAR4 lock held for all of them. Useful for
+ * draining FIFOs, where each read pops an entry. */
+void bar4_read_repeat(struct pcie_bars *bars, size_t addr, void *dest,
+    size_t n, size_t count);
 
 void device_reset(const struct pcie_bars *bars);
 #ifdef __cplusplus
@@ -0,0 +1,133 @@
+#include <array>
+
+#include "position.h"
+#include "simd.h"
+
+namespace {
+
+/* parameters converted to the form used by the kernels */
+struct kernel_params {
+    float kx, ky, ksum, offset_x, offset_y;
+    /* amp * gain - offset_gain */
+    std::array<float, 4> gain, offset_gain;
+
+    kernel_params(const position_params &p, position_method method)
+    {
+        const double half = method == position_method::partial_delta ? .5 : 1;
+        kx = p.kx * half;
+        ky = p.ky * half;
+        ksum = p.ksum;
+        offset_x = p.offset_x;
+        offset_y = p.offset_y;
+        for (unsigned i = 0; i < 4; i++) {
+            gain[i] = p.gains[i];
+            offset_gain[i] = p.offsets[i] * p.gains[i];
+        }
+    }
+};
+
+template <position_method method>
+void positions_scalar(const kernel_params &k,
+    const std::array<const float *, 4> &amps,
+    const std::array<float *, 4> &out, size_t first, size_t n)
+{
+    for (size_t i = first; i < n; i++) {
+        const float a = amps[0][i] * k.gain[0] - k.offset_gain[0],
+                    b = amps[1][i] * k.gain[1] - k.offset_gain[1],
+                    c = amps[2][i] * k.gain[2] - k.offset_gain[2],
+                    d = amps[3][i] * k.gain[3] - k.offset_gain[3];
+        const float ac = a + c, bd = b + d, s = ac + bd;
+
+        float x, y;
+        if constexpr (method == position_method::delta_over_sum) {
+            const float r = 1.f / s;
+            x = ((a - b) - (c - d)) * r;
+            y = ((a + b) - (c + d)) * r;
+        } else {
+            const float u = (a - c) / ac, v = (b - d) / bd;
+            x = u - v;
+            y = u + v;
+        }
+
+        out[0][i] = k.kx * x - k.offset_x;
+        out[1][i] = k.ky * y - k.offset_y;
+        out[2][i] = (ac - bd) / s;
+        out[3][i] = k.ksum * s;
+    }
+}
+
+#ifdef USE_SSE2
+template <position_method method>
+size_t positions_sse(const kernel_params &k,
+    const std::array<const float *, 4> &amps,
+    const std::array<float *, 4> &out, size_t n)
+{
+    __m128 gain[4], offset_gain[4];
+    for (unsigned j = 0; j < 4; j++) {
+        gain[j] = _mm_set1_ps(k.gain[j]);
+        offset_gain[j] = _mm_set1_ps(k.offset_gain[j]);
+    }
+    const __m128 kx = _mm_set1_ps(k.kx), ky = _mm_set1_ps(k.ky),
+                 ksum = _mm_set1_ps(k.ksum),
+                 offset_x = _mm_set1_ps(k.offset_x),
+                 offset_y = _mm_set1_ps(k.offset_y), one = _mm_set1_ps(1.f);
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 v[4];
+        for (unsigned j = 0; j < 4; j++)
+            v[j] = _mm_sub_ps(
+                _mm_mul_ps(_mm_loadu_ps(amps[j] + i), gain[j]),
+                offset_gain[j]);
+        const __m128 &a = v[0], &b = v[1], &c = v[2], &d = v[3];
+        const __m128 ac = _mm_add_ps(a, c), bd = _mm_add_ps(b, d),
+                     s = _mm_add_ps(ac, bd);
+
+        __m128 x, y;
+        if constexpr (method == position_method::delta_over_sum) {
+            const __m128 r = _mm_div_ps(one, s);
+            x = _mm_mul_ps(
+                _mm_sub_ps(_mm_sub_ps(a, b), _mm_sub_ps(c, d)), r);
+            y = _mm_mul_ps(
+                _mm_sub_ps(_mm_add_ps(a, b), _mm_add_ps(c, d)), r);
+        } else {
+            const __m128 u = _mm_div_ps(_mm_sub_ps(a, c), ac),
+                         w = _mm_div_ps(_mm_sub_ps(b, d), bd);
+            x = _mm_sub_ps(u, w);
+            y = _mm_add_ps(u, w);
+        }
+
+        _mm_storeu_ps(out[0] + i, _mm_sub_ps(_mm_mul_ps(kx, x), offset_x));
+        _mm_storeu_ps(out[1] + i, _mm_sub_ps(_mm_mul_ps(ky, y), offset_y));
+        _mm_storeu_ps(out[2] + i, _mm_div_ps(_mm_sub_ps(ac, bd), s));
+        _mm_storeu_ps(out[3] + i, _mm_mul_ps(ksum, s));
+    }
+
+    return i;
+}
+#endif
+
+template <position_method method>
+void positions(const kernel_params &k,
+    const std::array<const float *, 4> &amps,
+    const std::array<float *, 4> &out, size_t n)
+{
+    size_t first = 0;
+#ifdef USE_SSE2
+    first = positions_sse<method>(k, amps, out, n);
+#endif
+    positions_scalar<method>(k, amps, out, first, n);
+}
+
+}
+
+void compute_positions(const position_params &params, position_method method,
+    const std::array<const float *, 4> &amps,
+    const std::array<float *, 4> &out, size_t n)
+{
+    const kernel_params k(params, method);
+    if (method == position_method::delta_over_sum)
+        positions<position_method::delta_over_sum>(k, amps, out, n);
+    else
+        positions<position_method::partial_delta>(k, amps, out, n);
+}
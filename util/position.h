@@ -0,0 +1,35 @@
+#ifndef POSITION_H
+#define POSITION_H
+
+#include <array>
+#include <cstddef>
+
+/** Parameters for compute_positions(), usually obtained from a pos_calc core */
+struct position_params {
+    /** Sensitivities, in the unit of the positions */
+    double kx = 1, ky = 1;
+    double ksum = 1;
+    double offset_x = 0, offset_y = 0;
+    /** Per-channel correction, applied as (amp - offsets[i]) * gains[i] */
+    std::array<double, 4> gains { 1, 1, 1, 1 };
+    std::array<double, 4> offsets { };
+};
+
+enum class position_method {
+    /** X = KX (A - B - C + D) / S - OFFSET_X, Y = KY (A + B - C - D) / S -
+     * OFFSET_Y, with S = A + B + C + D */
+    delta_over_sum,
+    /** X = KX/2 (U - V) - OFFSET_X, Y = KY/2 (U + V) - OFFSET_Y, with
+     * U = (A - C) / (A + C) and V = (B - D) / (B + D) */
+    partial_delta,
+};
+
+/** Compute X, Y, Q and SUM for \p n samples from the amplitudes of channels A,
+ * B, C and D, in \p amps. Q = (A - B + C - D) / S and SUM = KSUM S for both
+ * methods. Samples where a denominator is zero produce infinities or NaNs.
+ * Output arrays are, in order, X, Y, Q and SUM, and can't overlap the input */
+void compute_positions(const position_params &, position_method,
+    const std::array<const float *, 4> &amps,
+    const std::array<float *, 4> &out, size_t n);
+
+#endif
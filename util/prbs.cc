@@ -0,0 +1,215 @@
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <stdexcept>
+#include <thread>
+
+#include "prbs.h"
+#include "simd.h"
+
+namespace {
+
+/* feedback taps for each LFSR length, with bit 0 being stage 1 */
+#define T(n) (1ULL << ((n) - 1))
+const uint64_t lfsr_taps[33] = {
+    0,
+    0,
+    T(2) | T(1),
+    T(3) | T(2),
+    T(4) | T(3),
+    T(5) | T(3),
+    T(6) | T(5),
+    T(7) | T(6),
+    T(8) | T(6) | T(5) | T(4),
+    T(9) | T(5),
+    T(10) | T(7),
+    T(11) | T(9),
+    T(12) | T(6) | T(4) | T(1),
+    T(13) | T(4) | T(3) | T(1),
+    T(14) | T(5) | T(3) | T(1),
+    T(15) | T(14),
+    T(16) | T(15) | T(13) | T(4),
+    T(17) | T(14),
+    T(18) | T(11),
+    T(19) | T(6) | T(2) | T(1),
+    T(20) | T(17),
+    T(21) | T(19),
+    T(22) | T(21),
+    T(23) | T(18),
+    T(24) | T(23) | T(22) | T(17),
+    T(25) | T(22),
+    T(26) | T(6) | T(2) | T(1),
+    T(27) | T(5) | T(2) | T(1),
+    T(28) | T(25),
+    T(29) | T(27),
+    T(30) | T(6) | T(4) | T(1),
+    T(31) | T(28),
+    T(32) | T(22) | T(2) | T(1),
+};
+#undef T
+
+void check_config(unsigned lfsr_length, unsigned step_duration)
+{
+    if (lfsr_length < 2 || lfsr_length > 32)
+        throw std::logic_error("LFSR length must be between 2 and 32");
+    if (step_duration < 1)
+        throw std::logic_error("step duration must be at least 1");
+}
+
+double dot(const double *a, const double *b, size_t n)
+{
+    size_t i = 0;
+    double r = 0;
+#ifdef USE_SSE2
+    /* two accumulators, to hide the latency of the additions */
+    __m128d acc0 = _mm_setzero_pd(), acc1 = _mm_setzero_pd();
+    for (; i + 4 <= n; i += 4) {
+        acc0 = _mm_add_pd(
+            acc0, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+        acc1 = _mm_add_pd(acc1,
+            _mm_mul_pd(_mm_loadu_pd(a + i + 2), _mm_loadu_pd(b + i + 2)));
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, _mm_add_pd(acc0, acc1));
+    r = lanes[0] + lanes[1];
+#endif
+    for (; i < n; i++)
+        r += a[i] * b[i];
+    return r;
+}
+
+}
+
+std::vector<uint8_t> prbs_sequence(
+    unsigned lfsr_length, unsigned step_duration, size_t n)
+{
+    check_config(lfsr_length, step_duration);
+
+    const uint64_t taps = lfsr_taps[lfsr_length],
+                   mask = (1ULL << lfsr_length) - 1;
+    uint64_t state = 0;
+
+    std::vector<uint8_t> r(n);
+    for (size_t i = 0; i < n;) {
+        /* the output is the last stage */
+        const uint8_t v = (state >> (lfsr_length - 1)) & 1;
+        const size_t last = std::min(i + step_duration, n);
+        for (; i < last; i++)
+            r[i] = v;
+
+        const uint64_t feedback = !(std::popcount(state & taps) & 1);
+        state = ((state << 1) | feedback) & mask;
+    }
+
+    return r;
+}
+
+PrbsCorrelator::PrbsCorrelator(
+    unsigned lfsr_length, unsigned step_duration, size_t max_samples)
+{
+    check_config(lfsr_length, step_duration);
+    step = step_duration;
+    this->max_samples = max_samples;
+    period = ((1ULL << lfsr_length) - 1) * step;
+
+    const auto seq = prbs_sequence(
+        lfsr_length, step_duration, std::min(period, max_samples));
+    excitation.resize(seq.size());
+    for (size_t i = 0; i < seq.size(); i++)
+        excitation[i] = seq[i] ? 1 : -1;
+}
+
+size_t PrbsCorrelator::get_period() const
+{
+    return period;
+}
+
+void PrbsCorrelator::check_size(size_t n, size_t taps) const
+{
+    if (n <= taps)
+        throw std::logic_error("response is too short for the amount of taps");
+    if (n > max_samples)
+        throw std::logic_error("response is longer than the maximum size");
+}
+
+void PrbsCorrelator::estimate(std::span<const double> response,
+    double amplitude, std::span<double> out) const
+{
+    const size_t n = response.size(), taps = out.size();
+    check_size(n, taps);
+
+    std::vector<double> y;
+    size_t len;
+    double norm;
+    if (n >= period) {
+        /* average the whole periods, and repeat the first taps at the end,
+         * so the circular correlation doesn't need to wrap around */
+        y.assign(period + taps, 0);
+        const size_t periods = n / period;
+        for (size_t p = 0; p < periods; p++)
+            for (size_t i = 0; i < period; i++)
+                y[i] += response[p * period + i];
+        for (size_t i = 0; i < period; i++)
+            y[i] /= periods;
+        std::copy_n(y.begin(), taps, y.begin() + period);
+
+        len = period;
+        /* the autocorrelation of the sequence is period at 0 and -step
+         * outside of the first step */
+        norm = period + step;
+    } else {
+        y.assign(response.begin(), response.end());
+        len = n - taps;
+        norm = len;
+    }
+
+    /* removing the average removes the response to the excitation's DC
+     * component, and any offset in the response */
+    double mean = 0;
+    for (size_t i = 0; i < len; i++)
+        mean += y[i];
+    mean /= len;
+    for (auto &v : y)
+        v -= mean;
+
+    /* the excitation is a DC component plus amplitude / 2 times the +1/-1
+     * sequence */
+    norm *= amplitude / 2;
+    for (size_t k = 0; k < taps; k++)
+        out[k] = dot(excitation.data(), y.data() + k, len) / norm;
+}
+
+std::vector<std::vector<double>> PrbsCorrelator::estimate(
+    const std::vector<std::span<const double>> &responses,
+    std::span<const double> amplitudes, size_t taps,
+    unsigned num_threads) const
+{
+    if (amplitudes.size() != responses.size())
+        throw std::logic_error("there must be one amplitude per response");
+    /* errors are reported before starting the threads */
+    for (const auto &response : responses)
+        check_size(response.size(), taps);
+    if (num_threads == 0)
+        num_threads = std::max(std::thread::hardware_concurrency(), 1U);
+    num_threads = std::min<size_t>(num_threads, responses.size());
+
+    std::vector<std::vector<double>> r(
+        responses.size(), std::vector<double>(taps));
+
+    /* channels are handed out one at a time, since they can have different
+     * sizes */
+    std::atomic<size_t> next = 0;
+    auto worker = [&]() {
+        for (size_t i; (i = next++) < responses.size();)
+            estimate(responses[i], amplitudes[i], r[i]);
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned i = 1; i < num_threads; i++)
+        threads.emplace_back(worker);
+    worker();
+    for (auto &t : threads)
+        t.join();
+
+    return r;
+}
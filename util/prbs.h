@@ -0,0 +1,51 @@
+#ifndef PRBS_H
+#define PRBS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/** Generate \p n samples of the PRBS used for system identification, with
+ * each value held for \p step_duration samples. It's produced by an XNOR LFSR
+ * of \p lfsr_length bits (2 to 32) with the maximal length taps from Xilinx
+ * XAPP052, starting from the all zeros state right after a PRBS reset, and
+ * repeats every (2^lfsr_length - 1) * step_duration samples. */
+std::vector<uint8_t> prbs_sequence(
+    unsigned lfsr_length, unsigned step_duration, size_t n);
+
+/** Estimates impulse responses by cross-correlating responses to a PRBS
+ * excitation with the PRBS itself. Responses must be sampled in sync with the
+ * PRBS, starting at a PRBS reset. When a response covers at least one period,
+ * its whole periods are averaged and the correlation is circular; otherwise,
+ * only the samples it has are correlated. With a step duration above 1, the
+ * estimate is the impulse response smoothed over one step. */
+class PrbsCorrelator {
+    size_t period, step, max_samples;
+    /* the PRBS as +1 and -1, for up to one period */
+    std::vector<double> excitation;
+
+    void check_size(size_t n, size_t taps) const;
+
+public:
+    /** Responses given to estimate() can have at most \p max_samples */
+    PrbsCorrelator(
+        unsigned lfsr_length, unsigned step_duration, size_t max_samples);
+
+    /** Number of samples after which the PRBS repeats itself */
+    size_t get_period() const;
+
+    /** Estimate \p out.size() taps of the impulse response from \p response,
+     * which has to hold more samples than that. \p amplitude is the
+     * difference between the excitation levels for PRBS values 1 and 0 */
+    void estimate(std::span<const double> response, double amplitude,
+        std::span<double> out) const;
+    /** Estimate \p taps of the impulse responses for many channels, splitting
+     * them between \p num_threads threads, or one per CPU if it's 0 */
+    std::vector<std::vector<double>> estimate(
+        const std::vector<std::span<const double>> &responses,
+        std::span<const double> amplitudes, size_t taps,
+        unsigned num_threads = 0) const;
+};
+
+#endif
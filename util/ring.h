@@ -0,0 +1,72 @@
+#ifndef RING_H
+#define RING_H
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+
+/** Fixed capacity ring buffer for one producer thread and one consumer thread,
+ * which don't need to synchronize in any other way. Elements are pushed and
+ * popped in batches, and all memory is allocated by the constructor. */
+template <class T> class SpscRing {
+    const size_t mask;
+    std::unique_ptr<T[]> buffer;
+
+    /* free running positions, so full and empty can be told apart; they are
+     * kept in separate cache lines, since each is written by a single thread */
+    alignas(64) std::atomic<uint64_t> head { 0 };
+    alignas(64) std::atomic<uint64_t> tail { 0 };
+
+public:
+    /** \p capacity must be a power of 2 */
+    SpscRing(size_t capacity)
+        : mask(capacity - 1)
+        , buffer(std::make_unique<T[]>(capacity))
+    {
+        if (!std::has_single_bit(capacity))
+            throw std::logic_error("ring capacity must be a power of 2");
+    }
+
+    size_t capacity() const { return mask + 1; }
+    /** Only exact when called by the producer or the consumer while the other
+     * isn't running */
+    size_t size() const
+    {
+        return head.load(std::memory_order_acquire)
+            - tail.load(std::memory_order_acquire);
+    }
+
+    /** Producer only. Push up to \p n elements, returning how many fit */
+    size_t push(const T *src, size_t n)
+    {
+        const uint64_t h = head.load(std::memory_order_relaxed);
+        const uint64_t t = tail.load(std::memory_order_acquire);
+        n = std::min(n, capacity() - (size_t)(h - t));
+
+        for (size_t i = 0; i < n; i++)
+            buffer[(h + i) & mask] = src[i];
+
+        head.store(h + n, std::memory_order_release);
+        return n;
+    }
+
+    /** Consumer only. Pop up to \p n elements, returning how many there were */
+    size_t pop(T *dest, size_t n)
+    {
+        const uint64_t t = tail.load(std::memory_order_relaxed);
+        const uint64_t h = head.load(std::memory_order_acquire);
+        n = std::min(n, (size_t)(h - t));
+
+        for (size_t i = 0; i < n; i++)
+            dest[i] = buffer[(t + i) & mask];
+
+        tail.store(t + n, std::memory_order_release);
+        return n;
+    }
+};
+
+#endif
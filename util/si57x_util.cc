@@ -1,5 +1,7 @@
 #include <array>
 #include <cmath>
+#include <map>
+#include <mutex>
 #include <ranges>
 
 #include "si57x_util.h"
@@ -8,13 +10,14 @@ namespace {
 const double fdco_min = 4850000000;
 const double fdco_max = 5670000000;
 
+/* n1 can be 1 or an even number up to n1_max_val */
 const uint32_t n1_max_val = 128;
-const uint32_t n1_min_val = 2;
-/* FIXME: n1 can be 1 */
-const uint32_t n1_step = 2;
 const auto hs_div_opts = std::to_array<uint32_t>({ 11, 9, 7, 6, 5, 4 });
 const double rfreq_factor = 1 << 28;
 
+/* results kept by the cache before it's cleared */
+const size_t max_cached = 1 << 16;
+
 uint32_t hw2val_n1(uint32_t n1) { return n1 + 1; }
 uint32_t val2hw_n1(uint32_t n1) { return n1 - 1; }
 
@@ -37,14 +40,33 @@ bool si57x_parameters::calc_fxtal()
     return true;
 }
 
-bool si57x_parameters::set_freq(double freq)
+namespace {
+
+/* finds the parameters with the smallest frequency error, from the ones whose
+ * fdco is within bounds. Since fdco = freq * hs_div * n1, the n1 values for
+ * each hs_div are found from the bounds instead of trying all of them */
+std::optional<si57x_registers> solve(double fxtal, double freq)
 {
-    uint32_t n1_best, hs_div_best;
-    uint64_t rfreq_best;
+    std::optional<si57x_registers> best;
     double freq_err_best = 1e9;
-    bool best_is_set = false;
+
+    /* fdco is calculated from the rounded RFREQ, so it can be up to half of
+     * RFREQ's precision away from freq * hs_div * n1, and the candidates
+     * close to the bounds are checked with the exact fdco */
+    const double margin = fxtal / rfreq_factor;
+
     for (auto hs_div_opt : hs_div_opts) {
-        for (uint32_t n1 = n1_min_val; n1 <= n1_max_val; n1 += n1_step) {
+        const double step = freq * hs_div_opt;
+        double n1_lo = std::ceil((fdco_min - margin) / step),
+               n1_hi = std::floor((fdco_max + margin) / step);
+        n1_lo = std::max(n1_lo, 1.);
+        n1_hi = std::min(n1_hi, (double)n1_max_val);
+
+        for (double n1_d = n1_lo; n1_d <= n1_hi; n1_d++) {
+            const uint32_t n1 = n1_d;
+            if (n1 != 1 && n1 % 2)
+                continue;
+
             /* take the precision of RFREQ into account, using its hardware
              * representation to calculate fdco */
             uint64_t rfreq_val
@@ -55,22 +77,59 @@ bool si57x_parameters::set_freq(double freq)
                 double freq_err = fabs(freq - (fdco / (hs_div_opt * n1)));
                 if (freq_err < freq_err_best) {
                     freq_err_best = freq_err;
-                    n1_best = n1;
-                    hs_div_best = hs_div_opt;
-                    rfreq_best = rfreq_val;
-
-                    best_is_set = true;
+                    /* values to actually write into registers */
+                    best = si57x_registers { rfreq_val, val2hw_n1(n1),
+                        val2hw_hs_div(hs_div_opt) };
                 }
             }
         }
     }
-    if (!best_is_set)
+
+    return best;
+}
+
+std::mutex cache_mutex;
+std::map<std::pair<double, double>, std::optional<si57x_registers>> cache;
+
+std::optional<si57x_registers> cached_solve(double fxtal, double freq)
+{
+    const auto key = std::make_pair(fxtal, freq);
+    if (auto it = cache.find(key); it != cache.end())
+        return it->second;
+
+    if (cache.size() >= max_cached)
+        cache.clear();
+    return cache[key] = solve(fxtal, freq);
+}
+
+}
+
+std::vector<std::optional<si57x_registers>> si57x_solve(
+    double fxtal, std::span<const double> freqs)
+{
+    std::vector<std::optional<si57x_registers>> r;
+    r.reserve(freqs.size());
+
+    std::lock_guard lock(cache_mutex);
+    for (auto freq : freqs)
+        r.push_back(cached_solve(fxtal, freq));
+
+    return r;
+}
+
+bool si57x_parameters::set_freq(double freq)
+{
+    std::optional<si57x_registers> regs;
+    {
+        std::lock_guard lock(cache_mutex);
+        regs = cached_solve(fxtal, freq);
+    }
+    if (!regs)
         return false;
 
-    /* values to actually write into registers */
-    n1 = val2hw_n1(n1_best);
-    hs_div = val2hw_hs_div(hs_div_best);
-    rfreq = rfreq_best;
+    rfreq = regs->rfreq;
+    n1 = regs->n1;
+    hs_div = regs->hs_div;
 
     return true;
 }
@@ -2,6 +2,17 @@
 #define SI57X_UTIL_H
 
 #include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+/** Register values for an output frequency, in their hardware
+ * representation */
+struct si57x_registers {
+    uint64_t rfreq;
+    uint32_t n1;
+    uint32_t hs_div;
+};
 
 struct si57x_parameters {
     /** Nominal fxtal value, can be used when the device can't be reset to
@@ -24,10 +35,17 @@ struct si57x_parameters {
     bool calc_fxtal();
     /** Set #rfreq, #n1 and #hs_div so the device outputs the desired frequency.
      * Assumes #fxtal for the device has already been determined. Returns false
-     * on failure. */
+     * on failure. Uses si57x_solve(), so results are cached. */
     bool set_freq(double);
     /** Get the output frequency, based on #fxtal, #rfreq, #n1 and #hs_div. */
     double get_freq();
 };
 
+/** Find the register values with the smallest frequency error for each
+ * frequency in \p freqs, using \p fxtal, or std::nullopt if a frequency can't
+ * be generated. Results are cached by (fxtal, frequency), so repeated sweeps
+ * only pay for the lookup. Safe to call from multiple threads. */
+std::vector<std::optional<si57x_registers>> si57x_solve(
+    double fxtal, std::span<const double> freqs);
+
 #endif
@@ -0,0 +1,11 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+/* SSE2 is always available on x86_64, so code using it doesn't need any
+ * compiler flags; USE_SSE2 is defined for it along with the intrinsics */
+#if defined(__x86_64__)
+#define USE_SSE2
+#include <immintrin.h>
+#endif
+
+#endif
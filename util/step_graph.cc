@@ -0,0 +1,81 @@
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+
+#include "step_graph.h"
+
+size_t StepGraph::add(
+    std::string name, std::function<bool()> fn, std::vector<size_t> deps)
+{
+    for (auto d : deps)
+        if (d >= steps.size())
+            throw std::out_of_range(
+                "dependencies must be added before the steps using them");
+
+    steps.push_back({ std::move(name), std::move(fn), std::move(deps) });
+    return steps.size() - 1;
+}
+
+size_t StepGraph::size() const { return steps.size(); }
+
+std::vector<StepGraph::step_report> StepGraph::run(
+    std::chrono::steady_clock::time_point epoch) const
+{
+    std::vector<step_report> r;
+    r.reserve(steps.size());
+
+    for (const auto &s : steps) {
+        step_report report { s.name, status::ok, { }, { }, { } };
+        report.start = std::chrono::steady_clock::now() - epoch;
+
+        const bool ready = std::all_of(s.deps.begin(), s.deps.end(),
+            [&r](size_t d) { return r[d].result == status::ok; });
+        if (!ready) {
+            report.result = status::skipped;
+        } else {
+            try {
+                if (!s.fn())
+                    report.result = status::failed;
+            } catch (const std::exception &e) {
+                report.result = status::failed;
+                report.error = e.what();
+            }
+        }
+
+        report.end = std::chrono::steady_clock::now() - epoch;
+        r.push_back(std::move(report));
+    }
+
+    return r;
+}
+
+std::vector<size_t> StepGraph::critical_path(
+    const std::vector<step_report> &reports) const
+{
+    if (reports.size() != steps.size())
+        throw std::logic_error("there must be one report for each step");
+
+    /* steps.size() is used for no step */
+    const size_t none = steps.size();
+    auto latest = [&](size_t cur, size_t i) {
+        if (reports[i].result == status::skipped)
+            return cur;
+        return cur == none || reports[cur].end <= reports[i].end ? i : cur;
+    };
+
+    size_t cur = none;
+    for (size_t i = 0; i < steps.size(); i++)
+        cur = latest(cur, i);
+
+    std::vector<size_t> path;
+    while (cur != none) {
+        path.push_back(cur);
+        const auto &deps = steps[cur].deps;
+        cur = none;
+        for (auto d : deps)
+            cur = latest(cur, d);
+    }
+
+    std::reverse(path.begin(), path.end());
+    return path;
+}
@@ -0,0 +1,61 @@
+#ifndef STEP_GRAPH_H
+#define STEP_GRAPH_H
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+/** Named steps with dependencies between them. Steps are run in the order
+ * they were added, which is always a valid order since dependencies must be
+ * added first, and a step is skipped when any of its dependencies didn't
+ * succeed. Each step is timed, so the chain of dependencies which took the
+ * longest can be found. */
+class StepGraph {
+public:
+    enum class status {
+        ok,
+        /** The step returned false or threw an exception */
+        failed,
+        /** One of the step's dependencies didn't succeed */
+        skipped,
+    };
+
+    struct step_report {
+        std::string name;
+        status result;
+        /** Message from the exception thrown by the step, if any */
+        std::string error;
+        /** Start and end of the step, relative to the epoch given to run() */
+        std::chrono::steady_clock::duration start, end;
+    };
+
+private:
+    struct step {
+        std::string name;
+        std::function<bool()> fn;
+        std::vector<size_t> deps;
+    };
+    std::vector<step> steps;
+
+public:
+    /** Add a step which depends on the steps whose indexes are in \p deps,
+     * returning its own index */
+    size_t add(std::string name, std::function<bool()> fn,
+        std::vector<size_t> deps = { });
+    size_t size() const;
+
+    /** Run all steps, with times measured from \p epoch. This allows runs of
+     * several graphs in different threads to be compared */
+    std::vector<step_report> run(std::chrono::steady_clock::time_point epoch
+        = std::chrono::steady_clock::now()) const;
+
+    /** Indexes of the steps in the chain of dependencies which ended last,
+     * from its first step to its last, obtained by going back from the last
+     * step to finish through the dependency which finished last */
+    std::vector<size_t> critical_path(
+        const std::vector<step_report> &reports) const;
+};
+
+#endif
@@ -0,0 +1,233 @@
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "modules/acq_archive.h"
+
+using namespace acq;
+
+namespace {
+
+struct temp_archive {
+    std::string dir, path;
+
+    temp_archive()
+    {
+        char name[] = "/tmp/acq-archive-test-XXXXXX";
+        dir = mkdtemp(name);
+        path = dir + "/archive";
+    }
+    ~temp_archive()
+    {
+        unlink(path.c_str());
+        unlink((path + ".idx").c_str());
+        rmdir(dir.c_str());
+    }
+};
+
+shot_info make_info(unsigned i)
+{
+    return { i % 4, 32, 4, 16, 10 + i, 20 + i, 0x1000 * i,
+        1000000000 + 1000 * (int64_t)i };
+}
+
+std::vector<int16_t> make_data(unsigned i)
+{
+    std::vector<int16_t> data(40 + 8 * i);
+    for (size_t j = 0; j < data.size(); j++)
+        data[j] = (int16_t)(j * 3 - 50 * i);
+    return data;
+}
+
+void write_shots(const std::string &path, unsigned n)
+{
+    ArchiveWriter w(path);
+    for (unsigned i = 0; i < n; i++) {
+        auto data = make_data(i);
+        w.append(make_info(i), 100 + i, std::span<const int16_t>(data));
+    }
+    CHECK(w.size() == n);
+}
+
+size_t file_size(const std::string &path)
+{
+    struct stat st;
+    REQUIRE(stat(path.c_str(), &st) == 0);
+    return st.st_size;
+}
+
+void overwrite(const std::string &path, off_t offset, const void *p, size_t n)
+{
+    int fd = open(path.c_str(), O_WRONLY);
+    REQUIRE(fd >= 0);
+    CHECK(pwrite(fd, p, n, offset) == (ssize_t)n);
+    close(fd);
+}
+
+}
+
+TEST_CASE("Shots are read back by index", "[acq-archive]")
+{
+    temp_archive t;
+    const unsigned n = 5;
+    write_shots(t.path, n);
+
+    /* a header page, and one page per record */
+    CHECK(file_size(t.path) == 4096 * (n + 1));
+    CHECK(file_size(t.path + ".idx")
+        == sizeof(archive_file_header) + n * sizeof(archive_index_entry));
+
+    ArchiveReader r(t.path);
+    REQUIRE(r.size() == n);
+    for (unsigned i = 0; i < n; i++) {
+        const auto expected = make_info(i);
+        const auto info = r.info(i);
+        CHECK(info.channel == expected.channel);
+        CHECK(info.pre_samples == expected.pre_samples);
+        CHECK(info.post_samples == expected.post_samples);
+        CHECK(info.trigger_pos == expected.trigger_pos);
+        CHECK(info.timestamp_ns == expected.timestamp_ns);
+        CHECK(r.record(i).sequence == 100 + i);
+
+        const auto data = r.data<int16_t>(i);
+        const auto expected_data = make_data(i);
+        CHECK(std::vector<int16_t>(data.begin(), data.end()) == expected_data);
+    }
+
+    CHECK_THROWS_AS(r.record(n), std::out_of_range);
+    CHECK_THROWS_AS(r.data<int32_t>(0), std::runtime_error);
+    CHECK_THROWS_AS(r.data<uint16_t>(0), std::runtime_error);
+}
+
+TEST_CASE("Appending to an existing archive", "[acq-archive]")
+{
+    temp_archive t;
+    write_shots(t.path, 2);
+    {
+        ArchiveWriter w(t.path);
+        CHECK(w.size() == 2);
+        auto data = make_data(2);
+        w.append(make_info(2), 102, std::span<const int16_t>(data));
+    }
+
+    ArchiveReader r(t.path);
+    REQUIRE(r.size() == 3);
+    CHECK(r.record(2).sequence == 102);
+}
+
+TEST_CASE("Truncated records are dropped", "[acq-archive]")
+{
+    temp_archive t;
+    const unsigned n = 4;
+    write_shots(t.path, n);
+
+    /* cut the last record in the middle of its data */
+    REQUIRE(truncate(t.path.c_str(), 4096 * n + 100) == 0);
+    {
+        ArchiveReader r(t.path);
+        CHECK(r.size() == n - 1);
+        const auto data = r.data<int16_t>(n - 2);
+        CHECK(std::vector<int16_t>(data.begin(), data.end())
+            == make_data(n - 2));
+    }
+
+    /* the writer drops it for good, and continues after the last complete
+     * record */
+    {
+        ArchiveWriter w(t.path);
+        CHECK(w.size() == n - 1);
+        auto data = make_data(n);
+        w.append(make_info(n), 100 + n, std::span<const int16_t>(data));
+    }
+    ArchiveReader r(t.path);
+    REQUIRE(r.size() == n);
+    CHECK(r.record(n - 1).sequence == 100 + n);
+    const auto data = r.data<int16_t>(n - 1);
+    CHECK(std::vector<int16_t>(data.begin(), data.end()) == make_data(n));
+}
+
+TEST_CASE("Wrong headers are rejected", "[acq-archive]")
+{
+    SECTION("magic")
+    {
+        temp_archive t;
+        write_shots(t.path, 1);
+        overwrite(t.path, 0, "NOTARC", 6);
+        CHECK_THROWS_AS(ArchiveReader(t.path), std::runtime_error);
+        CHECK_THROWS_AS(ArchiveWriter(t.path), std::runtime_error);
+    }
+
+    SECTION("version")
+    {
+        temp_archive t;
+        write_shots(t.path, 1);
+        const uint32_t version = 2;
+        overwrite(t.path + ".idx", offsetof(archive_file_header, version),
+            &version, sizeof version);
+        CHECK_THROWS_AS(ArchiveReader(t.path), std::runtime_error);
+        CHECK_THROWS_AS(ArchiveWriter(t.path), std::runtime_error);
+    }
+
+    SECTION("record")
+    {
+        temp_archive t;
+        write_shots(t.path, 2);
+        overwrite(t.path, 2 * 4096, "BADREC", 6);
+        ArchiveReader r(t.path);
+        CHECK_NOTHROW(r.record(0));
+        CHECK_THROWS_AS(r.record(1), std::runtime_error);
+    }
+}
+
+TEST_CASE("Other files are left alone", "[acq-archive]")
+{
+    temp_archive t;
+    const std::string contents = "not an archive\n";
+    {
+        int fd = open(t.path.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+        REQUIRE(fd >= 0);
+        close(fd);
+    }
+    overwrite(t.path, 0, contents.data(), contents.size());
+
+    CHECK_THROWS_AS(ArchiveWriter(t.path), std::runtime_error);
+    CHECK(file_size(t.path) == contents.size());
+    std::string read(contents.size(), '\0');
+    int fd = open(t.path.c_str(), O_RDONLY);
+    REQUIRE(fd >= 0);
+    CHECK(pread(fd, read.data(), read.size(), 0) == (ssize_t)read.size());
+    close(fd);
+    CHECK(read == contents);
+
+    /* no index is created for it */
+    CHECK(access((t.path + ".idx").c_str(), F_OK) != 0);
+}
+
+TEST_CASE("Replay yields the shots in order", "[acq-archive]")
+{
+    temp_archive t;
+    const unsigned n = 3;
+    write_shots(t.path, n);
+    ArchiveReader r(t.path);
+
+    /* records are converted to the replay's element type */
+    ArchiveReplay<int32_t> replay(r);
+    for (unsigned i = 0; i < n; i++) {
+        auto res = replay.pop();
+        REQUIRE(res);
+        CHECK(res->sequence == 100 + i);
+        CHECK(res->info.timestamp_ns == make_info(i).timestamp_ns);
+
+        const auto expected = make_data(i);
+        CHECK(res->data
+            == std::vector<int32_t>(expected.begin(), expected.end()));
+    }
+    CHECK_FALSE(replay.pop());
+}
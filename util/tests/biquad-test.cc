@@ -0,0 +1,186 @@
+#include <cmath>
+#include <numbers>
+#include <random>
+#include <vector>
+
+#include <catch2/benchmark/catch_benchmark_all.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include "biquad.h"
+
+namespace {
+
+/* second order Butterworth low pass, with cutoff at \p f times the sampling
+ * frequency */
+std::vector<double> lowpass(double f)
+{
+    const double k = std::tan(std::numbers::pi * f),
+                 q = std::numbers::sqrt2 / 2, norm = 1 / (1 + k / q + k * k),
+                 b0 = k * k * norm;
+    return { b0, 2 * b0, b0, 2 * (k * k - 1) * norm,
+        (1 - k / q + k * k) * norm };
+}
+
+struct signals {
+    std::vector<std::vector<double>> in, out;
+
+    signals(size_t channels, size_t n)
+        : in(channels, std::vector<double>(n))
+        , out(channels, std::vector<double>(n))
+    {
+    }
+
+    void run(BiquadCascade &c)
+    {
+        std::vector<std::span<const double>> i(in.begin(), in.end());
+        std::vector<std::span<double>> o(out.begin(), out.end());
+        c.run(i, o);
+    }
+};
+
+const fixed_point_format coeff_format = { 2, 24 }, signal_format = { 1, 23 };
+
+}
+
+TEST_CASE("Coefficient quantization", "[biquad]")
+{
+    BiquadCascade c({ { 0.3, -0.3, 1.5, 2.5, -3 } }, { 2, 8 }, { 1, 15 });
+    /* truncated by float2fixed() and then by dropping the lower bits */
+    CHECK(c.get_quantized()[0]
+        == std::vector<double> {
+            76 / 256., -77 / 256., 1.5, 2 - 1 / 256., -2 });
+
+    CHECK_THROWS_AS(BiquadCascade({ { 1, 0, 0, 0 } }, { 2, 8 }, { 1, 15 }),
+        std::logic_error);
+    CHECK_THROWS_AS(
+        BiquadCascade({ { 1, 0, 0, 0, 0 }, { } }, { 2, 8 }, { 1, 15 }),
+        std::logic_error);
+    CHECK_THROWS_AS(BiquadCascade({ { 1, 0, 0, 0, 0 } }, { 2, 31 }, { 1, 15 }),
+        std::logic_error);
+}
+
+TEST_CASE("Identity filter", "[biquad]")
+{
+    BiquadCascade c({ { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0 } }, coeff_format,
+        signal_format);
+    CHECK(c.is_exact());
+
+    signals s(1, 1000);
+    std::mt19937 gen(1);
+    std::uniform_real_distribution<double> dist(-1, 1);
+    for (auto &v : s.in[0])
+        v = dist(gen);
+    s.run(c);
+
+    const double lsb = std::ldexp(1., -23);
+    for (size_t i = 0; i < s.in[0].size(); i++)
+        REQUIRE(std::abs(s.out[0][i] - s.in[0][i]) <= lsb / 2);
+
+    auto r = c.get_reports()[0];
+    CHECK(r.max_error <= lsb / 2);
+    CHECK(r.rms_error > 0);
+    CHECK(r.saturations == 0);
+}
+
+TEST_CASE("Channels give the same results", "[biquad]")
+{
+    /* an odd number of channels, so the last one isn't done with SIMD */
+    const size_t channels = 5;
+    auto coeffs = lowpass(0.01);
+    auto second = lowpass(0.2);
+    coeffs.insert(coeffs.end(), second.begin(), second.end());
+    BiquadCascade c(std::vector(channels, coeffs), coeff_format, signal_format);
+
+    signals s(channels, 2000);
+    std::mt19937 gen(2);
+    std::uniform_real_distribution<double> dist(-0.5, 0.5);
+    for (auto &v : s.in[0])
+        v = dist(gen);
+    for (auto &in : s.in)
+        in = s.in[0];
+
+    /* in two parts, to check the state is kept between calls */
+    s.run(c);
+    const auto first_out = s.out;
+    s.run(c);
+
+    auto reports = c.get_reports();
+    for (size_t ch = 1; ch < channels; ch++) {
+        CHECK(s.out[ch] == s.out[0]);
+        CHECK(first_out[ch] == first_out[0]);
+        CHECK(reports[ch].rms_error == reports[0].rms_error);
+        CHECK(reports[ch].max_error == reports[0].max_error);
+    }
+    /* the quantization error is small next to the signal */
+    CHECK(reports[0].max_error < 1e-4);
+}
+
+TEST_CASE("Frequency response", "[biquad]")
+{
+    BiquadCascade c({ lowpass(0.05) }, coeff_format, signal_format);
+
+    const std::vector<double> freqs = { 0, 0.05, 0.25, 0.5 };
+    for (bool quantized : { false, true }) {
+        auto h = c.frequency_response(0, freqs, quantized);
+        CHECK(std::abs(std::abs(h[0]) - 1) < 1e-5);
+        CHECK(std::abs(std::abs(h[1]) - std::numbers::sqrt2 / 2) < 1e-5);
+        CHECK(std::abs(h[3]) < 1e-5);
+    }
+
+    /* the simulated gain of a sine matches the response */
+    const size_t n = 4000;
+    signals s(1, n);
+    for (size_t i = 0; i < n; i++)
+        s.in[0][i] = 0.5 * std::sin(2 * std::numbers::pi * 0.05 * i);
+    s.run(c);
+    /* amplitude over whole periods, after the transient */
+    double re = 0, im = 0;
+    for (size_t i = n / 2; i < n; i++) {
+        re += s.out[0][i] * std::cos(2 * std::numbers::pi * 0.05 * i);
+        im += s.out[0][i] * std::sin(2 * std::numbers::pi * 0.05 * i);
+    }
+    const double amplitude = std::hypot(re, im) * 2 / (n / 2);
+    CHECK(std::abs(amplitude - 0.5 * std::numbers::sqrt2 / 2) < 1e-4);
+
+    CHECK_THROWS_AS(c.frequency_response(1, freqs), std::out_of_range);
+}
+
+TEST_CASE("Saturation", "[biquad]")
+{
+    BiquadCascade c({ { 1.5, 0, 0, 0, 0 } }, coeff_format, signal_format);
+
+    signals s(1, 4);
+    s.in[0] = { 0.5, 0.8, -0.9, 2 };
+    s.run(c);
+    const double max = 1 - std::ldexp(1., -23);
+    CHECK(s.out[0] == std::vector<double> { 0.75, max, -1, max });
+    /* the input is saturated before the output */
+    CHECK(c.get_reports()[0].saturations == 4);
+
+    c.reset();
+    CHECK(c.get_reports()[0].saturations == 0);
+}
+
+TEST_CASE("Benchmark", "[biquad-benchmark]")
+{
+    /* the device's 12 channels with 10 biquads each */
+    std::vector<double> coeffs;
+    for (unsigned i = 0; i < 10; i++) {
+        auto b = lowpass(0.01 + 0.04 * i);
+        coeffs.insert(coeffs.end(), b.begin(), b.end());
+    }
+    BiquadCascade c(std::vector(12, coeffs), coeff_format, signal_format);
+
+    signals s(12, 100000);
+    std::mt19937 gen(3);
+    std::uniform_real_distribution<double> dist(-0.5, 0.5);
+    for (auto &in : s.in)
+        for (auto &v : in)
+            v = dist(gen);
+
+    BENCHMARK("12 channels, 10 biquads - 100k samples")
+    {
+        s.run(c);
+        return s.out[0][0];
+    };
+}
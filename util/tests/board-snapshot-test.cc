@@ -0,0 +1,246 @@
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "decoders.h"
+#include "modules/board_snapshot.h"
+#include "pcie.h"
+#include "test-util.h"
+
+using namespace board_snapshot;
+
+namespace {
+
+/* from the SDB of the cores and their register maps */
+const uint64_t orbit_intlk_addr = 0x1000, trigger_mux_addr = 0x2000,
+               acq_addr = 0x3000;
+const uint32_t intlk_ctrl_en = 0x2d, intlk_ctrl_clr = 0x52;
+const size_t intlk_min_sum = 0x8, intlk_trans_x_diff = 0x2c;
+
+std::vector<struct sdb_device_info> board_devices()
+{
+    return {
+        { .start_addr = orbit_intlk_addr,
+            .vendor_id = LNLS_VENDORID,
+            .device_id = 0x87efeda8,
+            .abi_ver_major = 1 },
+        { .start_addr = trigger_mux_addr,
+            .vendor_id = LNLS_VENDORID,
+            .device_id = 0x84b6a5ac,
+            .abi_ver_major = 1 },
+        { .start_addr = acq_addr,
+            .vendor_id = LNLS_VENDORID,
+            .device_id = 0x4519a0ad,
+            .abi_ver_major = 2 },
+        /* a core without a controller */
+        { .start_addr = 0x4000,
+            .vendor_id = LNLS_VENDORID,
+            .device_id = 0x12345678,
+            .abi_ver_major = 1 },
+    };
+}
+
+struct board {
+    struct pcie_bars bars;
+
+    board()
+    {
+        dummy_dev_open(bars);
+        dummy_sdb(bars, board_devices());
+    }
+
+    void configure()
+    {
+        bar4_write(&bars, orbit_intlk_addr, intlk_ctrl_en | intlk_ctrl_clr);
+        for (size_t off = intlk_min_sum; off < intlk_trans_x_diff; off += 4)
+            bar4_write(&bars, orbit_intlk_addr + off, 1000 + off);
+        for (unsigned i = 0; i < 24; i++)
+            bar4_write(&bars, trigger_mux_addr + i * 8, 0x100 + i);
+    }
+
+    void clear()
+    {
+        for (auto addr : { orbit_intlk_addr, trigger_mux_addr })
+            for (size_t off = 0; off < 0x100; off += 4)
+                bar4_write(&bars, addr + off, 0);
+    }
+
+    uint32_t read(uint64_t addr)
+    {
+        return bar4_read(&bars, addr);
+    }
+};
+
+struct temp_snapshot {
+    std::string path;
+
+    temp_snapshot()
+    {
+        char name[] = "/tmp/board-snapshot-test-XXXXXX";
+        int fd = mkstemp(name);
+        REQUIRE(fd >= 0);
+        close(fd);
+        path = name;
+    }
+    ~temp_snapshot()
+    {
+        unlink(path.c_str());
+    }
+};
+
+void check_same(const std::vector<core_image> &a,
+    const std::vector<core_image> &b)
+{
+    REQUIRE(a.size() == b.size());
+    for (size_t i = 0; i < a.size(); i++) {
+        CHECK(a[i].devinfo.vendor_id == b[i].devinfo.vendor_id);
+        CHECK(a[i].devinfo.device_id == b[i].devinfo.device_id);
+        CHECK(a[i].devinfo.abi_ver_major == b[i].devinfo.abi_ver_major);
+        CHECK(a[i].devinfo.abi_ver_minor == b[i].devinfo.abi_ver_minor);
+        CHECK(a[i].devinfo.start_addr == b[i].devinfo.start_addr);
+        CHECK(a[i].index == b[i].index);
+        REQUIRE(a[i].layout.regions.size() == b[i].layout.regions.size());
+        for (size_t j = 0; j < a[i].layout.regions.size(); j++) {
+            CHECK(a[i].layout.regions[j].offset
+                == b[i].layout.regions[j].offset);
+            CHECK(a[i].layout.regions[j].size == b[i].layout.regions[j].size);
+        }
+        REQUIRE(a[i].layout.volatile_bits.size()
+            == b[i].layout.volatile_bits.size());
+        for (size_t j = 0; j < a[i].layout.volatile_bits.size(); j++) {
+            CHECK(a[i].layout.volatile_bits[j].offset
+                == b[i].layout.volatile_bits[j].offset);
+            CHECK(a[i].layout.volatile_bits[j].mask
+                == b[i].layout.volatile_bits[j].mask);
+        }
+        CHECK(a[i].data == b[i].data);
+    }
+}
+
+}
+
+TEST_CASE("Snapshots are saved, loaded and restored", "[board-snapshot]")
+{
+    board b;
+    b.configure();
+
+    std::vector<skipped_core> skipped;
+    const auto images = take(b.bars, &skipped);
+    REQUIRE(images.size() == 2);
+    CHECK(images[0].devinfo.start_addr == orbit_intlk_addr);
+    CHECK(images[1].devinfo.start_addr == trigger_mux_addr);
+
+    /* the volatile clear bits aren't saved */
+    CHECK(images[0].data[0] == intlk_ctrl_en);
+    CHECK(images[0].data[1] == 1000 + intlk_min_sum);
+    CHECK(images[1].data.size() == 24);
+
+    /* acq has a controller, but its configuration can't be saved */
+    REQUIRE(skipped.size() == 1);
+    CHECK(skipped[0].controller == "acq");
+    CHECK(skipped[0].devinfo.start_addr == acq_addr);
+    CHECK(skipped[0].index == 0);
+
+    temp_snapshot t;
+    save(t.path, images);
+    check_same(load(t.path), images);
+
+    b.clear();
+    const auto report = restore(b.bars, load(t.path));
+    CHECK(report.cores == 2);
+    CHECK(report.words == 10 + 24);
+    CHECK(report.mismatches.empty());
+
+    CHECK(b.read(orbit_intlk_addr) == intlk_ctrl_en);
+    for (size_t off = intlk_min_sum; off < intlk_trans_x_diff; off += 4)
+        CHECK(b.read(orbit_intlk_addr + off) == 1000 + off);
+    /* the read only differences after the thresholds aren't written */
+    CHECK(b.read(orbit_intlk_addr + intlk_trans_x_diff) == 0);
+    for (unsigned i = 0; i < 24; i++) {
+        CHECK(b.read(trigger_mux_addr + i * 8) == 0x100 + i);
+        CHECK(b.read(trigger_mux_addr + i * 8 + 4) == 0);
+    }
+}
+
+TEST_CASE("Restoring into a different board is rejected", "[board-snapshot]")
+{
+    board b;
+    b.configure();
+    const auto images = take(b.bars);
+
+    auto devices = board_devices();
+    SECTION("ABI version")
+    {
+        devices[1].abi_ver_minor = 1;
+    }
+    SECTION("missing core")
+    {
+        devices.erase(devices.begin());
+    }
+    b.clear();
+    dummy_sdb(b.bars, devices);
+
+    /* nothing is written, not even the cores which are still the same */
+    CHECK_THROWS_AS(restore(b.bars, images), std::runtime_error);
+    CHECK(b.read(orbit_intlk_addr) == 0);
+    CHECK(b.read(orbit_intlk_addr + intlk_min_sum) == 0);
+    CHECK(b.read(trigger_mux_addr) == 0);
+}
+
+TEST_CASE("Broken snapshot files are rejected", "[board-snapshot]")
+{
+    board b;
+    b.configure();
+    const auto images = take(b.bars);
+    temp_snapshot t;
+    save(t.path, images);
+
+    struct stat st;
+    REQUIRE(stat(t.path.c_str(), &st) == 0);
+    const off_t size = st.st_size;
+
+    SECTION("truncated")
+    {
+        /* inside the header, a core, its regions and its data */
+        const off_t header = sizeof(snapshot_file_header),
+                    core = sizeof(snapshot_file_core),
+                    entry = sizeof(snapshot_file_entry);
+        for (off_t len : { (off_t)0, header - 1, header + core / 2,
+                 header + core + entry + 4, size - 4 }) {
+            save(t.path, images);
+            REQUIRE(truncate(t.path.c_str(), len) == 0);
+            CHECK_THROWS_AS(load(t.path), std::runtime_error);
+        }
+    }
+
+    SECTION("magic")
+    {
+        int fd = open(t.path.c_str(), O_WRONLY);
+        REQUIRE(fd >= 0);
+        CHECK(pwrite(fd, "NOTSNAP", 8, 0) == 8);
+        close(fd);
+        CHECK_THROWS_AS(load(t.path), std::runtime_error);
+    }
+
+    SECTION("version")
+    {
+        const uint32_t version = 2;
+        int fd = open(t.path.c_str(), O_WRONLY);
+        REQUIRE(fd >= 0);
+        CHECK(pwrite(fd, &version, sizeof version,
+                  offsetof(snapshot_file_header, version))
+            == sizeof version);
+        close(fd);
+        CHECK_THROWS_AS(load(t.path), std::runtime_error);
+    }
+
+    CHECK_THROWS_AS(load(t.path + ".missing"), std::runtime_error);
+}
@@ -61,5 +61,20 @@ int main()
         compare(off, 0, bars.sizes[1] * 2 + 128);
     }
 
+    /* the callback version must deliver the same data, in order */
+    struct cb_state {
+        unsigned char *p;
+    };
+    auto cb = [](void *arg, const void *src, size_t n) {
+        auto st = static_cast<cb_state *>(arg);
+        memcpy(st->p, src, n);
+        st->p += n;
+    };
+    for (auto off : offs) {
+        cb_state st { static_cast<unsigned char *>(dest) };
+        bar2_read_cb(&bars, off, bars.sizes[1] * 2 + 128, cb, &st);
+        compare(off, 0, bars.sizes[1] * 2 + 128);
+    }
+
     free(dest);
 }
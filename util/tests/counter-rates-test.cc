@@ -0,0 +1,142 @@
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <catch2/benchmark/catch_benchmark_all.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include "counter_rates.h"
+
+using namespace std::chrono_literals;
+
+namespace {
+
+/* reads at \p poll_period of a counter incremented at multiples of
+ * \p pulse_period, starting at \p phase, except for pulses in \p missing */
+struct pulse_train {
+    std::chrono::nanoseconds pulse_period, phase;
+    std::vector<uint64_t> missing = { };
+
+    uint32_t count(std::chrono::nanoseconds t) const
+    {
+        if (t < phase)
+            return 0;
+        uint64_t n = (t - phase) / pulse_period + 1;
+        for (auto m : missing)
+            if ((t - phase) / pulse_period >= (int64_t)m)
+                n--;
+        return n;
+    }
+};
+
+/* \p jitter delays each read by up to that much, as scheduling does */
+void run(CounterRates &r, const std::vector<pulse_train> &trains,
+    std::chrono::nanoseconds poll_period, size_t polls,
+    std::chrono::nanoseconds jitter = { })
+{
+    const std::chrono::steady_clock::time_point start { };
+    std::mt19937 gen(1);
+    std::uniform_int_distribution<int64_t> dist(0, jitter.count());
+    std::vector<uint32_t> counts(trains.size());
+    for (size_t i = 0; i < polls; i++) {
+        const auto t = poll_period * i + std::chrono::nanoseconds(dist(gen));
+        for (size_t j = 0; j < trains.size(); j++)
+            counts[j] = trains[j].count(t);
+        r.update(start + t, counts);
+    }
+}
+
+}
+
+TEST_CASE("Rates and time series", "[counter-rates]")
+{
+    CounterRates r(2, 32, 8);
+    /* 1 kHz and 30 Hz, read at 100 Hz */
+    run(r, { { 1ms, 0ms }, { 33333333ns, 5ms } }, 10ms, 101);
+
+    const auto &status = r.get_status();
+    CHECK(status[0].total == 1000);
+    CHECK(status[0].rate == 1000);
+    /* over the last 80ms */
+    CHECK(status[1].rate > 2 / 0.08 - 1);
+    CHECK(status[1].rate < 3 / 0.08 + 1);
+
+    const auto times = r.get_times();
+    REQUIRE(times.size() == 8);
+    CHECK(times.front().time_since_epoch() == 930ms);
+    CHECK(times.back().time_since_epoch() == 1000ms);
+    CHECK(r.get_deltas(0) == std::vector<uint16_t>(8, 10));
+    CHECK_THROWS_AS(r.get_deltas(2), std::out_of_range);
+}
+
+TEST_CASE("Counters wrap around", "[counter-rates]")
+{
+    CounterRates r(1, 16, 4);
+    const std::chrono::steady_clock::time_point start { };
+    const uint32_t counts[] = { 0xfff0, 0x0010, 0x0030 };
+    for (unsigned i = 0; i < 3; i++)
+        r.update(start + i * 1s, std::span(counts + i, 1));
+    CHECK(r.get_status()[0].total == 0x40);
+    CHECK(r.get_deltas(0) == std::vector<uint16_t> { 0x20, 0x20 });
+
+    const uint32_t wrong_size[2] = { };
+    CHECK_THROWS_AS(r.update(start, wrong_size), std::logic_error);
+    CHECK_THROWS_AS(CounterRates(1, 33), std::logic_error);
+}
+
+TEST_CASE("Missed pulses", "[counter-rates]")
+{
+    /* slow and fast triggers, with every phase relative to the reads */
+    for (auto phase : { 0ms, 3ms, 7ms, 9ms }) {
+        CounterRates r(4, 32);
+        for (unsigned i = 0; i < 4; i++)
+            r.set_expected_rate(i, i < 2 ? 30 : 2000);
+        run(r,
+            {
+                { 33333333ns, phase },
+                { 33333333ns, phase, { 5, 6, 20 } },
+                { 500us, phase / 10 },
+                { 500us, phase / 10, { 1000, 1001, 1500 } },
+            },
+            10ms, 200, 1ms);
+
+        const auto &status = r.get_status();
+        CHECK(status[0].missed == 0);
+        CHECK(status[1].missed == 3);
+        CHECK(status[2].missed == 0);
+        CHECK(status[3].missed == 3);
+        for (const auto &s : status)
+            CHECK(s.synced);
+    }
+
+    /* a counter which never counts isn't synchronized */
+    CounterRates r(1, 32);
+    r.set_expected_rate(0, 10);
+    run(r, { { 1h, 1h } }, 10ms, 100);
+    CHECK(!r.get_status()[0].synced);
+    CHECK(r.get_status()[0].missed == 0);
+    CHECK_THROWS_AS(r.set_expected_rate(1, 10), std::out_of_range);
+}
+
+TEST_CASE("Benchmark", "[counter-rates-benchmark]")
+{
+    /* afc_timing and trigger_iface counters, all with expected rates */
+    CounterRates timing(18, 32), iface(48, 16);
+    for (size_t i = 0; i < timing.size(); i++)
+        timing.set_expected_rate(i, 1000);
+    for (size_t i = 0; i < iface.size(); i++)
+        iface.set_expected_rate(i, 1000);
+
+    std::vector<uint32_t> counts(48);
+    auto t = std::chrono::steady_clock::now();
+    BENCHMARK("afc_timing and trigger_iface update")
+    {
+        t += 10ms;
+        for (auto &c : counts)
+            c += 10;
+        timing.update(t, std::span(counts).first(18));
+        iface.update(t, counts);
+        return timing.get_status()[0].total;
+    };
+}
@@ -0,0 +1,102 @@
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <catch2/benchmark/catch_benchmark_all.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include "csv.h"
+
+namespace {
+
+/* the per-value stdio implementation write_csv() replaced */
+template <typename T>
+void reference_csv(FILE *f, const std::vector<T> &data, unsigned num_columns)
+{
+    for (size_t i = 0; i < data.size() / num_columns; i++) {
+        for (unsigned j = 0; j < num_columns; j++) {
+            char tmp[32];
+            auto r = std::to_chars(
+                tmp, tmp + sizeof tmp, data[i * num_columns + j]);
+            *r.ptr = '\0';
+            fputs(tmp, f);
+            fputc(',', f);
+        }
+        fputc('\n', f);
+    }
+}
+
+std::string file_contents(FILE *f)
+{
+    std::string s;
+    rewind(f);
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof buf, f)))
+        s.append(buf, n);
+    return s;
+}
+
+template <typename T> std::vector<T> make_data(size_t size)
+{
+    std::vector<T> data(size);
+    for (size_t i = 0; i < size; i++)
+        data[i] = (T)(i * 2654435761U);
+    return data;
+}
+
+template <typename T> void check_csv(unsigned num_columns, unsigned threads)
+{
+    /* enough lines for more than one block per thread */
+    auto data = make_data<T>(300001 * num_columns);
+
+    FILE *ref = tmpfile(), *out = tmpfile();
+    reference_csv(ref, data, num_columns);
+    write_csv(out, data.data(), data.size(), num_columns, threads);
+    fflush(out);
+
+    CHECK(file_contents(ref) == file_contents(out));
+
+    fclose(ref);
+    fclose(out);
+}
+
+}
+
+TEST_CASE("Same output as stdio", "[csv]")
+{
+    for (unsigned threads : { 1, 4 }) {
+        check_csv<int8_t>(4, threads);
+        check_csv<uint8_t>(2, threads);
+        check_csv<int16_t>(4, threads);
+        check_csv<uint16_t>(1, threads);
+        check_csv<int32_t>(8, threads);
+        check_csv<uint32_t>(3, threads);
+    }
+}
+
+TEST_CASE("Benchmark", "[csv-benchmark]")
+{
+    auto data = make_data<int32_t>(1 << 20);
+    FILE *f = fopen("/dev/null", "w");
+
+    BENCHMARK("stdio - 4 int32 columns")
+    {
+        reference_csv(f, data, 4);
+        return fflush(f);
+    };
+    BENCHMARK("write_csv - 4 int32 columns")
+    {
+        write_csv(f, data.data(), data.size(), 4);
+        return fflush(f);
+    };
+    BENCHMARK("write_csv - 4 int32 columns, 4 threads")
+    {
+        write_csv(f, data.data(), data.size(), 4, 4);
+        return fflush(f);
+    };
+
+    fclose(f);
+}
@@ -0,0 +1,135 @@
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <catch2/benchmark/catch_benchmark_all.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include "deinterleave.h"
+
+namespace {
+
+template <class T, class Out>
+void check_deinterleave(
+    unsigned num_atoms, size_t samples, size_t chunk, bool scaled)
+{
+    std::mt19937 gen(num_atoms * samples + chunk);
+    std::vector<T> src(samples * num_atoms);
+    for (auto &v : src)
+        v = (T)gen();
+
+    std::vector<double> scale;
+    if (scaled)
+        for (unsigned k = 0; k < num_atoms; k++)
+            scale.push_back(0.5 + k);
+
+    std::vector<std::vector<Out>> res(num_atoms, std::vector<Out>(samples));
+    std::vector<Out *> dest;
+    for (auto &v : res)
+        dest.push_back(v.data());
+
+    Deinterleaver<T, Out> d(dest, scale);
+    const unsigned char *p = (const unsigned char *)src.data();
+    const size_t bytes = src.size() * sizeof(T);
+    for (size_t i = 0; i < bytes; i += chunk)
+        d.push(p + i, std::min(chunk, bytes - i));
+    CHECK(d.samples() == samples);
+
+    size_t mismatches = 0;
+    for (size_t i = 0; i < samples; i++) {
+        for (unsigned k = 0; k < num_atoms; k++) {
+            const T v = src[i * num_atoms + k];
+            Out expected;
+            if constexpr (std::is_floating_point_v<Out>)
+                expected = v * (Out)(scaled ? scale[k] : 1);
+            else
+                expected = static_cast<Out>(v);
+            if (res[k][i] != expected)
+                mismatches++;
+        }
+    }
+    CHECK(mismatches == 0);
+}
+
+template <class Out, class... T>
+void check_types(unsigned num_atoms, size_t chunk, bool scaled)
+{
+    /* odd amount of samples, so the vector loops always leave a remainder */
+    (check_deinterleave<T, Out>(num_atoms, 1001, chunk, scaled), ...);
+}
+
+}
+
+TEST_CASE("De-interleave without conversion", "[deinterleave]")
+{
+    for (unsigned num_atoms : { 1, 2, 3, 4, 8 }) {
+        for (size_t chunk : { 1 << 20, 4096, 4, 7 }) {
+            check_types<int8_t, int8_t>(num_atoms, chunk, false);
+            check_types<uint8_t, uint8_t>(num_atoms, chunk, false);
+            check_types<int16_t, int16_t>(num_atoms, chunk, false);
+            check_types<uint16_t, uint16_t>(num_atoms, chunk, false);
+            check_types<int32_t, int32_t>(num_atoms, chunk, false);
+            check_types<uint32_t, uint32_t>(num_atoms, chunk, false);
+        }
+    }
+}
+
+TEST_CASE("De-interleave with conversion", "[deinterleave]")
+{
+    for (unsigned num_atoms : { 1, 2, 4, 8 }) {
+        for (size_t chunk : { 1 << 20, 12 }) {
+            for (bool scaled : { false, true }) {
+                check_types<float, int8_t, uint8_t, int16_t, uint16_t,
+                    int32_t, uint32_t>(num_atoms, chunk, scaled);
+                check_types<double, int8_t, uint8_t, int16_t, uint16_t,
+                    int32_t, uint32_t>(num_atoms, chunk, scaled);
+            }
+            check_types<int32_t, int8_t, uint8_t, int16_t, uint16_t,
+                uint32_t>(num_atoms, chunk, false);
+            check_types<int16_t, int8_t, uint8_t>(num_atoms, chunk, false);
+        }
+    }
+}
+
+TEST_CASE("Invalid scale", "[deinterleave]")
+{
+    std::vector<int32_t> a(1), b(1);
+    std::vector<float> c(1), d(1);
+    CHECK_THROWS_AS((Deinterleaver<int16_t, int32_t>(
+                        { a.data(), b.data() }, { 1., 2. })),
+        std::logic_error);
+    CHECK_THROWS_AS(
+        (Deinterleaver<int16_t, float>({ c.data(), d.data() }, { 1. })),
+        std::logic_error);
+}
+
+TEST_CASE("Benchmark", "[deinterleave-benchmark]")
+{
+    const size_t samples = 1 << 16;
+    std::vector<int16_t> src(samples * 4);
+    std::vector<int16_t> out16(samples * 4);
+    std::vector<float> outf(samples * 4);
+
+    auto run = [&src, samples](auto &out, std::vector<double> scale) {
+        using Out = std::remove_reference_t<decltype(out[0])>;
+        Deinterleaver<int16_t, Out> d(
+            { &out[0], &out[samples], &out[2 * samples], &out[3 * samples] },
+            scale);
+        d.push(src.data(), src.size() * sizeof src[0]);
+        return d.samples();
+    };
+
+    BENCHMARK("Strided copy - 4 int16 atoms")
+    {
+        for (size_t i = 0; i < samples; i++)
+            for (size_t k = 0; k < 4; k++)
+                out16[k * samples + i] = src[i * 4 + k];
+        return out16[0];
+    };
+    BENCHMARK("De-interleave - 4 int16 atoms") { return run(out16, { }); };
+    BENCHMARK("De-interleave - 4 int16 atoms to float")
+    {
+        return run(outf, { 1., 2., 3., 4. });
+    };
+}
@@ -1,5 +1,10 @@
+#include <cstdint>
+#include <random>
+#include <span>
 #include <tuple>
+#include <vector>
 
+#include <catch2/benchmark/catch_benchmark_all.hpp>
 #include <catch2/catch_test_macros.hpp>
 
 #include "util.h"
@@ -44,3 +49,97 @@ TEST_CASE("Exception with saturation disabled", "[fixed]")
         }
     }
 }
+
+namespace {
+
+std::vector<double> random_values(size_t n, unsigned point_pos)
+{
+    /* include values beyond the representable range on both sides */
+    const double limit = 2. * ((uint64_t)1 << (31 - point_pos));
+    std::mt19937 gen(n + point_pos);
+    std::uniform_real_distribution<double> dist(-limit, limit);
+
+    std::vector<double> v(n);
+    for (auto &e : v)
+        e = dist(gen);
+    return v;
+}
+
+}
+
+TEST_CASE("Batch conversions match scalar conversions", "[fixed]")
+{
+    for (unsigned point_pos : { 0, 1, 17, 28, 31 }) {
+        /* odd size, so the vector loops leave a remainder */
+        auto in = random_values(1003, point_pos);
+        in[0] = 0;
+        in[1] = -0.;
+        in[2] = fixed2float(0x7fffffff, point_pos);
+        in[3] = fixed2float(0x80000000, point_pos);
+        in[4] = -in[3];
+
+        std::vector<uint32_t> fixed(in.size());
+        float2fixed(in, fixed, point_pos);
+
+        std::vector<double> back(in.size());
+        fixed2float(fixed, back, point_pos);
+
+        size_t mismatches = 0;
+        for (size_t i = 0; i < in.size(); i++) {
+            if (fixed[i] != float2fixed(in[i], point_pos))
+                mismatches++;
+            if (back[i] != fixed2float(fixed[i], point_pos))
+                mismatches++;
+        }
+        CHECK(mismatches == 0);
+    }
+}
+
+TEST_CASE("Batch exception with saturation disabled", "[fixed]")
+{
+    const unsigned point_pos = 31;
+    std::vector<uint32_t> out(6);
+
+    std::vector<double> in { .5, -1, 1, .25, -.5, 0 };
+    CHECK_NOTHROW(float2fixed(in, out, point_pos, false));
+    CHECK(out[2] == 0x7fffffff);
+
+    in[5] = 1.1;
+    CHECK_THROWS_AS(float2fixed(in, out, point_pos, false), std::runtime_error);
+    in[5] = -1.005;
+    CHECK_THROWS_AS(float2fixed(in, out, point_pos, false), std::runtime_error);
+
+    CHECK_THROWS_AS(float2fixed(in, std::span(out).first(5), point_pos),
+        std::logic_error);
+}
+
+TEST_CASE("Benchmark", "[fixed-benchmark]")
+{
+    const unsigned point_pos = 28;
+    auto in = random_values(1 << 20, point_pos);
+    std::vector<uint32_t> fixed(in.size());
+    std::vector<double> back(in.size());
+
+    BENCHMARK("Scalar float2fixed - 1M values")
+    {
+        for (size_t i = 0; i < in.size(); i++)
+            fixed[i] = float2fixed(in[i], point_pos);
+        return fixed[0];
+    };
+    BENCHMARK("Batch float2fixed - 1M values")
+    {
+        float2fixed(in, fixed, point_pos);
+        return fixed[0];
+    };
+    BENCHMARK("Scalar fixed2float - 1M values")
+    {
+        for (size_t i = 0; i < in.size(); i++)
+            back[i] = fixed2float(fixed[i], point_pos);
+        return back[0];
+    };
+    BENCHMARK("Batch fixed2float - 1M values")
+    {
+        fixed2float(fixed, back, point_pos);
+        return back[0];
+    };
+}
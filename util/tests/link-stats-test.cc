@@ -0,0 +1,144 @@
+#include <chrono>
+#include <cstdint>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "modules/fofb_cc.h"
+
+using namespace fofb_cc;
+using namespace std::chrono_literals;
+
+namespace {
+
+/* all links up, receiving and sending 1000 packets per second without
+ * errors, sampled every 100 ms */
+struct traffic {
+    link_sample s { };
+
+    traffic(uint32_t start = 0)
+    {
+        s.link_up = (1U << num_links) - 1;
+        for (auto &counter : s.counters)
+            counter.fill(start);
+        for (auto c : { hard_err, soft_err, frame_err })
+            s.counters[c].fill(0);
+    }
+
+    const link_sample &next()
+    {
+        s.timestamp += 100ms;
+        for (auto c : { rx_pck, tx_pck })
+            for (auto &v : s.counters[c])
+                v += 100;
+        return s;
+    }
+};
+
+}
+
+TEST_CASE("Steady traffic", "[link-stats]")
+{
+    LinkStats stats(8);
+    traffic t;
+
+    /* the first sample has no rates */
+    auto r = stats.add(t.next());
+    CHECK(r[0].up);
+    CHECK(r[0].rates[rx_pck] == 0);
+    CHECK(r[0].anomalies == 0);
+
+    for (unsigned i = 0; i < 20; i++) {
+        r = stats.add(t.next());
+        for (const auto &l : r) {
+            CHECK(l.up);
+            CHECK(l.deltas[rx_pck] == 100);
+            CHECK(l.rates[rx_pck] == 1000);
+            CHECK(l.rates[tx_pck] == 1000);
+            CHECK(l.anomalies == 0);
+        }
+    }
+
+    CHECK(stats.size() == 8);
+    CHECK(stats.sample(0).counters[rx_pck][0] == 2100);
+    CHECK(stats.sample(7).counters[rx_pck][0] == 1400);
+    CHECK_THROWS_AS(stats.sample(8), std::out_of_range);
+    CHECK_THROWS_AS(LinkStats(1), std::logic_error);
+}
+
+TEST_CASE("Counters wrap around and are cleared", "[link-stats]")
+{
+    LinkStats stats;
+    traffic t(UINT32_MAX - 149);
+    stats.add(t.next());
+
+    /* wraps around */
+    auto r = stats.add(t.next());
+    CHECK(t.s.counters[rx_pck][0] == 50);
+    CHECK(r[0].deltas[rx_pck] == 100);
+    CHECK(r[0].anomalies == 0);
+
+    /* cleared, and counted 30 packets since then */
+    t.next();
+    t.s.counters[rx_pck][1] = 30;
+    r = stats.add(t.s);
+    CHECK(r[0].deltas[rx_pck] == 100);
+    CHECK(r[1].deltas[rx_pck] == 30);
+
+    r = stats.add(t.next());
+    CHECK(r[1].deltas[rx_pck] == 100);
+}
+
+TEST_CASE("Anomalies", "[link-stats]")
+{
+    LinkStats stats;
+    stats.limits.max_error_rate = 15;
+    traffic t;
+    for (unsigned i = 0; i < 5; i++)
+        stats.add(t.next());
+
+    SECTION("link lost")
+    {
+        t.s.link_up &= ~(1U << 2);
+        auto r = stats.add(t.next());
+        CHECK_FALSE(r[2].up);
+        CHECK(r[2].anomalies == link_lost);
+        CHECK(r[1].anomalies == 0);
+
+        /* only flagged when it goes down */
+        r = stats.add(t.next());
+        CHECK(r[2].anomalies == 0);
+    }
+
+    SECTION("error rate")
+    {
+        /* 10 errors per second is below the limit, 20 is above it */
+        t.s.counters[soft_err][3] += 1;
+        auto r = stats.add(t.next());
+        CHECK(r[3].anomalies == 0);
+
+        t.s.counters[hard_err][3] += 1;
+        t.s.counters[frame_err][3] += 1;
+        r = stats.add(t.next());
+        CHECK(r[3].rates[hard_err] == 10);
+        CHECK(r[3].anomalies == error_rate);
+        CHECK(r[4].anomalies == 0);
+    }
+
+    SECTION("packet rate drop")
+    {
+        /* a link receiving 40 packets instead of 100 is below half the
+         * average */
+        t.next();
+        t.s.counters[rx_pck][5] -= 60;
+        auto r = stats.add(t.s);
+        CHECK(r[5].deltas[rx_pck] == 40);
+        CHECK(r[5].anomalies == packet_rate_drop);
+        CHECK(r[6].anomalies == 0);
+
+        /* 70 packets is still above it */
+        t.next();
+        t.s.counters[rx_pck][5] -= 30;
+        r = stats.add(t.s);
+        CHECK(r[5].anomalies == 0);
+    }
+}
@@ -0,0 +1,83 @@
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "matrix_file.h"
+
+namespace {
+
+struct temp_path {
+    std::string path;
+
+    temp_path()
+    {
+        char name[] = "/tmp/matrix-file-test-XXXXXX";
+        int fd = mkstemp(name);
+        close(fd);
+        path = name;
+    }
+    ~temp_path() { unlink(path.c_str()); }
+};
+
+}
+
+TEST_CASE("Doubles", "[matrix-file]")
+{
+    temp_path t;
+    std::vector<double> data(3 * 5);
+    for (size_t i = 0; i < data.size(); i++)
+        data[i] = i * 0.5 - 3;
+    MatrixFile::write(t.path, 3, 5, data);
+
+    MatrixFile m(t.path);
+    CHECK(m.rows() == 3);
+    CHECK(m.cols() == 5);
+    CHECK_FALSE(m.is_fixed_point());
+    for (size_t i = 0; i < 3; i++) {
+        auto row = m.row(i);
+        REQUIRE(row.size() == 5);
+        for (size_t j = 0; j < 5; j++)
+            CHECK(row[j] == data[i * 5 + j]);
+    }
+
+    CHECK_THROWS_AS(m.row(3), std::out_of_range);
+    CHECK_THROWS_AS(m.row_fixed(0), std::logic_error);
+}
+
+TEST_CASE("Fixed point values", "[matrix-file]")
+{
+    temp_path t;
+    std::vector<uint32_t> data { 1, 2, 3, 0x80000000, 0x7fffffff, 6 };
+    MatrixFile::write(t.path, 2, 3, data, 17);
+
+    MatrixFile m(t.path);
+    CHECK(m.is_fixed_point());
+    CHECK(m.fixed_point_pos() == 17);
+    CHECK(m.row_fixed(1)[0] == 0x80000000);
+    CHECK_THROWS_AS(m.row(0), std::logic_error);
+}
+
+TEST_CASE("Invalid files", "[matrix-file]")
+{
+    temp_path t;
+
+    CHECK_THROWS_AS(
+        MatrixFile::write(t.path, 2, 3, std::vector<double>(5)),
+        std::logic_error);
+
+    FILE *f = fopen(t.path.c_str(), "w");
+    fputs("not a matrix file, but long enough for a header", f);
+    fclose(f);
+    CHECK_THROWS_AS(MatrixFile(t.path), std::runtime_error);
+
+    MatrixFile::write(t.path, 4, 4, std::vector<double>(16));
+    REQUIRE(truncate(t.path.c_str(), 32 + 15 * sizeof(double)) == 0);
+    CHECK_THROWS_AS(MatrixFile(t.path), std::runtime_error);
+
+    CHECK_THROWS_AS(MatrixFile("/nonexistent"), std::runtime_error);
+}
@@ -0,0 +1,122 @@
+#include <chrono>
+#include <cstdint>
+
+#include <unistd.h>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "modules/orbit_intlk.h"
+#include "pcie.h"
+#include "test-util.h"
+
+using namespace orbit_intlk;
+using namespace std::chrono_literals;
+
+namespace {
+
+const struct sdb_device_info devinfo = { .start_addr = 0x100,
+    .vendor_id = LNLS_VENDORID,
+    .device_id = 0x87efeda8,
+    .abi_ver_major = 1 };
+
+/* from the register map */
+const size_t sts_addr = 0x100 + 0x4, trans_x_diff_addr = 0x100 + 0x2c;
+const uint32_t trans_bigger_x = 1U << 0, intlk = 1U << 14,
+               intlk_ltc = 1U << 15;
+
+uint64_t read_eventfd(int fd)
+{
+    uint64_t count = 0;
+    if (read(fd, &count, sizeof count) != sizeof count)
+        return 0;
+    return count;
+}
+
+}
+
+TEST_CASE("Watcher reports each change of STS", "[orbit-intlk]")
+{
+    struct pcie_bars bars;
+    dummy_dev_open(bars);
+    Core dec(bars), snapshot_dec(bars);
+    dec.set_devinfo(devinfo);
+    snapshot_dec.set_devinfo(devinfo);
+
+    Watcher w(dec, 100us, 3);
+    w.add_snapshot("intlk", snapshot_dec);
+    const int fd = w.subscribe();
+    w.start();
+
+    /* STS stays at 0, which isn't a change */
+    const auto start = std::chrono::steady_clock::now();
+    CHECK(w.wait_events(0, 20ms).empty());
+    CHECK(std::chrono::steady_clock::now() - start >= 20ms);
+    CHECK(read_eventfd(fd) == 0);
+
+    bar4_write(&bars, trans_x_diff_addr, (uint32_t)-5);
+    bar4_write(&bars, sts_addr, trans_bigger_x);
+    auto events = w.wait_events(0, 5s);
+    REQUIRE(events.size() == 1);
+    CHECK(events[0].sequence == 1);
+    CHECK(events[0].previous == 0);
+    CHECK(events[0].current == trans_bigger_x);
+    CHECK(events[0].pos_x == -5);
+    CHECK_FALSE(events[0].trip);
+    CHECK(events[0].snapshots.empty());
+
+    bar4_write(&bars, sts_addr, trans_bigger_x | intlk);
+    events = w.wait_events(1, 5s);
+    REQUIRE(events.size() == 1);
+    CHECK(events[0].sequence == 2);
+    CHECK(events[0].set_bits() == intlk);
+    CHECK(events[0].trip);
+    REQUIRE(events[0].snapshots.size() == 1);
+    CHECK(events[0].snapshots[0].name == "intlk");
+    CHECK_FALSE(events[0].snapshots[0].text.empty());
+    CHECK(read_eventfd(fd) == 2);
+
+    /* clearing isn't a trip */
+    bar4_write(&bars, sts_addr, 0);
+    events = w.wait_events(2, 5s);
+    REQUIRE(events.size() == 1);
+    CHECK(events[0].cleared_bits() == (trans_bigger_x | intlk));
+    CHECK_FALSE(events[0].trip);
+
+    bar4_write(&bars, sts_addr, intlk_ltc);
+    events = w.wait_events(3, 5s);
+    REQUIRE(events.size() == 1);
+    CHECK(events[0].trip);
+    w.stop();
+
+    /* only the last 3 events are kept */
+    events = w.get_events();
+    REQUIRE(events.size() == 3);
+    CHECK(events[0].sequence == 2);
+    CHECK(events[2].sequence == 4);
+    CHECK(w.get_events(3).size() == 1);
+    CHECK(read_eventfd(fd) == 2);
+
+    const auto stats = w.get_stats();
+    CHECK(stats.events == 4);
+    CHECK(stats.polls >= 4);
+
+    w.unsubscribe(fd);
+    CHECK_THROWS_AS(w.unsubscribe(fd), std::logic_error);
+}
+
+TEST_CASE("Watcher arguments are checked", "[orbit-intlk]")
+{
+    struct pcie_bars bars;
+    dummy_dev_open(bars);
+    Core dec(bars);
+    CHECK_THROWS_AS(Watcher(dec), std::logic_error);
+
+    dec.set_devinfo(devinfo);
+    CHECK_THROWS_AS(Watcher(dec, 0us), std::logic_error);
+    CHECK_THROWS_AS(Watcher(dec, 100us, 0), std::logic_error);
+
+    Watcher w(dec);
+    w.start();
+    CHECK_THROWS_AS(w.start(), std::logic_error);
+    CHECK_THROWS_AS(w.add_snapshot("intlk", dec), std::logic_error);
+}
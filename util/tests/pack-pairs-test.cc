@@ -0,0 +1,44 @@
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "util.h"
+
+TEST_CASE("Pack pairs", "[pack-pairs]")
+{
+    const std::vector<int16_t> low = { 0, -1, 1, INT16_MIN, INT16_MAX },
+                               high = { -1, 0, 2, INT16_MAX, INT16_MIN };
+    std::vector<uint32_t> out(low.size());
+    pack_pairs(low, high, out);
+    CHECK(out
+        == std::vector<uint32_t> {
+            0xffff0000, 0x0000ffff, 0x00020001, 0x7fff8000, 0x80007fff });
+}
+
+TEST_CASE("Same results as clear_and_insert", "[pack-pairs]")
+{
+    /* odd size, so the vector loop leaves a remainder */
+    const size_t n = 517;
+    std::mt19937 gen(n);
+    std::uniform_int_distribution<int> dist(INT16_MIN, INT16_MAX);
+
+    std::vector<int16_t> low(n), high(n);
+    for (size_t i = 0; i < n; i++) {
+        low[i] = dist(gen);
+        high[i] = dist(gen);
+    }
+
+    std::vector<uint32_t> out(n);
+    pack_pairs(low, high, out);
+    for (size_t i = 0; i < n; i++) {
+        uint32_t expected = 0;
+        clear_and_insert(expected, (uint16_t)low[i], 0xffff);
+        clear_and_insert(expected, (uint16_t)high[i], 0xffff0000);
+        REQUIRE(out[i] == expected);
+    }
+
+    CHECK_THROWS_AS(pack_pairs(low, high, std::span(out).first(n - 1)),
+        std::logic_error);
+}
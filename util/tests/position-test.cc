@@ -0,0 +1,149 @@
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include <catch2/benchmark/catch_benchmark_all.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include "position.h"
+
+namespace {
+
+struct samples {
+    std::vector<float> in[4], out[4];
+
+    samples(size_t n)
+    {
+        std::mt19937 gen(n);
+        std::uniform_real_distribution<float> dist(1e3, 1e6);
+        for (auto &v : in) {
+            v.resize(n);
+            for (auto &a : v)
+                a = dist(gen);
+        }
+        for (auto &v : out)
+            v.resize(n);
+    }
+
+    void compute(const position_params &p, position_method method)
+    {
+        compute_positions(p, method,
+            { in[0].data(), in[1].data(), in[2].data(), in[3].data() },
+            { out[0].data(), out[1].data(), out[2].data(), out[3].data() },
+            in[0].size());
+    }
+};
+
+/* straightforward implementation of the formulas, in double precision */
+std::array<double, 4> reference(
+    const position_params &p, position_method method, const double (&amp)[4])
+{
+    double v[4];
+    for (unsigned j = 0; j < 4; j++)
+        v[j] = (amp[j] - p.offsets[j]) * p.gains[j];
+    const double a = v[0], b = v[1], c = v[2], d = v[3];
+    const double s = a + b + c + d;
+
+    double x, y;
+    if (method == position_method::delta_over_sum) {
+        x = p.kx * (a - b - c + d) / s;
+        y = p.ky * (a + b - c - d) / s;
+    } else {
+        const double u = (a - c) / (a + c), w = (b - d) / (b + d);
+        x = p.kx / 2 * (u - w);
+        y = p.ky / 2 * (u + w);
+    }
+
+    return { x - p.offset_x, y - p.offset_y, (a - b + c - d) / s, p.ksum * s };
+}
+
+void check_positions(const position_params &p, position_method method)
+{
+    /* odd amount of samples, so the vector loop leaves a remainder */
+    samples s(1003);
+    s.compute(p, method);
+
+    /* errors are relative to the magnitude of each term */
+    const double scale[4] = { std::abs(p.kx) + std::abs(p.offset_x),
+        std::abs(p.ky) + std::abs(p.offset_y), 1, 0 };
+
+    size_t mismatches = 0;
+    for (size_t i = 0; i < s.in[0].size(); i++) {
+        double amp[4];
+        for (unsigned j = 0; j < 4; j++)
+            amp[j] = s.in[j][i];
+        auto expected = reference(p, method, amp);
+        for (unsigned j = 0; j < 4; j++) {
+            const double tolerance
+                = 1e-5 * (scale[j] + std::abs(expected[j]));
+            if (std::abs(s.out[j][i] - expected[j]) > tolerance)
+                mismatches++;
+        }
+    }
+    CHECK(mismatches == 0);
+}
+
+}
+
+TEST_CASE("Same results as reference", "[position]")
+{
+    position_params p;
+    for (auto method :
+        { position_method::delta_over_sum, position_method::partial_delta }) {
+        check_positions(p, method);
+
+        p.kx = 8.5e6;
+        p.ky = 8.6e6;
+        p.ksum = 1.25;
+        p.offset_x = 1234;
+        p.offset_y = -4321;
+        check_positions(p, method);
+
+        p.gains = { 0.98, 1.01, 1.03, 0.99 };
+        p.offsets = { 10, -20, 30, -40 };
+        check_positions(p, method);
+    }
+}
+
+TEST_CASE("Centered beam", "[position]")
+{
+    samples s(5);
+    for (auto &v : s.in)
+        for (auto &a : v)
+            a = 1000;
+
+    position_params p;
+    p.kx = 1e7;
+    p.ksum = 2;
+    p.offset_y = 7;
+    for (auto method :
+        { position_method::delta_over_sum, position_method::partial_delta }) {
+        s.compute(p, method);
+        for (size_t i = 0; i < 5; i++) {
+            CHECK(s.out[0][i] == 0);
+            CHECK(s.out[1][i] == -7);
+            CHECK(s.out[2][i] == 0);
+            CHECK(s.out[3][i] == 8000);
+        }
+    }
+}
+
+TEST_CASE("Benchmark", "[position-benchmark]")
+{
+    /* 1M samples per call */
+    samples s(1 << 20);
+    position_params p;
+    p.kx = 8.5e6;
+    p.ky = 8.6e6;
+
+    BENCHMARK("Delta over sum - 1M samples")
+    {
+        s.compute(p, position_method::delta_over_sum);
+        return s.out[0][0];
+    };
+    BENCHMARK("Partial delta - 1M samples")
+    {
+        s.compute(p, position_method::partial_delta);
+        return s.out[0][0];
+    };
+}
@@ -0,0 +1,186 @@
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include <catch2/benchmark/catch_benchmark_all.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include "prbs.h"
+
+namespace {
+
+std::vector<double> make_impulse_response(size_t taps)
+{
+    std::vector<double> h(taps);
+    for (size_t i = 0; i < taps; i++)
+        h[i] = std::exp(-(double)i / 4) * std::cos(i * 0.7);
+    return h;
+}
+
+/* response to a PRBS which has been running since before the acquisition */
+std::vector<double> make_response(unsigned lfsr_length, unsigned step_duration,
+    size_t n, const std::vector<double> &h, double level_0, double level_1)
+{
+    const size_t period = ((1ULL << lfsr_length) - 1) * step_duration;
+    const auto seq = prbs_sequence(lfsr_length, step_duration, period);
+
+    std::vector<double> y(n);
+    for (size_t i = 0; i < n; i++)
+        for (size_t j = 0; j < h.size(); j++) {
+            const size_t k = (i + period * h.size() - j) % period;
+            y[i] += h[j] * (seq[k] ? level_1 : level_0);
+        }
+    return y;
+}
+
+size_t count_errors(const std::vector<double> &a, const std::vector<double> &b,
+    double tolerance)
+{
+    size_t errors = 0;
+    for (size_t i = 0; i < a.size(); i++)
+        if (std::abs(a[i] - b[i]) > tolerance)
+            errors++;
+    return errors;
+}
+
+}
+
+TEST_CASE("PRBS has maximal length", "[prbs]")
+{
+    for (unsigned length = 2; length <= 16; length++) {
+        const size_t period = (1ULL << length) - 1;
+        const auto seq = prbs_sequence(length, 1, 2 * period);
+
+        size_t ones = 0;
+        for (size_t i = 0; i < period; i++) {
+            ones += seq[i];
+            REQUIRE(seq[i] == seq[i + period]);
+        }
+        /* the all ones state is never reached */
+        CHECK(ones == period / 2);
+
+        /* no shorter period */
+        for (size_t p = 1; p < period; p++) {
+            if (period % p)
+                continue;
+            bool repeats = true;
+            for (size_t i = 0; i + p < 2 * period && repeats; i++)
+                repeats = seq[i] == seq[i + p];
+            CHECK(!repeats);
+        }
+    }
+}
+
+TEST_CASE("PRBS steps", "[prbs]")
+{
+    const auto seq = prbs_sequence(7, 1, 300), seq3 = prbs_sequence(7, 3, 900);
+    for (size_t i = 0; i < seq3.size(); i++)
+        REQUIRE(seq3[i] == seq[i / 3]);
+
+    CHECK(prbs_sequence(5, 4, 10).size() == 10);
+    CHECK_THROWS_AS(prbs_sequence(1, 1, 10), std::logic_error);
+    CHECK_THROWS_AS(prbs_sequence(33, 1, 10), std::logic_error);
+    CHECK_THROWS_AS(prbs_sequence(8, 0, 10), std::logic_error);
+}
+
+TEST_CASE("Impulse response from whole periods", "[prbs]")
+{
+    const size_t taps = 24;
+    const auto h = make_impulse_response(taps);
+
+    PrbsCorrelator c(10, 1, 4 * 1023);
+    REQUIRE(c.get_period() == 1023);
+
+    /* the offset and the tail of the last period are ignored */
+    const auto y = make_response(10, 1, 3 * 1023 + 100, h, 500, 700);
+    std::vector<double> out(taps);
+    c.estimate(y, 200, out);
+    CHECK(count_errors(out, h, 5e-3) == 0);
+
+    PrbsCorrelator c4(8, 4, 2 * 255 * 4);
+    REQUIRE(c4.get_period() == 255 * 4);
+    const auto y4 = make_response(8, 4, 2 * 255 * 4, h, -3, 3);
+    c4.estimate(y4, 6, out);
+    /* smoothed over one step, which is a moving average with triangular
+     * weights */
+    std::vector<double> smoothed(taps);
+    for (size_t k = 0; k < taps; k++)
+        for (int d = -3; d <= 3; d++)
+            if ((int)k - d >= 0 && (int)k - d < (int)taps)
+                smoothed[k] += h[k - d] * (4 - std::abs(d)) / 4;
+    CHECK(count_errors(out, smoothed, 2e-2) == 0);
+}
+
+TEST_CASE("Impulse response from part of a period", "[prbs]")
+{
+    const size_t taps = 16, n = 100000;
+    const auto h = make_impulse_response(taps);
+    const auto y = make_response(20, 1, n, h, 0, 1);
+
+    PrbsCorrelator c(20, 1, n);
+    std::vector<double> out(taps);
+    c.estimate(y, 1, out);
+    CHECK(count_errors(out, h, 3e-2) == 0);
+
+    CHECK_THROWS_AS(c.estimate(std::span(y).first(taps), 1, out),
+        std::logic_error);
+    PrbsCorrelator small(20, 1, n / 2);
+    CHECK_THROWS_AS(small.estimate(y, 1, out), std::logic_error);
+}
+
+TEST_CASE("Many channels", "[prbs]")
+{
+    const size_t taps = 32;
+    PrbsCorrelator c(9, 2, 4 * 511 * 2);
+
+    std::mt19937 gen(1);
+    std::normal_distribution<double> noise(0, 0.1);
+    std::vector<std::vector<double>> ys;
+    std::vector<std::span<const double>> responses;
+    std::vector<double> amplitudes;
+    for (unsigned i = 0; i < 20; i++) {
+        auto h = make_impulse_response(taps);
+        ys.push_back(make_response(9, 2, (i % 4 + 1) * c.get_period(), h,
+            0, 10 + i));
+        for (auto &v : ys.back())
+            v += noise(gen);
+        amplitudes.push_back(10 + i);
+    }
+    for (auto &y : ys)
+        responses.emplace_back(y);
+
+    const auto r = c.estimate(responses, amplitudes, taps, 4);
+    REQUIRE(r.size() == responses.size());
+    for (size_t i = 0; i < r.size(); i++) {
+        std::vector<double> out(taps);
+        c.estimate(responses[i], amplitudes[i], out);
+        CHECK(out == r[i]);
+    }
+
+    CHECK_THROWS_AS(c.estimate(responses, std::span(amplitudes).first(3), taps),
+        std::logic_error);
+}
+
+TEST_CASE("Benchmark", "[prbs-benchmark]")
+{
+    /* 100 channels with 100 periods of a 10 bit PRBS each */
+    const size_t taps = 128;
+    PrbsCorrelator c(10, 1, 100 * 1023);
+    std::vector<double> y(100 * c.get_period());
+    std::mt19937 gen(1);
+    std::normal_distribution<double> noise(0, 1);
+    for (auto &v : y)
+        v = noise(gen);
+
+    std::vector<std::span<const double>> responses(100, y);
+    std::vector<double> amplitudes(100, 1);
+
+    BENCHMARK("100 channels, 128 taps - 1 thread")
+    {
+        return c.estimate(responses, amplitudes, taps, 1);
+    };
+    BENCHMARK("100 channels, 128 taps - all threads")
+    {
+        return c.estimate(responses, amplitudes, taps);
+    };
+}
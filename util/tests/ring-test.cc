@@ -0,0 +1,64 @@
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "ring.h"
+
+TEST_CASE("Batches wrap around", "[ring]")
+{
+    SpscRing<int> ring(8);
+    CHECK(ring.capacity() == 8);
+
+    int src[10], dest[10];
+    for (int i = 0; i < 10; i++)
+        src[i] = i;
+
+    CHECK(ring.push(src, 10) == 8);
+    CHECK(ring.size() == 8);
+    CHECK(ring.pop(dest, 5) == 5);
+    CHECK(dest[4] == 4);
+
+    /* only 5 free positions, and they wrap around */
+    CHECK(ring.push(src + 8, 2) == 2);
+    CHECK(ring.push(src, 10) == 3);
+    CHECK(ring.pop(dest, 10) == 8);
+    int expected[] = { 5, 6, 7, 8, 9, 0, 1, 2 };
+    for (int i = 0; i < 8; i++)
+        CHECK(dest[i] == expected[i]);
+    CHECK(ring.pop(dest, 10) == 0);
+}
+
+TEST_CASE("Invalid capacity", "[ring]")
+{
+    CHECK_THROWS_AS(SpscRing<int>(12), std::logic_error);
+}
+
+TEST_CASE("Producer and consumer threads", "[ring]")
+{
+    const uint64_t total = 1 << 20;
+    SpscRing<uint64_t> ring(256);
+
+    std::thread producer([&ring, total]() {
+        uint64_t buf[37];
+        for (uint64_t next = 0; next < total;) {
+            size_t n = 0;
+            for (; n < 37 && next + n < total; n++)
+                buf[n] = next + n;
+            next += ring.push(buf, n);
+        }
+    });
+
+    uint64_t expected = 0, mismatches = 0, buf[64];
+    while (expected < total) {
+        size_t n = ring.pop(buf, 64);
+        for (size_t i = 0; i < n; i++)
+            if (buf[i] != expected++)
+                mismatches++;
+    }
+    producer.join();
+
+    CHECK(mismatches == 0);
+    CHECK(ring.size() == 0);
+}
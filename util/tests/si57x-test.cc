@@ -4,6 +4,12 @@
  *
  * the datasheet version is 1.6 */
 
+#include <cmath>
+#include <optional>
+#include <random>
+#include <vector>
+
+#include <catch2/benchmark/catch_benchmark_all.hpp>
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/matchers/catch_matchers_floating_point.hpp>
 
@@ -13,6 +19,37 @@ using namespace Catch::Matchers;
 
 const double precision = 0.000001;
 
+namespace {
+
+/* the exhaustive search used before, which doesn't support N1 = 1 */
+std::optional<double> reference_error(double fxtal, double freq)
+{
+    std::optional<double> best;
+    for (double hs_div : { 11, 9, 7, 6, 5, 4 })
+        for (double n1 = 2; n1 <= 128; n1 += 2) {
+            double rfreq = llrint(freq * hs_div * n1 * (1 << 28) / fxtal);
+            double fdco = rfreq * fxtal / (1 << 28);
+            if (fdco >= 4850000000 && fdco <= 5670000000) {
+                double err = fabs(freq - fdco / (hs_div * n1));
+                if (!best || err < *best)
+                    best = err;
+            }
+        }
+    return best;
+}
+
+double error(double fxtal, double freq, const si57x_registers &r)
+{
+    si57x_parameters params;
+    params.fxtal = fxtal;
+    params.rfreq = r.rfreq;
+    params.n1 = r.n1;
+    params.hs_div = r.hs_div;
+    return fabs(freq - params.get_freq());
+}
+
+}
+
 /* based on example in section 3.2 */
 TEST_CASE("calc_fxtal", "[si57x-test]")
 {
@@ -61,3 +98,76 @@ TEST_CASE("set_freq failure", "[si57x-test]")
 
     CHECK_FALSE(params.set_freq(1000000));
 }
+
+TEST_CASE("set_freq with N1 = 1", "[si57x-test]")
+{
+    si57x_parameters params;
+
+    /* needs fdco = 5.5GHz, which requires HS_DIV = 11 and N1 = 1 */
+    CHECK(params.set_freq(500000000));
+    CHECK(params.n1 == 0);
+    CHECK(params.hs_div == 7);
+    CHECK_THAT(params.get_freq(), WithinRel(500000000, precision));
+}
+
+TEST_CASE("Error is never worse than the exhaustive search", "[si57x-test]")
+{
+    const double fxtal = 114285000;
+    std::mt19937 gen(1);
+    std::uniform_real_distribution<double> dist(5e6, 1.5e9);
+    std::vector<double> freqs = { 37.9e6, 100e6, 117.3e6, 125e6, 250e6,
+        280e6, 441e6, 810e6 };
+    for (unsigned i = 0; i < 2000; i++)
+        freqs.push_back(dist(gen));
+
+    const auto r = si57x_solve(fxtal, freqs);
+    REQUIRE(r.size() == freqs.size());
+    for (size_t i = 0; i < freqs.size(); i++) {
+        auto ref = reference_error(fxtal, freqs[i]);
+        if (ref) {
+            REQUIRE(r[i]);
+            REQUIRE(error(fxtal, freqs[i], *r[i]) <= *ref);
+        }
+        /* results match set_freq() */
+        si57x_parameters params;
+        params.fxtal = fxtal;
+        REQUIRE(params.set_freq(freqs[i]) == r[i].has_value());
+        if (r[i]) {
+            REQUIRE(params.rfreq == r[i]->rfreq);
+            REQUIRE(params.n1 == r[i]->n1);
+            REQUIRE(params.hs_div == r[i]->hs_div);
+        }
+    }
+
+    /* fxtal is part of the cache key */
+    const std::vector<double> freq = { 125000000 };
+    CHECK(si57x_solve(fxtal, freq)[0]->rfreq
+        != si57x_solve(fxtal * 1.001, freq)[0]->rfreq);
+    CHECK_FALSE(si57x_solve(fxtal, std::vector { 1e6 })[0]);
+}
+
+TEST_CASE("Benchmark", "[si57x-benchmark]")
+{
+    const double fxtal = 114285000;
+    std::vector<double> freqs(1000);
+    for (size_t i = 0; i < freqs.size(); i++)
+        freqs[i] = 100e6 + i * 1e3;
+
+    BENCHMARK("exhaustive search - 1000 frequencies")
+    {
+        double sum = 0;
+        for (auto f : freqs)
+            sum += reference_error(fxtal, f).value_or(0);
+        return sum;
+    };
+    /* a different fxtal each time, so nothing is cached */
+    double offset = 0;
+    BENCHMARK("si57x_solve() - 1000 frequencies")
+    {
+        return si57x_solve(fxtal + offset++, freqs);
+    };
+    BENCHMARK("si57x_solve() cached - 1000 frequencies")
+    {
+        return si57x_solve(fxtal, freqs);
+    };
+}
@@ -0,0 +1,97 @@
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "step_graph.h"
+
+using namespace std::chrono_literals;
+
+TEST_CASE("Steps run in order", "[step-graph]")
+{
+    std::vector<int> order;
+    StepGraph g;
+    auto a = g.add("a", [&]() { return order.push_back(0), true; });
+    auto b = g.add("b", [&]() { return order.push_back(1), true; }, { a });
+    g.add("c", [&]() { return order.push_back(2), true; }, { a, b });
+    REQUIRE(g.size() == 3);
+
+    auto r = g.run();
+    CHECK(order == std::vector { 0, 1, 2 });
+    REQUIRE(r.size() == 3);
+    for (const auto &s : r) {
+        CHECK(s.result == StepGraph::status::ok);
+        CHECK(s.start <= s.end);
+    }
+    CHECK(r[1].name == "b");
+    CHECK(r[0].end <= r[1].start);
+
+    CHECK_THROWS_AS(
+        g.add("d", []() { return true; }, { 3 }), std::out_of_range);
+}
+
+TEST_CASE("Failures skip dependent steps", "[step-graph]")
+{
+    StepGraph g;
+    auto clock = g.add("clock", []() { return false; });
+    auto adc = g.add("adc", []() { return true; }, { clock });
+    g.add("after adc", []() { return true; }, { adc });
+    auto other = g.add("other", []() -> bool {
+        throw std::runtime_error("no device");
+    });
+    g.add("independent", []() { return true; });
+    g.add("after other", []() { return true; }, { other });
+
+    auto r = g.run();
+    using s = StepGraph::status;
+    CHECK(r[0].result == s::failed);
+    CHECK(r[1].result == s::skipped);
+    CHECK(r[2].result == s::skipped);
+    CHECK(r[3].result == s::failed);
+    CHECK(r[3].error == "no device");
+    CHECK(r[4].result == s::ok);
+    CHECK(r[5].result == s::skipped);
+}
+
+TEST_CASE("Critical path", "[step-graph]")
+{
+    StepGraph g;
+    auto fast = g.add("fast", []() { return true; });
+    auto slow = g.add("slow", []() {
+        std::this_thread::sleep_for(20ms);
+        return true;
+    });
+    auto mid = g.add("mid", []() { return true; }, { fast, slow });
+    auto failed = g.add("failed", []() { return false; });
+    auto last = g.add("last", []() { return true; }, { mid });
+    g.add("after failure", []() { return true; }, { failed });
+
+    auto r = g.run();
+    CHECK(g.critical_path(r) == std::vector<size_t> { slow, mid, last });
+    CHECK(r[slow].end - r[slow].start >= 20ms);
+
+    CHECK_THROWS_AS(g.critical_path({ }), std::logic_error);
+}
+
+TEST_CASE("Graphs in different threads share an epoch", "[step-graph]")
+{
+    std::vector<StepGraph> graphs(4);
+    for (auto &g : graphs)
+        g.add("sleep", []() {
+            std::this_thread::sleep_for(50ms);
+            return true;
+        });
+
+    const auto epoch = std::chrono::steady_clock::now();
+    std::vector<std::vector<StepGraph::step_report>> reports(graphs.size());
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < graphs.size(); i++)
+        threads.emplace_back(
+            [&, i]() { reports[i] = graphs[i].run(epoch); });
+    for (auto &t : threads)
+        t.join();
+
+    for (const auto &r : reports)
+        CHECK(r[0].start < 40ms);
+}
@@ -1,4 +1,8 @@
+#include <array>
+#include <cstring>
 #include <stdexcept>
+
+#include <endian.h>
 #include <sys/mman.h>
 
 #include "test-util.h"
@@ -31,3 +35,29 @@ void dummy_dev_open(struct pcie_bars &bars)
 
     bars.fserport = nullptr;
 }
+
+void dummy_sdb(
+    struct pcie_bars &bars, const std::vector<struct sdb_device_info> &devices)
+{
+    /* records are 64 bytes long, in big endian */
+    using record = std::array<unsigned char, 64>;
+    auto put = [](record &r, size_t offset, auto value) {
+        memcpy(&r[offset], &value, sizeof value);
+    };
+
+    std::vector<record> records(devices.size() + 1);
+    put(records[0], 0, htobe32(0x5344422d));
+    put(records[0], 4, htobe16(records.size()));
+    records[0][63] = 0x00;
+    for (size_t i = 0; i < devices.size(); i++) {
+        auto &r = records[i + 1];
+        r[2] = devices[i].abi_ver_major;
+        r[3] = devices[i].abi_ver_minor;
+        put(r, 8, htobe64(devices[i].start_addr));
+        put(r, 16, htobe64(devices[i].start_addr + 0xff));
+        put(r, 24, htobe64(devices[i].vendor_id));
+        put(r, 32, htobe32(devices[i].device_id));
+        r[63] = 0x01;
+    }
+    bar4_write_v(&bars, 0, records.data(), records.size() * sizeof(record));
+}
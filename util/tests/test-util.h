@@ -1,8 +1,15 @@
 #ifndef TEST_UTIL_H
 #define TEST_UTIL_H
 
+#include <vector>
+
 #include "pcie.h"
+#include "sdb-defs.h"
 
 void dummy_dev_open(struct pcie_bars &);
 
+/** Write an SDB table at the start of BAR4, with an interconnect record
+ * followed by a device record for each device, at its start_addr */
+void dummy_sdb(struct pcie_bars &, const std::vector<struct sdb_device_info> &);
+
 #endif
@@ -0,0 +1,62 @@
+#include <thread>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "pcie.h"
+#include "test-util.h"
+#include "wait_bits.h"
+
+using namespace std::chrono_literals;
+
+TEST_CASE("Bits already set", "[wait-bits]")
+{
+    struct pcie_bars bars;
+    dummy_dev_open(bars);
+    bar4_write(&bars, 0x10, 0x13);
+
+    /* a deadline in the past still reads the word once */
+    const auto past = std::chrono::steady_clock::now() - 1s;
+    CHECK(wait_for_bits(bars, 0x10, 0x3, 0x3, past) == 0x13);
+    CHECK(wait_for_bits(bars, 0x10, 0x10, 0, past) == std::nullopt);
+}
+
+TEST_CASE("Bits set by another thread", "[wait-bits]")
+{
+    struct pcie_bars bars;
+    dummy_dev_open(bars);
+    bar4_write(&bars, 0x4, 0x8);
+
+    const auto start = std::chrono::steady_clock::now();
+    std::thread t([&bars]() {
+        std::this_thread::sleep_for(5ms);
+        bar4_write(&bars, 0x4, 0x2);
+    });
+    auto r = wait_for_bits(bars, 0x4, 0x8, 0, start + 10s, { .spins = 10 });
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    t.join();
+
+    CHECK(r == 0x2);
+    CHECK(elapsed >= 5ms);
+    /* the delay between reads is capped at 1ms by default, so the change is
+     * seen long before the deadline, even on a loaded machine */
+    CHECK(elapsed < 5s);
+}
+
+TEST_CASE("Deadline", "[wait-bits]")
+{
+    struct pcie_bars bars;
+    dummy_dev_open(bars);
+    bar4_write(&bars, 0x0, 0x1);
+
+    const auto start = std::chrono::steady_clock::now();
+    /* the second sleep would take 10s */
+    const backoff_policy slow
+        = { .initial = 1ms, .factor = 10000, .max = 100s };
+    auto r = wait_for_bits(bars, 0x0, 0x1, 0, start + 20ms, slow);
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+
+    CHECK(r == std::nullopt);
+    /* the last sleep is cut short by the deadline */
+    CHECK(elapsed >= 20ms);
+    CHECK(elapsed < 5s);
+}
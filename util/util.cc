@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <numeric>
 #include <ranges>
 #include <stdexcept>
@@ -5,6 +6,7 @@
 #include <cassert>
 #include <strings.h>
 
+#include "simd.h"
 #include "util.h"
 
 size_t get_index(
@@ -64,6 +66,84 @@ double fixed2float(uint32_t v, unsigned point_pos)
     return (double)(int32_t)v / ((uint64_t)1 << point_pos);
 }
 
+void float2fixed(std::span<const double> in, std::span<uint32_t> out,
+    unsigned point_pos, bool saturate)
+{
+    if (in.size() != out.size())
+        throw std::logic_error("input and output must have the same size");
+
+    /* multiplying by a power of 2 is exact, so clamping the scaled value gives
+     * the same results as the scalar version */
+    const double scale = (uint64_t)1 << point_pos;
+    const double max_scaled = INT32_MAX, min_scaled = INT32_MIN;
+
+    if (!saturate) {
+        /* the scalar version throws the appropriate error, or allows the value
+         * one bit beyond the maximum */
+        for (double v : in)
+            if (v * scale > max_scaled || v * scale < min_scaled)
+                float2fixed(v, point_pos, false);
+    }
+
+    size_t i = 0;
+#ifdef USE_SSE2
+    const __m128d vscale = _mm_set1_pd(scale), vmax = _mm_set1_pd(max_scaled),
+                  vmin = _mm_set1_pd(min_scaled);
+    for (; i + 4 <= in.size(); i += 4) {
+        __m128d lo = _mm_mul_pd(_mm_loadu_pd(&in[i]), vscale),
+                hi = _mm_mul_pd(_mm_loadu_pd(&in[i + 2]), vscale);
+        lo = _mm_min_pd(_mm_max_pd(lo, vmin), vmax);
+        hi = _mm_min_pd(_mm_max_pd(hi, vmin), vmax);
+        _mm_storeu_si128((__m128i *)&out[i],
+            _mm_unpacklo_epi64(_mm_cvttpd_epi32(lo), _mm_cvttpd_epi32(hi)));
+    }
+#endif
+    for (; i < in.size(); i++)
+        out[i] = (int32_t)std::clamp(in[i] * scale, min_scaled, max_scaled);
+}
+
+void fixed2float(
+    std::span<const uint32_t> in, std::span<double> out, unsigned point_pos)
+{
+    if (in.size() != out.size())
+        throw std::logic_error("input and output must have the same size");
+
+    /* the reciprocal of a power of 2 is exact */
+    const double scale = 1. / ((uint64_t)1 << point_pos);
+
+    size_t i = 0;
+#ifdef USE_SSE2
+    const __m128d vscale = _mm_set1_pd(scale);
+    for (; i + 4 <= in.size(); i += 4) {
+        const __m128i v = _mm_loadu_si128((const __m128i *)&in[i]);
+        _mm_storeu_pd(&out[i], _mm_mul_pd(_mm_cvtepi32_pd(v), vscale));
+        _mm_storeu_pd(&out[i + 2],
+            _mm_mul_pd(_mm_cvtepi32_pd(_mm_srli_si128(v, 8)), vscale));
+    }
+#endif
+    for (; i < in.size(); i++)
+        out[i] = (int32_t)in[i] * scale;
+}
+
+void pack_pairs(std::span<const int16_t> low, std::span<const int16_t> high,
+    std::span<uint32_t> out)
+{
+    if (low.size() != out.size() || high.size() != out.size())
+        throw std::logic_error("input and output must have the same size");
+
+    size_t i = 0;
+#ifdef USE_SSE2
+    for (; i + 8 <= out.size(); i += 8) {
+        const __m128i l = _mm_loadu_si128((const __m128i *)&low[i]),
+                      h = _mm_loadu_si128((const __m128i *)&high[i]);
+        _mm_storeu_si128((__m128i *)&out[i], _mm_unpacklo_epi16(l, h));
+        _mm_storeu_si128((__m128i *)&out[i + 4], _mm_unpackhi_epi16(l, h));
+    }
+#endif
+    for (; i < out.size(); i++)
+        out[i] = (uint16_t)low[i] | (uint32_t)(uint16_t)high[i] << 16;
+}
+
 /* XXX: replace with C++23's std::ranges::fold_left_first */
 
 std::string list_of_keys(const tsl::ordered_map<std::string_view, int> &m)
@@ -3,6 +3,7 @@
 
 #include <cstdint>
 #include <functional>
+#include <span>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -18,6 +19,22 @@ void clear_and_insert_index(uint32_t &dest, uint32_t mask,
 
 uint32_t float2fixed(double v, unsigned point_pos, bool saturate = true);
 double fixed2float(uint32_t v, unsigned point_pos);
+/** Same as the scalar version for each element of \p in. If saturate is
+ * false, all values are checked before any is converted, and out of range
+ * values throw like the scalar version. \p in and \p out must have the same
+ * size */
+void float2fixed(std::span<const double> in, std::span<uint32_t> out,
+    unsigned point_pos, bool saturate = true);
+/** Same as the scalar version for each element of \p in. \p in and \p out
+ * must have the same size */
+void fixed2float(
+    std::span<const uint32_t> in, std::span<double> out, unsigned point_pos);
+
+/** Pack each pair of values from \p low and \p high into a word of \p out,
+ * with the value from \p low in bits 15-0 and the one from \p high in bits
+ * 31-16. All of them must have the same size */
+void pack_pairs(std::span<const int16_t> low, std::span<const int16_t> high,
+    std::span<uint32_t> out);
 
 std::string list_of_keys(const tsl::ordered_map<std::string_view, int> &);
 std::string list_of_keys(const std::vector<std::string> &);
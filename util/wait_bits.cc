@@ -0,0 +1,33 @@
+#include <algorithm>
+#include <thread>
+
+#include "pcie.h"
+#include "wait_bits.h"
+
+std::optional<uint32_t> wait_for_bits(struct pcie_bars &bars, size_t addr,
+    uint32_t mask, uint32_t value,
+    std::chrono::steady_clock::time_point deadline,
+    const backoff_policy &backoff)
+{
+    auto delay = backoff.initial;
+
+    for (unsigned i = 0;; i++) {
+        const uint32_t word = bar4_read(&bars, addr);
+        if ((word & mask) == value)
+            return word;
+
+        const auto now = std::chrono::steady_clock::now();
+        if (now >= deadline)
+            return std::nullopt;
+        if (i < backoff.spins)
+            continue;
+
+        /* the last read happens at the deadline */
+        std::this_thread::sleep_for(std::min<std::chrono::nanoseconds>(
+            delay, deadline - now));
+        delay = std::min(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                delay * backoff.factor),
+            backoff.max);
+    }
+}
@@ -0,0 +1,29 @@
+#ifndef WAIT_BITS_H
+#define WAIT_BITS_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+#include "pcie-defs.h"
+
+/** How wait_for_bits() spaces its reads: \p spins reads are done back to
+ * back, and then the delay between reads starts at \p initial and is
+ * multiplied by \p factor after each read, up to \p max */
+struct backoff_policy {
+    unsigned spins = 0;
+    std::chrono::nanoseconds initial = std::chrono::microseconds(1);
+    double factor = 2;
+    std::chrono::nanoseconds max = std::chrono::milliseconds(1);
+};
+
+/** Read the BAR4 word at \p addr until (word & \p mask) == \p value, without
+ * going past \p deadline. Returns the matching word, or std::nullopt if the
+ * deadline passed first. The word is always read at least once */
+std::optional<uint32_t> wait_for_bits(struct pcie_bars &, size_t addr,
+    uint32_t mask, uint32_t value,
+    std::chrono::steady_clock::time_point deadline,
+    const backoff_policy & = { });
+
+#endif